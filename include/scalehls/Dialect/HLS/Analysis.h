@@ -28,6 +28,58 @@ private:
   llvm::SmallDenseMap<NodeOp, unsigned long> nodeComplexityMap;
 };
 
+/// Producer/consumer graph of the dataflow nodes in a function. Buffer users
+/// and node order of each schedule are cached, such that passes can query them
+/// without rescanning use-lists or rebuilding dominance info on each query.
+/// The graph must be updated explicitly when nodes are inserted, fused, or
+/// erased, or when their operands are changed.
+class DataflowGraphAnalysis {
+public:
+  DataflowGraphAnalysis(func::FuncOp func);
+
+  /// Get the consumer/producer nodes of the given buffer except the given node.
+  SmallVector<NodeOp> getConsumersExcept(Value buffer, NodeOp except) const;
+  SmallVector<NodeOp> getProducersExcept(Value buffer, NodeOp except) const;
+  SmallVector<NodeOp> getConsumers(Value buffer) const;
+  SmallVector<NodeOp> getProducers(Value buffer) const;
+  SmallVector<NodeOp> getDependentConsumers(Value buffer, NodeOp node) const;
+
+  /// Return whether node "a" is placed before node "b" in their schedule.
+  bool isBefore(NodeOp a, NodeOp b) const;
+
+  /// Add a newly created node into the graph.
+  void addNode(NodeOp node);
+  /// Remove a node from the graph. This must be called before the node is
+  /// erased.
+  void removeNode(NodeOp node);
+  /// Refresh the buffer users of a node after its operands are changed.
+  void updateNode(NodeOp node) {
+    removeNode(node);
+    addNode(node);
+  }
+
+  /// Fuse the given nodes with "fuseNodeOps" and update the graph accordingly.
+  NodeOp fuseNodes(ArrayRef<NodeOp> nodes, PatternRewriter &rewriter);
+
+private:
+  struct BufferUsers {
+    SmallVector<NodeOp, 2> producers;
+    SmallVector<NodeOp, 4> consumers;
+  };
+
+  /// Renumber the nodes of a schedule if its node order is out of date.
+  void updateNodeOrder(ScheduleOp schedule) const;
+
+  DenseMap<Value, BufferUsers> bufferUsersMap;
+  /// The buffers accessed by each node. This allows us to remove a node from
+  /// the graph without traversing its operands.
+  llvm::SmallDenseMap<NodeOp, SmallVector<Value, 4>> nodeBuffersMap;
+
+  /// Node order is renumbered lazily, as insertions are usually batched.
+  mutable llvm::SmallDenseMap<NodeOp, unsigned> nodeOrderMap;
+  mutable llvm::SmallDenseSet<ScheduleOp> staleSchedules;
+};
+
 /// TODO: Support dataflow node with multiple loops.
 /// Record a pair of correlated node.
 class Correlation {
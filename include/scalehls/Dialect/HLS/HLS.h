@@ -76,6 +76,25 @@ void setLoopInfo(Operation *op, LoopInfoAttr loopInfo);
 void setLoopInfo(Operation *op, int64_t flattenTripCount, int64_t iterLatency,
                  int64_t minII);
 
+/// Callee argument types attribute utils. The attribute annotates a no_touch
+/// call with the argument types of the sub-function under its selected design
+/// point, such that the call can be handled without looking up the callee.
+SmallVector<Type, 4> getCalleeArgTypes(Operation *op);
+void setCalleeArgTypes(Operation *op, TypeRange argTypes);
+
+/// Profiled trip count attribute utils. The histogram counts trip counts in
+/// power-of-two buckets, where bucket "i" holds the trip counts with a bit
+/// length of "i". Trailing empty buckets are omitted. Transforms changing the
+/// iteration space of a loop in place must remove the stale profiled results.
+Optional<double> getProfiledTripCount(Operation *op);
+void setProfiledTripCount(Operation *op, double tripCount, int64_t maxTripCount,
+                          ArrayRef<int64_t> histogram);
+void removeProfiledTripCount(Operation *op);
+
+/// Profiled branch probability attribute utils.
+Optional<double> getProfiledThenProbability(Operation *op);
+void setProfiledThenProbability(Operation *op, double probability);
+
 //===----------------------------------------------------------------------===//
 // HLS directive attributes
 //===----------------------------------------------------------------------===//
@@ -26,7 +26,7 @@ public:
             // HLS dialect operations.
             BufferOp, ConstBufferOp, StreamOp, StreamReadOp, StreamWriteOp,
             AxiBundleOp, AxiPortOp, AxiPackOp, PrimMulOp, PrimCastOp,
-            hls::AffineSelectOp, hls::VectorInitOp,
+            hls::AffineSelectOp, hls::VectorInitOp, ScheduleOp, NodeOp,
 
             // Function operations.
             func::CallOp, func::ReturnOp,
@@ -109,6 +109,8 @@ public:
   HANDLE(PrimCastOp);
   HANDLE(hls::AffineSelectOp);
   HANDLE(hls::VectorInitOp);
+  HANDLE(ScheduleOp);
+  HANDLE(NodeOp);
 
   // Control flow operations.
   HANDLE(func::CallOp);
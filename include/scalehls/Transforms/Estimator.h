@@ -11,16 +11,147 @@
 #include "mlir/IR/Dominance.h"
 #include "scalehls/Dialect/HLS/Visitor.h"
 #include "scalehls/Transforms/Utils.h"
+#include "llvm/ADT/BitVector.h"
 #include "llvm/Support/JSON.h"
+#include <array>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 
 namespace mlir {
 namespace scalehls {
 
-// Get the operator name to latency/DSP usage mapping.
+// Get the operator name to latency/DSP usage/LUT usage mapping.
 void getLatencyMap(llvm::json::Object *config,
                    llvm::StringMap<int64_t> &latencyMap);
 void getDspUsageMap(llvm::json::Object *config,
                     llvm::StringMap<int64_t> &dspUsageMap);
+void getLutUsageMap(llvm::json::Object *config,
+                    llvm::StringMap<int64_t> &lutUsageMap);
+
+/// Calculate the number of BRAMs occupied by the given on-chip buffer.
+int64_t getBramNum(MemRefType memrefType);
+
+//===----------------------------------------------------------------------===//
+// EstimationResult Class Declaration
+//===----------------------------------------------------------------------===//
+
+/// The compact estimation result of an operation, which is held in the side
+/// table of the estimator instead of IR attributes. The nested structures
+/// mirror the accessors of TimingAttr, ResourceAttr, and LoopInfoAttr.
+struct EstimationResult {
+  struct Timing {
+    int64_t begin = 0;
+    int64_t end = 0;
+    int64_t latency = 0;
+    int64_t interval = 0;
+    bool isValid = false;
+
+    int64_t getBegin() const { return begin; }
+    int64_t getEnd() const { return end; }
+    int64_t getLatency() const { return latency; }
+    int64_t getInterval() const { return interval; }
+    explicit operator bool() const { return isValid; }
+  };
+
+  struct Resource {
+    int64_t lut = 0;
+    int64_t dsp = 0;
+    int64_t bram = 0;
+    bool isValid = false;
+
+    int64_t getLut() const { return lut; }
+    int64_t getDsp() const { return dsp; }
+    int64_t getBram() const { return bram; }
+    explicit operator bool() const { return isValid; }
+  };
+
+  struct LoopInfo {
+    int64_t flattenTripCount = 0;
+    int64_t iterLatency = 0;
+    int64_t minII = 0;
+    bool isValid = false;
+
+    int64_t getFlattenTripCount() const { return flattenTripCount; }
+    int64_t getIterLatency() const { return iterLatency; }
+    int64_t getMinII() const { return minII; }
+    explicit operator bool() const { return isValid; }
+  };
+
+  Timing timing;
+  Resource resource;
+  LoopInfo loopInfo;
+
+  /// The partition indices of memory access operations, where -1 indicates an
+  /// undetermined partition index. "maxMuxSize" is the largest partition factor
+  /// among the dimensions with undetermined partition indices.
+  SmallVector<int64_t, 4> partitionIndices;
+  int64_t maxMuxSize = 1;
+};
+
+//===----------------------------------------------------------------------===//
+// QoRCache Class Declaration
+//===----------------------------------------------------------------------===//
+
+/// The cached estimation result of a loop band or function.
+struct QoRCacheEntry {
+  int64_t latency = 0;
+  int64_t interval = 0;
+  int64_t lut = 0;
+  int64_t dsp = 0;
+  int64_t bram = 0;
+
+  /// The flatten trip count, iteration latency, and minimum II of each loop in
+  /// the loop band from the outermost to the innermost. This is empty if the
+  /// entry belongs to a function.
+  SmallVector<std::array<int64_t, 3>, 4> loopInfos;
+};
+
+/// A memoized cache of estimation results keyed by the structural hash of loop
+/// bands and functions, where the directives and partition layouts are taken
+/// into consideration. The hash is computed from the textual form of types and
+/// attributes, thus is stable across runs and can be persisted to disk. This
+/// class is thread-safe.
+class QoRCache {
+public:
+  Optional<QoRCacheEntry> lookup(uint64_t key);
+  void insert(uint64_t key, const QoRCacheEntry &entry);
+
+  /// Load entries from or save entries to a JSON file.
+  bool load(StringRef filePath);
+  bool save(StringRef filePath);
+
+  unsigned getNumHits() const { return numHits; }
+  unsigned getNumMisses() const { return numMisses; }
+
+private:
+  std::mutex mutex;
+  std::unordered_map<uint64_t, QoRCacheEntry> entries;
+  unsigned numHits = 0;
+  unsigned numMisses = 0;
+};
+
+/// A cache of dependence distances keyed by the canonical form of two memory
+/// accesses and their iteration domains, where "None" indicates no dependency.
+/// The cache is shared by an estimator and all its forks, as the distance is
+/// only determined by the key. Once the number of entries exceeds the capacity,
+/// the cache is cleared to bound its memory footprint. This class is
+/// thread-safe.
+class DepDistanceCache {
+public:
+  explicit DepDistanceCache(unsigned capacity = 1 << 16)
+      : capacity(capacity) {}
+
+  /// Look up the dependence distance of "key". Return false if missed.
+  bool lookup(StringRef key, Optional<int64_t> &distance);
+  void insert(StringRef key, Optional<int64_t> distance);
+
+private:
+  std::mutex mutex;
+  llvm::StringMap<Optional<int64_t>> entries;
+  unsigned capacity;
+};
 
 //===----------------------------------------------------------------------===//
 // ScaleHLSEstimator Class Declaration
@@ -31,14 +162,69 @@ class ScaleHLSEstimator
 public:
   explicit ScaleHLSEstimator(llvm::StringMap<int64_t> &latencyMap,
                              llvm::StringMap<int64_t> &dspUsageMap,
+                             llvm::StringMap<int64_t> &lutUsageMap,
                              bool depAnalysis)
       : latencyMap(latencyMap), dspUsageMap(dspUsageMap),
-        depAnalysis(depAnalysis) {}
+        lutUsageMap(lutUsageMap), depAnalysis(depAnalysis) {}
+
+  /// Create a new estimator sharing the latency/DSP/LUT usage mapping, the
+  /// dependence distance cache, and options with this estimator, but without
+  /// any scheduling state. This is used for setting up the estimators of worker
+  /// threads.
+  ScaleHLSEstimator fork() {
+    auto estimator = ScaleHLSEstimator(latencyMap, dspUsageMap, lutUsageMap,
+                                       depAnalysis);
+    estimator.depDistances = depDistances;
+    estimator.setQoRCache(cache);
+    estimator.setAlwaysMaterialize(alwaysMaterialize);
+    return estimator;
+  }
+
+  /// Set whether to materialize the estimation results as IR attributes after
+  /// each estimation, which is enabled by default. If disabled, the results are
+  /// only held in the side table, which can be accessed through the getters
+  /// below or materialized on request with "materializeResults".
+  void setAlwaysMaterialize(bool materialize) {
+    alwaysMaterialize = materialize;
+  }
 
-  // Entry for estimating function and loop.
-  void estimateFunc(func::FuncOp func);
+  /// Materialize the estimation results of "root" and all its nested operations
+  /// as "timing", "resource", "loop_info", "partition_indices", and
+  /// "max_mux_size" attributes.
+  void materializeResults(Operation *root);
+
+  /// Get the estimation results of an operation. For no_touch operations that
+  /// are not estimated, the results are fetched from the IR attributes.
+  EstimationResult::Timing getTiming(Operation *op);
+  EstimationResult::Resource getResource(Operation *op);
+  EstimationResult::LoopInfo getLoopInfo(Operation *op);
+
+  /// Set the QoR cache to be looked up before estimating a function or loop.
+  /// Note that once the cache is hit, only the function or the loop band is
+  /// annotated with the estimation result.
+  void setQoRCache(QoRCache *qorCache) { cache = qorCache; }
+  QoRCache *getQoRCache() const { return cache; }
+
+  // Entry for estimating function and loop. If "useCache" is false, the QoR
+  // cache is bypassed and all contained operations are fully estimated.
+  void estimateFunc(func::FuncOp func, bool useCache = true);
   void estimateLoop(AffineForOp loop, func::FuncOp func);
 
+  /// Estimate the function incrementally by only re-scheduling the blocks
+  /// containing dirty operations since the last estimation, while the schedules
+  /// of all other loops are reused. No_touch operations whose annotations have
+  /// changed are detected as dirty automatically, any other modification to the
+  /// function must be reported through "markDirty". Any full estimation of the
+  /// same function invalidates the recorded schedules.
+  void estimateFuncIncrementally(func::FuncOp func);
+  void markDirty(Operation *op);
+
+  /// Estimate the dataflow schedule with a dataflow performance model, where
+  /// the latency of each node is estimated with the block scheduler and nodes
+  /// are overlapped following their dependencies. The steady-state interval
+  /// and total latency are annotated to the schedule.
+  void estimateSchedule(ScheduleOp schedule);
+
   using HLSVisitorBase::visitOp;
   bool visitUnhandledOp(Operation *op, int64_t begin) {
     // Default latency of any unhandled operation is 0.
@@ -49,6 +235,7 @@ public:
   bool visitOp(AffineIfOp op, int64_t begin);
   bool visitOp(scf::IfOp op, int64_t begin);
   bool visitOp(func::CallOp op, int64_t begin);
+  bool visitOp(ScheduleOp op, int64_t begin);
   bool visitOp(AffineLoadOp op, int64_t begin) {
     return estimateLoadStoreTiming(op, begin), true;
   }
@@ -85,6 +272,16 @@ public:
 #undef HANDLE
 
 private:
+  /// Side table related methods.
+  void setTiming(Operation *op, int64_t begin, int64_t end, int64_t latency,
+                 int64_t interval);
+  void setResource(Operation *op, EstimationResult::Resource resource);
+  void setResource(Operation *op, int64_t lut, int64_t dsp, int64_t bram);
+  void setLoopInfo(Operation *op, EstimationResult::LoopInfo loopInfo);
+  void setLoopInfo(Operation *op, int64_t flattenTripCount, int64_t iterLatency,
+                   int64_t minII);
+  int64_t getMaxMuxSize(Operation *op);
+
   /// LoadOp and StoreOp related methods.
   void getPartitionIndices(Operation *op);
   void estimateLoadStoreTiming(Operation *op, int64_t begin);
@@ -93,39 +290,127 @@ private:
   int64_t getResMinII(int64_t begin, int64_t end, MemAccessesMap &map);
   int64_t getDepMinII(int64_t II, func::FuncOp func, MemAccessesMap &map);
   int64_t getDepMinII(int64_t II, AffineForOp forOp, MemAccessesMap &map);
+  bool hasDisjointPartitions(Operation *srcOp, Operation *dstOp);
+
+  /// QoR cache related methods.
+  uint64_t getQoRCacheKey(Operation *funcOrLoop);
+
+  /// Incremental estimation related methods.
+  bool scheduleLoop(AffineForOp op, int64_t begin);
+  bool reuseLoopSchedule(AffineForOp op, int64_t begin);
+  void recordLoopSchedule(AffineForOp op, int64_t begin);
+  bool isReusableLoop(Operation *op);
+  void resetIncrementalState();
+
+  /// Dataflow schedule related methods.
+  bool scheduleNode(NodeOp node);
+  bool scheduleDataflow(ScheduleOp schedule);
 
   /// Block scheduler and estimator.
-  ResourceAttr calculateResource(Operation *funcOrLoop);
-  TimingAttr estimateBlock(Block &block, int64_t begin = 0);
+  bool scheduleFunc(func::FuncOp func);
+  EstimationResult::Resource calculateResource(Operation *funcOrLoop);
+  EstimationResult::Timing estimateBlock(Block &block, int64_t begin = 0);
   void reverseTiming(Block &block);
   void initEstimator(Block &block);
 
-  // Hold the memory ports information.
-  struct MemPortInfo {
+  // Hold the memory port reservation table of a memref. Each occupied schedule
+  // level is mapped to a row, and the available ports of all partitions are
+  // held in flat arrays indexed by "row * numPartitions + partition". The
+  // partitions whose read or write ports are exhausted are recorded in bitsets,
+  // such that a memory access can be checked against a schedule level without
+  // probing each partition.
+  struct MemPortTable {
+    MemPortTable() = default;
+    MemPortTable(MemRefType memrefType);
+
+    /// Reserve ports of the given partitions for the memory access operation at
+    /// the earliest available level no earlier than "begin", and return the
+    /// reserved level.
+    int64_t reserve(Operation *op, const llvm::BitVector &partitions,
+                    int64_t begin);
+
+    /// Copy all rows no earlier than "fromLevel" from "table", where the levels
+    /// of the copied rows are shifted by "shift".
+    void copyRows(const MemPortTable &table, int64_t fromLevel, int64_t shift);
+
+    /// Additionally reserve the ports reserved in all rows of "table", where
+    /// the levels of the merged rows are shifted by "shift".
+    void mergeRows(const MemPortTable &table, int64_t shift);
+
+    unsigned getRow(int64_t level);
+
+    // The number of ports of each partition.
+    unsigned numPartitions = 0;
     unsigned rdPort = 0;
     unsigned wrPort = 0;
     unsigned rdwrPort = 0;
 
-    SmallVector<MemRefAccess, 2> rdAccesses;
+    std::map<int64_t, unsigned> rows;
+    std::vector<unsigned> rdPorts;
+    std::vector<unsigned> wrPorts;
+    std::vector<unsigned> rdwrPorts;
+    std::vector<llvm::BitVector> rdFulls;
+    std::vector<llvm::BitVector> wrFulls;
+
+    // The scheduled read accesses of each row and their reserved partitions,
+    // which are shared with identical read accesses.
+    using ReadAccess = std::pair<MemRefAccess, llvm::BitVector>;
+    std::vector<SmallVector<ReadAccess, 2>> rdAccesses;
   };
 
-  // For storing memory port information of all partitions indexed by the
-  // {schedule_level, memref}.
-  using MemPortInfos = std::vector<MemPortInfo>;
-  using MemPortInfosMap = DenseMap<int64_t, DenseMap<Value, MemPortInfos>>;
-  MemPortInfosMap memPortInfosMap;
+  // For storing memory port reservation tables indexed by the memref.
+  using MemPortTables = DenseMap<Value, MemPortTable>;
+  MemPortTables memPortTables;
 
-  // For storing the number of each operator indexed by the schedule level.
+  // For storing the number of each operator indexed by the schedule level, and
+  // the total number of each operator in the block being scheduled.
   using NumOperatorMap = DenseMap<int64_t, llvm::StringMap<int64_t>>;
   NumOperatorMap numOperatorMap;
   llvm::StringMap<int64_t> totalNumOperatorMap;
 
-  // Store the operator name to latency/DSP usage mapping.
+  // For storing the schedule of a loop, where all levels are relative to the
+  // schedule begin of the loop. Only the port reservations and operators of the
+  // loop itself are recorded.
+  struct LoopSchedule {
+    int64_t latency = 0;
+    int64_t interval = 0;
+    EstimationResult::LoopInfo loopInfo;
+
+    MemPortTables memPortTables;
+    NumOperatorMap numOperatorMap;
+    llvm::StringMap<int64_t> totalNumOperatorMap;
+  };
+
+  // Incremental estimation states, including the recorded loop schedules, the
+  // latency and resource annotations of no_touch operations, and the dirty
+  // operations since the last estimation.
+  Operation *incrementalFunc = nullptr;
+  DenseMap<Operation *, LoopSchedule> loopSchedules;
+  DenseMap<Operation *, std::pair<int64_t, ResourceAttr>> noTouchAnnotations;
+  DenseSet<Operation *> dirtyOps;
+  bool isIncremental = false;
+  bool recordSchedules = false;
+
+  // Operations whose nested operations are not scheduled in the current
+  // estimation.
+  SmallPtrSet<Operation *, 16> skippedOps;
+
+  // The side table holding the estimation results of all operations.
+  DenseMap<Operation *, EstimationResult> results;
+  bool alwaysMaterialize = true;
+
+  // Store the operator name to latency/DSP usage/LUT usage mapping.
   llvm::StringMap<int64_t> &latencyMap;
   llvm::StringMap<int64_t> &dspUsageMap;
+  llvm::StringMap<int64_t> &lutUsageMap;
+
+  // Cache the dependence distances, which is shared with all forks.
+  std::shared_ptr<DepDistanceCache> depDistances =
+      std::make_shared<DepDistanceCache>();
 
   DominanceInfo DT;
   bool depAnalysis = true;
+  QoRCache *cache = nullptr;
 };
 
 } // namespace scalehls
@@ -7,25 +7,56 @@
 #ifndef SCALEHLS_TRANSFORMS_EXPLORER_H
 #define SCALEHLS_TRANSFORMS_EXPLORER_H
 
+#include "mlir/Analysis/CallGraph.h"
 #include "scalehls/Transforms/Estimator.h"
+#include <limits>
+#include <random>
 
 namespace mlir {
 namespace scalehls {
 
-using TileConfig = unsigned;
+/// A tile config is the mixed-radix encoding of the index of the tile size of
+/// each loop in a loop band, where the outermost loop is the least significant
+/// digit.
+using TileConfig = uint64_t;
+
+//===----------------------------------------------------------------------===//
+// DesignResource Class Declaration
+//===----------------------------------------------------------------------===//
+
+/// The resource utilization of a design point, which is also used to hold the
+/// resource budgets of the target device. Only resources modeled by the
+/// estimator are tracked.
+struct DesignResource {
+  DesignResource() = default;
+  explicit DesignResource(int64_t lut, int64_t dsp, int64_t bram)
+      : lut(lut), dsp(dsp), bram(bram) {}
+  explicit DesignResource(const EstimationResult::Resource &resource)
+      : lut(resource.getLut()), dsp(resource.getDsp()),
+        bram(resource.getBram()) {}
+
+  /// Return whether the resource utilization fits in the budget.
+  bool fitsIn(const DesignResource &budget) const {
+    return lut <= budget.lut && dsp <= budget.dsp && bram <= budget.bram;
+  }
+
+  int64_t lut = 0;
+  int64_t dsp = 0;
+  int64_t bram = 0;
+};
 
 //===----------------------------------------------------------------------===//
 // LoopDesignSpace Class Declaration
 //===----------------------------------------------------------------------===//
 
 struct LoopDesignPoint {
-  explicit LoopDesignPoint(int64_t latency, int64_t dspNum,
+  explicit LoopDesignPoint(int64_t latency, DesignResource resource,
                            TileConfig tileConfig, unsigned targetII)
-      : latency(latency), dspNum(dspNum), tileConfig(tileConfig),
+      : latency(latency), resource(resource), tileConfig(tileConfig),
         targetII(targetII) {}
 
   int64_t latency;
-  int64_t dspNum;
+  DesignResource resource;
 
   TileConfig tileConfig;
   unsigned targetII;
@@ -33,12 +64,20 @@ struct LoopDesignPoint {
   bool isActive = true;
 };
 
+class SearchStrategy;
+
 class LoopDesignSpace {
 public:
   explicit LoopDesignSpace(func::FuncOp func, AffineLoopBand &band,
-                           ScaleHLSEstimator &estimator, unsigned maxDspNum,
-                           unsigned maxExplParallel, unsigned maxLoopParallel,
-                           bool directiveOnly);
+                           ScaleHLSEstimator &estimator,
+                           MemoryOptsPipeline &pipeline,
+                           DesignResource maxResource, unsigned maxExplParallel,
+                           unsigned maxLoopParallel, bool directiveOnly);
+
+  /// Return whether the design space is successfully constructed. A loop band
+  /// with variable loop bounds or too many tile size combinations can't be
+  /// explored.
+  bool isValid() const { return valid; }
 
   /// Return the actual tile vector given a tile config.
   FactorList getTileList(TileConfig config);
@@ -46,24 +85,86 @@ public:
   /// Return the corresponding tile config given a tile list.
   TileConfig getTileConfig(FactorList tileList);
 
+  /// Return the index of the tile size of each loop given a tile config.
+  SmallVector<unsigned, 8> getTileIndices(TileConfig config);
+
+  /// Return the corresponding tile config given the index of the tile size of
+  /// each loop.
+  TileConfig getTileConfigFromIndices(ArrayRef<unsigned> tileIndices);
+
   /// Calculate the Euclid distance of config a and config b.
   float getTileConfigDistance(TileConfig configA, TileConfig configB);
 
+  /// Return whether the given tile config is in the design space, which means
+  /// its overall parallelism is within "maxExplParallel" and it meets the
+  /// constraint of "directiveOnly".
+  bool isValidTileConfig(TileConfig config);
+
+  /// Return the first valid tile config that is no smaller than "begin" and
+  /// whose overall parallelism is within "maxParallel". The tile configs out
+  /// of the parallelism bound are skipped in batches, thus the design space
+  /// can be enumerated lazily without iterating all tile size combinations.
+  Optional<TileConfig> getNextValidTileConfig(
+      TileConfig begin,
+      unsigned maxParallel = std::numeric_limits<unsigned>::max());
+
+  /// Return whether the given tile config is valid and not estimated yet.
+  bool isUnestimated(TileConfig config) {
+    return !estimatedTileConfigs.count(config) && isValidTileConfig(config);
+  }
+
+  /// Annotate the given tile config as estimated. Return false if the tile
+  /// config is invalid or has already been estimated.
+  bool markEstimated(TileConfig config) {
+    if (!isValidTileConfig(config))
+      return false;
+    return estimatedTileConfigs.insert(config).second;
+  }
+
+  /// Get a random valid tile config that has not been estimated. The remaining
+  /// valid tile configs are collected on the first call, and the estimated ones
+  /// are dropped lazily, such that each draw takes amortized constant time.
+  Optional<TileConfig> getRandomUnestimatedConfig(std::mt19937 &rng);
+
   /// Evaluate all design points under the given tile config.
   bool evaluateTileConfig(TileConfig config);
 
+  /// Evaluate the given tile config on "targetBand" located in "targetFunc"
+  /// with "targetEstimator" and "targetPipeline", and return all generated
+  /// design points in "points". This method does not touch the members of the
+  /// design space, so that it can be called from multiple threads on separate
+  /// function clones.
+  bool evaluateTileConfig(TileConfig config, func::FuncOp targetFunc,
+                          AffineLoopBand &targetBand,
+                          ScaleHLSEstimator &targetEstimator,
+                          MemoryOptsPipeline &targetPipeline,
+                          SmallVectorImpl<LoopDesignPoint> &points);
+
+  /// Evaluate all design points under the given tile configs. If "numThreads"
+  /// is larger than one, the tile configs are evaluated in parallel, where each
+  /// worker thread holds its own function clone and estimator.
+  void evaluateTileConfigs(ArrayRef<TileConfig> configs, unsigned numThreads);
+
   /// Initialize the design space.
-  void initializeLoopDesignSpace(unsigned maxInitParallel);
+  void initializeLoopDesignSpace(unsigned maxInitParallel,
+                                 unsigned numThreads = 1);
 
   /// Dump pareto and non-pareto points which have been evaluated in the design
   /// space to a csv output file.
   void dumpLoopDesignSpace(StringRef csvFilePath);
 
   /// Get a random tile config which is one of the closest neighbors of "point".
+  /// The neighbors are enumerated in the lattice of tile indices, thus the
+  /// complexity is proportional to the volume of the "maxDistance" ball rather
+  /// than the size of the design space.
   Optional<TileConfig> getRandomClosestNeighbor(LoopDesignPoint point,
-                                                float maxDistance);
+                                                float maxDistance,
+                                                std::mt19937 &rng);
 
-  void exploreLoopDesignSpace(unsigned maxIterNum, float maxDistance);
+  /// Explore the design space with the given search strategy until no tile
+  /// config is proposed or "maxEvalNum" tile configs have been evaluated.
+  void exploreLoopDesignSpace(SearchStrategy &strategy, unsigned maxEvalNum,
+                              unsigned numThreads = 1);
 
   /// Stores current pareto frontiers and all evaluated design points. The
   /// "allPoints" is mainly used for design space dumping, which is actually not
@@ -71,11 +172,13 @@ public:
   SmallVector<LoopDesignPoint, 16> paretoPoints;
   SmallVector<LoopDesignPoint, 16> allPoints;
 
-  /// Associated function, loop band, and estimator.
+  /// Associated function, loop band, estimator, and memory optimization
+  /// pipeline.
   func::FuncOp func;
   AffineLoopBand &band;
   ScaleHLSEstimator &estimator;
-  unsigned maxDspNum;
+  MemoryOptsPipeline &pipeline;
+  DesignResource maxResource;
 
   /// Records the trip count of each loop level.
   SmallVector<unsigned, 8> tripCountList;
@@ -86,49 +189,132 @@ public:
   std::vector<SmallVector<unsigned, 8>> validTileSizesList;
 
   /// Holds the total number of valid tile size combinations.
-  unsigned validTileConfigNum;
+  TileConfig validTileConfigNum;
+
+  /// Holds all tile configs that have been estimated. The design space itself
+  /// is not materialized, as it can be too large for deep loop bands.
+  llvm::DenseSet<TileConfig> estimatedTileConfigs;
 
-  /// Holds all tile configs that have not been estimated.
-  llvm::SmallDenseSet<TileConfig, 32> unestimatedTileConfigs;
+  /// Holds the valid tile configs that may not be estimated yet, which are only
+  /// collected once a random tile config is requested. The number of valid
+  /// tile configs is bounded by "maxExplParallel".
+  std::vector<TileConfig> remainingTileConfigs;
+  bool isRemainingCollected = false;
+
+  /// The maximum overall parallelism of the tile configs in the design space.
+  unsigned maxExplParallel;
 
   // Whether to include loop transformation into the loop design space.
   bool directiveOnly;
+
+  // Whether the design space is successfully constructed.
+  bool valid = true;
+};
+
+//===----------------------------------------------------------------------===//
+// SearchStrategy Class Declaration
+//===----------------------------------------------------------------------===//
+
+/// The strategy of searching a loop design space. In each iteration of the
+/// exploration, the strategy proposes unestimated tile configs to be evaluated
+/// based on the design points that have been evaluated in the design space.
+class SearchStrategy {
+public:
+  explicit SearchStrategy(unsigned seed) : rng(seed) {}
+  virtual ~SearchStrategy() = default;
+
+  /// Propose at most "maxNum" unestimated tile configs of "space" into
+  /// "configs". Proposing nothing indicates the search is terminated.
+  virtual void propose(LoopDesignSpace &space,
+                       SmallVectorImpl<TileConfig> &configs,
+                       unsigned maxNum) = 0;
+
+protected:
+  std::mt19937 rng;
 };
 
+/// Create a search strategy given its name, which can be "neighbor",
+/// "exhaustive", "annealing", "genetic", or "bayesian". Return nullptr if the
+/// name is unknown.
+std::unique_ptr<SearchStrategy>
+createSearchStrategy(StringRef name, unsigned seed, float maxDistance);
+
 //===----------------------------------------------------------------------===//
 // FuncDesignSpace Class Declaration
 //===----------------------------------------------------------------------===//
 
-/// Each function design point contains multiple loop design point.
+/// A design point of an explored sub-function, which is composed at the call
+/// sites of the sub-function in the exploration of its callers. The tile lists,
+/// target IIs, and the selected design points of nested sub-functions are used
+/// to apply the design point to the sub-function. The argument types of the
+/// sub-function under the design point are used to infer the array partitions
+/// of the callers.
+struct CalleeDesignPoint {
+  int64_t latency;
+  int64_t interval;
+  DesignResource resource;
+  SmallVector<Type, 4> argTypes;
+
+  std::vector<FactorList> tileLists;
+  SmallVector<unsigned, 4> targetIIs;
+  SmallVector<std::pair<StringRef, unsigned>, 4> calleeDesignPoints;
+};
+
+/// The pareto design points of an explored sub-function.
+struct CalleeDesignSpace {
+  SmallVector<CalleeDesignPoint, 16> paretoPoints;
+
+  /// The index of the design point that has been applied to the sub-function.
+  /// Once applied, the sub-function is fixed to this design point.
+  Optional<unsigned> appliedPoint;
+
+  /// A detached clone of the sub-function before any design point is applied.
+  /// If callers select design points other than the applied one, the
+  /// sub-function is specialized for them by cloning from it. The names of the
+  /// specialized sub-functions are indexed by their design points.
+  func::FuncOp originalFunc;
+  llvm::SmallDenseMap<unsigned, std::string, 4> specializedFuncs;
+};
+
+/// Map from the name of an explored sub-function to its design space.
+using CalleeDesignSpaces = llvm::StringMap<CalleeDesignSpace>;
+
+/// Each function design point contains multiple loop design point and the
+/// index of the selected design point of each explored sub-function.
 struct FuncDesignPoint {
-  explicit FuncDesignPoint(int64_t latency, int64_t dspNum)
-      : latency(latency), dspNum(dspNum) {}
+  explicit FuncDesignPoint(int64_t latency, DesignResource resource)
+      : latency(latency), resource(resource) {}
 
-  explicit FuncDesignPoint(int64_t latency, int64_t dspNum,
+  explicit FuncDesignPoint(int64_t latency, DesignResource resource,
                            LoopDesignPoint point)
-      : latency(latency), dspNum(dspNum) {
+      : latency(latency), resource(resource) {
     loopDesignPoints.push_back(point);
   }
 
-  explicit FuncDesignPoint(int64_t latency, int64_t dspNum,
+  explicit FuncDesignPoint(int64_t latency, DesignResource resource,
                            SmallVector<LoopDesignPoint, 4> &points)
-      : latency(latency), dspNum(dspNum) {
+      : latency(latency), resource(resource) {
     loopDesignPoints = points;
   }
 
   int64_t latency;
-  int64_t dspNum;
+  int64_t interval = -1;
+  DesignResource resource;
 
   SmallVector<LoopDesignPoint, 4> loopDesignPoints;
+  SmallVector<unsigned, 4> calleeDesignPoints;
 };
 
 class FuncDesignSpace {
 public:
   explicit FuncDesignSpace(func::FuncOp func,
                            SmallVector<LoopDesignSpace, 4> &loopDesignSpaces,
-                           ScaleHLSEstimator &estimator, unsigned maxDspNum)
+                           CalleeDesignSpaces &calleeSpaces,
+                           ScaleHLSEstimator &estimator,
+                           MemoryOptsPipeline &pipeline,
+                           DesignResource maxResource)
       : func(func), loopDesignSpaces(loopDesignSpaces), estimator(estimator),
-        maxDspNum(maxDspNum) {
+        pipeline(pipeline), maxResource(maxResource) {
     AffineLoopBands targetBands;
     getLoopBands(func.front(), targetBands);
 
@@ -136,8 +322,34 @@ public:
       targetLoops.push_back(band.front());
       band.front()->setAttr("no_touch", BoolAttr::get(func.getContext(), true));
     }
+
+    // Collect the call sites of all explored sub-functions.
+    llvm::StringMap<unsigned> calleeIndices;
+    func.walk([&](func::CallOp call) {
+      auto it = calleeSpaces.find(call.getCallee());
+      if (it == calleeSpaces.end())
+        return;
+
+      auto result = calleeIndices.try_emplace(call.getCallee(),
+                                              calleeDesignSpaces.size());
+      if (result.second) {
+        calleeNames.push_back(it->first());
+        calleeDesignSpaces.push_back(&it->second);
+        targetCalls.emplace_back();
+      }
+      targetCalls[result.first->second].push_back(call);
+    });
   }
 
+  /// Annotate the selected loop and sub-function design points of the given
+  /// function design point to the target loops and calls.
+  void annotateFuncDesignPoint(const FuncDesignPoint &point);
+
+  /// Apply the given function design point to a clone of the function and
+  /// return the clone, which should be erased by the caller. Return nullptr if
+  /// the design point fails to be applied.
+  func::FuncOp applyFuncDesignPoint(const FuncDesignPoint &point);
+
   void combLoopDesignSpaces();
 
   void dumpFuncDesignSpace(StringRef csvFilePath);
@@ -145,13 +357,21 @@ public:
 
   SmallVector<FuncDesignPoint, 16> paretoPoints;
 
-  /// Associated function, loop design spaces, and estimator.
+  /// Associated function, loop design spaces, estimator, and memory
+  /// optimization pipeline.
   func::FuncOp func;
   SmallVector<LoopDesignSpace, 4> &loopDesignSpaces;
   ScaleHLSEstimator &estimator;
-  unsigned maxDspNum;
+  MemoryOptsPipeline &pipeline;
+  DesignResource maxResource;
 
   SmallVector<AffineForOp, 4> targetLoops;
+
+  /// The name, design space, and all call sites of each explored sub-function
+  /// called in the function.
+  SmallVector<StringRef, 4> calleeNames;
+  SmallVector<CalleeDesignSpace *, 4> calleeDesignSpaces;
+  SmallVector<SmallVector<func::CallOp, 4>, 4> targetCalls;
 };
 
 //===----------------------------------------------------------------------===//
@@ -161,31 +381,72 @@ public:
 class ScaleHLSExplorer {
 public:
   explicit ScaleHLSExplorer(ScaleHLSEstimator &estimator, unsigned outputNum,
-                            unsigned maxDspNum, unsigned maxInitParallel,
-                            unsigned maxExplParallel, unsigned maxLoopParallel,
-                            unsigned maxIterNum, float maxDistance)
-      : estimator(estimator), outputNum(outputNum), maxDspNum(maxDspNum),
+                            DesignResource maxResource,
+                            unsigned maxInitParallel, unsigned maxExplParallel,
+                            unsigned maxLoopParallel, unsigned maxIterNum,
+                            float maxDistance, unsigned numThreads = 1,
+                            StringRef searchStrategy = "neighbor",
+                            unsigned searchSeed = 0)
+      : estimator(estimator), outputNum(outputNum), maxResource(maxResource),
         maxInitParallel(maxInitParallel), maxExplParallel(maxExplParallel),
         maxLoopParallel(maxLoopParallel), maxIterNum(maxIterNum),
-        maxDistance(maxDistance) {}
+        maxDistance(maxDistance), numThreads(numThreads),
+        searchStrategy(searchStrategy), searchSeed(searchSeed) {}
+  ScaleHLSExplorer(const ScaleHLSExplorer &) = delete;
+  ~ScaleHLSExplorer();
 
   bool emitQoRDebugInfo(func::FuncOp func, std::string message);
 
   bool evaluateFuncPipeline(func::FuncOp func);
   bool simplifyLoopNests(func::FuncOp func);
   bool optimizeLoopBands(func::FuncOp func, bool directiveOnly);
-  bool exploreDesignSpace(func::FuncOp func, bool directiveOnly,
-                          StringRef outputRootPath, StringRef csvRootPath);
 
-  void applyDesignSpaceExplore(func::FuncOp func, bool directiveOnly,
-                               StringRef outputRootPath, StringRef csvRootPath);
+  /// Explore the design space of "func". Return failure if any loop band of
+  /// "func" can't be explored.
+  LogicalResult exploreDesignSpace(func::FuncOp func, bool directiveOnly,
+                                   StringRef outputRootPath,
+                                   StringRef csvRootPath,
+                                   bool isSubFunc = false);
+
+  /// Annotate all calls in "tmpFunc", a detached clone of "func", with the
+  /// default design point of the explored sub-functions, such that the clone
+  /// can be estimated without looking up the callees. The calls of unexplored
+  /// sub-functions are annotated with their current estimation, where the
+  /// sub-functions are looked up from "func".
+  void annotateCallees(func::FuncOp tmpFunc, func::FuncOp func);
+
+  /// Apply the "index"-th design point of the explored sub-function "callee"
+  /// to the sub-function, which is looked up from "func". If the sub-function
+  /// has been applied with another design point selected by other callers, a
+  /// specialized sub-function is cloned for the calls in "func". The
+  /// post-tiling optimizations are applied with the pre-built "pipeline".
+  bool applyCalleeDesignPoint(func::FuncOp func, StringRef callee,
+                              unsigned index, MemoryOptsPipeline &pipeline);
+
+  LogicalResult applyDesignSpaceExplore(func::FuncOp func, bool directiveOnly,
+                                        StringRef outputRootPath,
+                                        StringRef csvRootPath,
+                                        bool isSubFunc = false);
+
+  /// Explore "topFunc" and all its sub-functions in a bottom-up order along
+  /// the call graph. The pareto design points of each sub-function are composed
+  /// at its call sites in the exploration of its callers.
+  LogicalResult applyHierarchicalDesignSpaceExplore(func::FuncOp topFunc,
+                                                    CallGraph &callGraph,
+                                                    bool directiveOnly,
+                                                    StringRef outputRootPath,
+                                                    StringRef csvRootPath);
 
   ScaleHLSEstimator &estimator;
 
+  // The design spaces of all explored sub-functions.
+  CalleeDesignSpaces calleeSpaces;
+
   // The number of pareto designs that will be generated.
   unsigned outputNum;
 
-  unsigned maxDspNum;
+  // The resource budgets of the target device.
+  DesignResource maxResource;
 
   // The maximum parallelism of the initiation and exploration of phase of DSE.
   unsigned maxInitParallel;
@@ -194,11 +455,19 @@ public:
   // The maximum parallelism of each loop.
   unsigned maxLoopParallel;
 
-  // The maximum iteration number of DSE.
+  // The maximum number of tile configs evaluated in the exploration of each
+  // loop design space, which is the evaluation budget of the search strategy.
   unsigned maxIterNum;
 
   // The maximum distance in the neighbor search of DSE.
   float maxDistance;
+
+  // The number of worker threads used for evaluating tile configs.
+  unsigned numThreads;
+
+  // The name and random seed of the search strategy of loop design spaces.
+  std::string searchStrategy;
+  unsigned searchSeed;
 };
 
 } // namespace scalehls
@@ -44,7 +44,8 @@ std::unique_ptr<Pass>
 createFuncPreprocessPass(std::string hlsTopFunc = "forward");
 
 /// Dataflow-related passes.
-std::unique_ptr<Pass> createBalanceDataflowNodePass();
+std::unique_ptr<Pass>
+createBalanceDataflowNodePass(bool multiBankBuffer = false);
 std::unique_ptr<Pass> createBufferizeDataflowPass();
 std::unique_ptr<Pass>
 createConvertDataflowToFuncPass(bool splitExternalAccess = true);
@@ -58,12 +59,18 @@ std::unique_ptr<Pass> createLegalizeDataflowPass();
 std::unique_ptr<Pass> createLowerDataflowPass(bool splitExternalAccess = true);
 std::unique_ptr<Pass> createParallelizeDataflowNodePass(
     unsigned loopUnrollFactor = 1, bool unrollPointLoopOnly = false,
-    bool complexityAware = true, bool correlationAware = true);
+    bool complexityAware = true, bool correlationAware = true,
+    bool throughputAware = false, unsigned maxDspNum = 220);
 std::unique_ptr<Pass>
 createPlaceDataflowBufferPass(unsigned threshold = 1024,
-                              bool placeExternalBuffer = true);
+                              bool placeExternalBuffer = true,
+                              bool resourceAware = false,
+                              std::string targetSpec = "");
 std::unique_ptr<Pass>
-createScheduleDataflowNodePass(bool ignoreViolations = false);
+createScheduleDataflowNodePass(bool ignoreViolations = false,
+                               unsigned maxNodesPerLevel = 0);
+std::unique_ptr<Pass> createSizeDataflowStreamPass(std::string targetSpec = "",
+                                                   unsigned numFrames = 4);
 std::unique_ptr<Pass> createStreamDataflowTaskPass();
 
 /// Tensor-related passes.
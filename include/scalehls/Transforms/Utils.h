@@ -7,6 +7,8 @@
 #ifndef SCALEHLS_TRANSFORMS_UTILS_H
 #define SCALEHLS_TRANSFORMS_UTILS_H
 
+#include "mlir/Pass/PassManager.h"
+#include "mlir/Rewrite/FrozenRewritePatternSet.h"
 #include "scalehls/Dialect/HLS/Utils.h"
 
 namespace mlir {
@@ -57,20 +59,68 @@ bool applyArrayPartition(Value array, ArrayRef<unsigned> factors,
 /// targeted function.
 bool applyAutoArrayPartition(func::FuncOp func, unsigned threhold = 128);
 
+/// Find the suitable array partition factors and kinds for all arrays accessed
+/// by the input loop band. The partition already applied to each array is
+/// considered as the lower bound of the new partition. Arrays not accessed in
+/// the loop band, sub-functions, and the function type are never updated.
+bool applyAutoArrayPartition(AffineLoopBand &band, unsigned threhold = 128);
+
 bool applyFuncPreprocess(func::FuncOp func, bool topFunc);
 
+/// Populate the patterns of simplifying affine if operations.
+void populateSimplifyAffineIfPatterns(RewritePatternSet &patterns);
+
+/// Populate the patterns of reducing the initial interval of loops.
+void populateReduceInitialIntervalPatterns(RewritePatternSet &patterns);
+
+/// Apply store to load forwarding, redundant load elimination, and unused store
+/// elimination to all operations nested in the "root" operation.
+bool applyAffineStoreForward(Operation *root);
+
+/// Hold a pre-built memory optimization pass pipeline and the rewrite patterns
+/// of the band-local memory optimizations, such that they can be repeatedly
+/// applied without being reconstructed. This is not thread-safe, each thread
+/// should hold its own instance.
+class MemoryOptsPipeline {
+public:
+  explicit MemoryOptsPipeline(MLIRContext *context);
+
+  /// Apply memory optimizations to the whole function.
+  bool apply(func::FuncOp func);
+
+  /// Apply memory optimizations only to the operations under the loop band.
+  bool apply(AffineLoopBand &band);
+
+private:
+  PassManager pm;
+  FrozenRewritePatternSet canonicalizePatterns;
+  FrozenRewritePatternSet reduceIIPatterns;
+};
+
 /// Apply memory optimizations.
 bool applyMemoryOpts(func::FuncOp func);
 
 /// Apply optimization strategy to a loop band. The ancestor function is also
 /// passed in because the post-tiling optimizations have to take function as
-/// target, e.g. canonicalizer and array partition.
+/// target, e.g. canonicalizer and array partition, which are applied with the
+/// pre-built "pipeline".
 bool applyOptStrategy(AffineLoopBand &band, func::FuncOp func,
-                      FactorList tileList, unsigned targetII);
-
-/// Apply optimization strategy to a function.
+                      FactorList tileList, unsigned targetII,
+                      MemoryOptsPipeline &pipeline);
+
+/// Apply optimization strategy to a loop band, where the post-tiling
+/// optimizations are only applied to the operations under the loop band with
+/// the pre-built "pipeline". The function type is not aligned with the updated
+/// argument types, which is left to the caller.
+bool applyBandOptStrategy(AffineLoopBand &band, func::FuncOp func,
+                          FactorList tileList, unsigned targetII,
+                          MemoryOptsPipeline &pipeline);
+
+/// Apply optimization strategy to a function, where the post-tiling
+/// optimizations are applied with the pre-built "pipeline".
 bool applyOptStrategy(func::FuncOp func, ArrayRef<FactorList> tileLists,
-                      ArrayRef<unsigned> targetIIs);
+                      ArrayRef<unsigned> targetIIs,
+                      MemoryOptsPipeline &pipeline);
 
 } // namespace scalehls
 } // namespace mlir
@@ -71,15 +71,22 @@ ComplexityAnalysis::calculateBlockComplexity(Block *block) const {
       auto thenComplexity = calculateBlockComplexity(ifOp.getThenBlock());
       if (!thenComplexity.has_value())
         return Optional<unsigned long>();
-      auto ifComplexity = thenComplexity.value();
 
+      unsigned long elseComplexity = 0;
       if (ifOp.hasElse()) {
-        auto elseComplexity = calculateBlockComplexity(ifOp.getElseBlock());
-        if (!elseComplexity.has_value())
+        auto optionalComplexity = calculateBlockComplexity(ifOp.getElseBlock());
+        if (!optionalComplexity.has_value())
           return Optional<unsigned long>();
-        ifComplexity = std::max(ifComplexity, elseComplexity.value());
+        elseComplexity = optionalComplexity.value();
       }
-      complexity += ifComplexity;
+
+      // Weight the two branches with the profiled branch probability if
+      // available. Otherwise, conservatively take the more complex branch.
+      if (auto thenProb = getProfiledThenProbability(ifOp))
+        complexity += std::lround(thenProb.value() * thenComplexity.value() +
+                                  (1 - thenProb.value()) * elseComplexity);
+      else
+        complexity += std::max(thenComplexity.value(), elseComplexity);
     }
     // else if (!op.hasTrait<OpTrait::IsTerminator>())
     //   complexity += 1;
@@ -87,6 +94,120 @@ ComplexityAnalysis::calculateBlockComplexity(Block *block) const {
   return complexity;
 }
 
+DataflowGraphAnalysis::DataflowGraphAnalysis(func::FuncOp func) {
+  func.walk([&](ScheduleOp schedule) {
+    unsigned order = 0;
+    for (auto node : schedule.getOps<NodeOp>()) {
+      addNode(node);
+      nodeOrderMap[node] = order++;
+    }
+    staleSchedules.erase(schedule);
+  });
+}
+
+/// A helper to get the users of a buffer except the given node.
+static SmallVector<NodeOp> getUsersExcept(ArrayRef<NodeOp> users,
+                                          NodeOp except) {
+  SmallVector<NodeOp> nodes;
+  for (auto node : users)
+    if (node != except)
+      nodes.push_back(node);
+  return nodes;
+}
+
+SmallVector<NodeOp>
+DataflowGraphAnalysis::getConsumersExcept(Value buffer, NodeOp except) const {
+  auto it = bufferUsersMap.find(buffer);
+  if (it == bufferUsersMap.end())
+    return {};
+  return getUsersExcept(it->second.consumers, except);
+}
+
+SmallVector<NodeOp>
+DataflowGraphAnalysis::getProducersExcept(Value buffer, NodeOp except) const {
+  auto it = bufferUsersMap.find(buffer);
+  if (it == bufferUsersMap.end())
+    return {};
+  return getUsersExcept(it->second.producers, except);
+}
+
+SmallVector<NodeOp> DataflowGraphAnalysis::getConsumers(Value buffer) const {
+  return getConsumersExcept(buffer, NodeOp());
+}
+
+SmallVector<NodeOp> DataflowGraphAnalysis::getProducers(Value buffer) const {
+  return getProducersExcept(buffer, NodeOp());
+}
+
+SmallVector<NodeOp>
+DataflowGraphAnalysis::getDependentConsumers(Value buffer, NodeOp node) const {
+  // If the buffer is defined outside of a dependence free schedule op, we can
+  // ignore back dependences.
+  bool ignoreBackDependence =
+      buffer.isa<BlockArgument>() && node.getScheduleOp().isDependenceFree();
+
+  SmallVector<NodeOp> nodes;
+  for (auto consumer : getConsumersExcept(buffer, node))
+    if (!ignoreBackDependence || isBefore(node, consumer))
+      nodes.push_back(consumer);
+  return nodes;
+}
+
+bool DataflowGraphAnalysis::isBefore(NodeOp a, NodeOp b) const {
+  auto schedule = a.getScheduleOp();
+  assert(schedule == b.getScheduleOp() && "nodes are not in the same schedule");
+  updateNodeOrder(schedule);
+  return nodeOrderMap.lookup(a) < nodeOrderMap.lookup(b);
+}
+
+void DataflowGraphAnalysis::updateNodeOrder(ScheduleOp schedule) const {
+  if (!staleSchedules.erase(schedule))
+    return;
+  unsigned order = 0;
+  for (auto node : schedule.getOps<NodeOp>())
+    nodeOrderMap[node] = order++;
+}
+
+void DataflowGraphAnalysis::addNode(NodeOp node) {
+  assert(!nodeBuffersMap.count(node) && "node is already in the graph");
+  auto &buffers = nodeBuffersMap[node];
+  for (auto &use : node->getOpOperands()) {
+    auto kind = node.getOperandKind(use);
+    if (kind == OperandKind::INPUT)
+      bufferUsersMap[use.get()].consumers.push_back(node);
+    else if (kind == OperandKind::OUTPUT)
+      bufferUsersMap[use.get()].producers.push_back(node);
+    else
+      continue;
+    buffers.push_back(use.get());
+  }
+  staleSchedules.insert(node.getScheduleOp());
+}
+
+void DataflowGraphAnalysis::removeNode(NodeOp node) {
+  auto it = nodeBuffersMap.find(node);
+  if (it == nodeBuffersMap.end())
+    return;
+
+  for (auto buffer : it->second) {
+    auto &users = bufferUsersMap[buffer];
+    llvm::erase_value(users.producers, node);
+    llvm::erase_value(users.consumers, node);
+  }
+  nodeBuffersMap.erase(it);
+  nodeOrderMap.erase(node);
+  staleSchedules.insert(node.getScheduleOp());
+}
+
+NodeOp DataflowGraphAnalysis::fuseNodes(ArrayRef<NodeOp> nodes,
+                                        PatternRewriter &rewriter) {
+  for (auto node : nodes)
+    removeNode(node);
+  auto newNode = fuseNodeOps(nodes, rewriter);
+  addNode(newNode);
+  return newNode;
+}
+
 static std::pair<SmallVector<int64_t>, SmallVector<int64_t>>
 getBufferIndexDepthsAndStrides(NodeOp node, Value buffer) {
   if (node.hasHierarchy() ||
@@ -429,7 +429,12 @@ LogicalResult NodeOp::verify() {
       if (isExtBuffer(output))
         continue;
 
-      if (getDependentConsumers(output, *this).size() > 1 ||
+      // Multi-bank buffers are read by consumers at different levels through
+      // input taps, which doesn't violate the single-consumer constraint.
+      auto buffer = output.getDefiningOp<BufferOp>();
+      bool isMultiBank = buffer && buffer.getDepth() > 1;
+
+      if ((!isMultiBank && getDependentConsumers(output, *this).size() > 1) ||
           getProducers(output).size() > 1) {
         auto diag = emitOpError(
             "legal schedule violates single-consumer or single-producer, ");
@@ -1381,6 +1386,54 @@ void hls::setLoopInfo(Operation *op, int64_t flattenTripCount,
   setLoopInfo(op, loopInfo);
 }
 
+/// Callee argument types attribute utils.
+SmallVector<Type, 4> hls::getCalleeArgTypes(Operation *op) {
+  SmallVector<Type, 4> argTypes;
+  if (auto attr = op->getAttrOfType<ArrayAttr>("callee_arg_types"))
+    for (auto type : attr.getAsValueRange<TypeAttr>())
+      argTypes.push_back(type);
+  return argTypes;
+}
+void hls::setCalleeArgTypes(Operation *op, TypeRange argTypes) {
+  SmallVector<Attribute, 4> attrs;
+  for (auto type : argTypes)
+    attrs.push_back(TypeAttr::get(type));
+  op->setAttr("callee_arg_types", ArrayAttr::get(op->getContext(), attrs));
+}
+
+/// Profiled trip count attribute utils.
+Optional<double> hls::getProfiledTripCount(Operation *op) {
+  if (auto attr = op->getAttrOfType<FloatAttr>("profile_trip_count"))
+    return attr.getValueAsDouble();
+  return Optional<double>();
+}
+void hls::setProfiledTripCount(Operation *op, double tripCount,
+                               int64_t maxTripCount,
+                               ArrayRef<int64_t> histogram) {
+  auto builder = Builder(op->getContext());
+  op->setAttr("profile_trip_count", builder.getF64FloatAttr(tripCount));
+  op->setAttr("profile_max_trip_count",
+              builder.getI64IntegerAttr(maxTripCount));
+  op->setAttr("profile_trip_count_hist",
+              builder.getDenseI64ArrayAttr(histogram));
+}
+void hls::removeProfiledTripCount(Operation *op) {
+  op->removeAttr("profile_trip_count");
+  op->removeAttr("profile_max_trip_count");
+  op->removeAttr("profile_trip_count_hist");
+}
+
+/// Profiled branch probability attribute utils.
+Optional<double> hls::getProfiledThenProbability(Operation *op) {
+  if (auto attr = op->getAttrOfType<FloatAttr>("profile_then_prob"))
+    return attr.getValueAsDouble();
+  return Optional<double>();
+}
+void hls::setProfiledThenProbability(Operation *op, double probability) {
+  op->setAttr("profile_then_prob",
+              Builder(op->getContext()).getF64FloatAttr(probability));
+}
+
 //===----------------------------------------------------------------------===//
 // HLS directive attributes
 //===----------------------------------------------------------------------===//
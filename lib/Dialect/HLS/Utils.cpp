@@ -241,10 +241,11 @@ SmallVector<NodeOp> scalehls::getDependentConsumers(Value buffer, NodeOp node) {
   bool ignoreBackDependence =
       buffer.isa<BlockArgument>() && node.getScheduleOp().isDependenceFree();
 
-  DominanceInfo domInfo;
+  // All the consumers are located in the same block as the node, thus the
+  // dominance is simply the order of operations in the block.
   SmallVector<NodeOp> nodes;
   for (auto consumer : getConsumersExcept(buffer, node))
-    if (!ignoreBackDependence || domInfo.properlyDominates(node, consumer))
+    if (!ignoreBackDependence || node->isBeforeInBlock(consumer))
       nodes.push_back(consumer);
   return nodes;
 }
@@ -766,6 +767,12 @@ bool scalehls::crossRegionDominates(Operation *a, Operation *b) {
   while (a->getParentOp() && !a->getParentOp()->isAncestor(b))
     a = a->getParentOp();
   assert(a->getParentOp() && "reach top-level module op");
+
+  // If "b" has an ancestor in the same block as "a", we can directly check the
+  // operation order in the block without constructing the dominance info.
+  if (!isa<ModuleOp>(a->getParentOp()))
+    if (auto bAncestor = a->getBlock()->findAncestorOpInBlock(*b))
+      return a == bAncestor || a->isBeforeInBlock(bAncestor);
   return DominanceInfo().dominates(a, b);
 }
 
@@ -1068,6 +1075,10 @@ void scalehls::getArrays(Block &block, SmallVectorImpl<Value> &arrays,
 Optional<unsigned> scalehls::getAverageTripCount(AffineForOp forOp) {
   if (auto optionalTripCount = getConstantTripCount(forOp))
     return optionalTripCount.value();
+  else if (auto profiledTripCount = getProfiledTripCount(forOp))
+    // The trip count profiled on the host is exact for variable-bound loops,
+    // such as triangular loops, and thus is preferred if available.
+    return (unsigned)std::lround(profiledTripCount.value());
   else {
     // TODO: A temporary approach to estimate the trip count. For now, we take
     // the average of the upper bound and lower bound of trip count as the
@@ -5,6 +5,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "mlir/Transforms/GreedyPatternRewriteDriver.h"
+#include "scalehls/Dialect/HLS/Analysis.h"
 #include "scalehls/Transforms/Passes.h"
 #include "scalehls/Transforms/Utils.h"
 
@@ -14,7 +15,10 @@ using namespace hls;
 
 namespace {
 struct InsertCopyNode : public OpRewritePattern<NodeOp> {
-  using OpRewritePattern<NodeOp>::OpRewritePattern;
+  InsertCopyNode(MLIRContext *context, DataflowGraphAnalysis &graph,
+                 bool multiBankBuffer)
+      : OpRewritePattern<NodeOp>(context), graph(graph),
+        multiBankBuffer(multiBankBuffer) {}
 
   LogicalResult matchAndRewrite(NodeOp node,
                                 PatternRewriter &rewriter) const override {
@@ -27,7 +31,7 @@ struct InsertCopyNode : public OpRewritePattern<NodeOp> {
         continue;
 
       SmallVector<std::pair<unsigned, NodeOp>, 4> worklist;
-      for (auto consumer : getDependentConsumers(output, node)) {
+      for (auto consumer : graph.getDependentConsumers(output, node)) {
         auto diff = node.getLevel().value() - consumer.getLevel().value();
         if (diff > 1)
           worklist.push_back({diff, consumer});
@@ -39,14 +43,15 @@ struct InsertCopyNode : public OpRewritePattern<NodeOp> {
       llvm::sort(worklist, [](auto a, auto b) { return a.first > b.first; });
       auto maxDiff = worklist.front().first;
 
-      // If the output is written to a DRAM buffer allocated inside of the
-      // schedule, then we can set the depth of the DRAM buffer and use taps to
-      // access the data. In this way, we no longer need to allocate multiple
-      // buffers and construct explicit copy to move data. Instead, we can
-      // implement the ping-pong buffer in DRAM that saves the memory interface
-      // and logic resources.
+      // If the output is written to a buffer allocated inside of the schedule,
+      // then we can set the depth of the buffer and use taps to access the
+      // data. In this way, we no longer need to allocate multiple buffers and
+      // construct explicit copy to move data. Instead, we can implement the
+      // ping-pong buffer in DRAM that saves the memory interface and logic
+      // resources. An on-chip buffer is emitted as a multi-bank buffer, where
+      // each consumer accesses its bank through the input tap.
       if (auto buffer = output.getDefiningOp<BufferOp>())
-        if (isExtBuffer(output)) {
+        if (isExtBuffer(output) || multiBankBuffer) {
           buffer.setDepthAttr(rewriter.getI32IntegerAttr(maxDiff));
           for (auto item : worklist) {
             auto consumer = item.second;
@@ -78,6 +83,7 @@ struct InsertCopyNode : public OpRewritePattern<NodeOp> {
         auto block = rewriter.createBlock(&newNode.getBody());
         block->addArguments(TypeRange({currentBuf.getType(), newBuf.getType()}),
                             {currentBuf.getLoc(), newBuf.getLoc()});
+        graph.addNode(newNode);
 
         // Create an explicit copy operation.
         rewriter.setInsertionPointToStart(block);
@@ -91,6 +97,8 @@ struct InsertCopyNode : public OpRewritePattern<NodeOp> {
         output.replaceUsesWithIf(newBuf, [&](OpOperand &use) {
           return consumers.count(use.getOwner());
         });
+        for (auto consumer : consumers)
+          graph.updateNode(cast<NodeOp>(consumer));
 
         // Finally, we can update current buffer and current node.
         currentBuf = newBuf;
@@ -99,23 +107,35 @@ struct InsertCopyNode : public OpRewritePattern<NodeOp> {
     }
     return success();
   }
+
+private:
+  DataflowGraphAnalysis &graph;
+  bool multiBankBuffer;
 };
 } // namespace
 
 namespace {
 struct BalanceDataflowNode
     : public BalanceDataflowNodeBase<BalanceDataflowNode> {
+  BalanceDataflowNode() = default;
+  explicit BalanceDataflowNode(bool argMultiBankBuffer) {
+    multiBankBuffer = argMultiBankBuffer;
+  }
+
   void runOnOperation() override {
     auto func = getOperation();
     auto context = func.getContext();
 
+    auto &graph = getAnalysis<DataflowGraphAnalysis>();
+
     mlir::RewritePatternSet patterns(context);
-    patterns.add<InsertCopyNode>(context);
+    patterns.add<InsertCopyNode>(context, graph, multiBankBuffer);
     (void)applyPatternsAndFoldGreedily(func, std::move(patterns));
   }
 };
 } // namespace
 
-std::unique_ptr<Pass> scalehls::createBalanceDataflowNodePass() {
-  return std::make_unique<BalanceDataflowNode>();
+std::unique_ptr<Pass>
+scalehls::createBalanceDataflowNodePass(bool multiBankBuffer) {
+  return std::make_unique<BalanceDataflowNode>(multiBankBuffer);
 }
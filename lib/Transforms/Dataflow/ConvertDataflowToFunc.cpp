@@ -160,12 +160,14 @@ struct InlineSchedule : public OpRewritePattern<ScheduleOp> {
       else if (auto loop =
                    dyn_cast<mlir::AffineForOp>(schedule->getParentOp())) {
         // If the schedule is located inside of a loop nest, try to coalesce
-        // them into a flattened loop.
+        // them into a flattened loop, whose profiled trip count is stale.
         AffineLoopBand band;
         getLoopBandFromInnermost(loop, band);
         auto dataflowLoop = loop;
-        if (isPerfectlyNested(band) && succeeded(coalesceLoops(band)))
+        if (isPerfectlyNested(band) && succeeded(coalesceLoops(band))) {
           dataflowLoop = band.front();
+          removeProfiledTripCount(dataflowLoop);
+        }
         setLoopDirective(dataflowLoop, /*pipeline=*/false, /*targetII=*/1,
                          /*dataflow=*/true, /*flattern=*/false);
       }
@@ -200,10 +202,18 @@ struct ConvertNodeToFunc : public OpRewritePattern<NodeOp> {
     rewriter.setInsertionPointToEnd(&subFunc.front());
     rewriter.create<func::ReturnOp>(rewriter.getUnknownLoc());
 
-    // Replace original with a function call.
+    // Replace original with a function call. The input taps are kept if the
+    // node reads any on-chip multi-bank buffer, such that the bank of each
+    // consumer can be selected when the buffer is emitted.
     rewriter.setInsertionPoint(node);
-    rewriter.replaceOpWithNewOp<func::CallOp>(node, subFunc,
+    auto call = rewriter.create<func::CallOp>(node.getLoc(), subFunc,
                                               node.getOperands());
+    if (llvm::any_of(node.getInputs(), [](Value input) {
+          auto buffer = input.getDefiningOp<BufferOp>();
+          return buffer && buffer.getDepth() > 1 && !isExtBuffer(input);
+        }))
+      call->setAttr("inputTaps", node.getInputTapsAttr());
+    rewriter.replaceOp(node, call.getResults());
     return success();
   }
 
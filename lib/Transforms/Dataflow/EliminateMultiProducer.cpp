@@ -4,9 +4,9 @@
 //
 //===----------------------------------------------------------------------===//
 
-#include "mlir/IR/Dominance.h"
 #include "mlir/IR/IntegerSet.h"
 #include "mlir/Transforms/GreedyPatternRewriteDriver.h"
+#include "scalehls/Dialect/HLS/Analysis.h"
 #include "scalehls/Transforms/Passes.h"
 #include "scalehls/Transforms/Utils.h"
 
@@ -16,11 +16,11 @@ using namespace hls;
 
 namespace {
 struct BufferMultiProducer : public OpRewritePattern<ScheduleOp> {
-  using OpRewritePattern<ScheduleOp>::OpRewritePattern;
+  BufferMultiProducer(MLIRContext *context, DataflowGraphAnalysis &graph)
+      : OpRewritePattern<ScheduleOp>(context), graph(graph) {}
 
   LogicalResult matchAndRewrite(ScheduleOp schedule,
                                 PatternRewriter &rewriter) const override {
-    DominanceInfo DT(schedule);
     auto loc = rewriter.getUnknownLoc();
     bool hasChanged = false;
 
@@ -29,16 +29,15 @@ struct BufferMultiProducer : public OpRewritePattern<ScheduleOp> {
       buffers.push_back(bufferOp);
 
     for (auto buffer : buffers) {
-      SmallVector<NodeOp, 4> producers(getProducers(buffer));
+      SmallVector<NodeOp, 4> producers(graph.getProducers(buffer));
       if (producers.size() <= 1)
         continue;
       hasChanged = true;
 
       // Drop the dominating/leading producer, which doesn't need to be
       // transformed.
-      llvm::sort(producers, [&](NodeOp a, NodeOp b) {
-        return DT.properlyDominates(b, a);
-      });
+      llvm::sort(producers,
+                 [&](NodeOp a, NodeOp b) { return graph.isBefore(b, a); });
       producers.pop_back();
 
       for (auto node : producers) {
@@ -55,11 +54,17 @@ struct BufferMultiProducer : public OpRewritePattern<ScheduleOp> {
                          node.getOutputs().begin() + node.getNumInputs();
         node.setOperand(bufferIdx, newBuffer);
 
+        llvm::SetVector<NodeOp> users;
         buffer.replaceUsesWithIf(newBuffer, [&](OpOperand &use) {
           if (auto user = dyn_cast<NodeOp>(use.getOwner()))
-            return DT.properlyDominates(node, user);
+            if (graph.isBefore(node, user)) {
+              users.insert(user);
+              return true;
+            }
           return false;
         });
+        for (auto user : users)
+          graph.updateNode(user);
 
         // Create a new node and erase the original one.
         auto newNode = rewriter.create<NodeOp>(
@@ -67,6 +72,8 @@ struct BufferMultiProducer : public OpRewritePattern<ScheduleOp> {
             newInputTaps, node.getLevelAttr());
         rewriter.inlineRegionBefore(node.getBody(), newNode.getBody(),
                                     newNode.getBody().end());
+        graph.removeNode(node);
+        graph.addNode(newNode);
         rewriter.eraseOp(node);
 
         // Insert new arguments for the original buffer.
@@ -154,16 +161,19 @@ struct BufferMultiProducer : public OpRewritePattern<ScheduleOp> {
     }
     return success(hasChanged);
   }
+
+private:
+  DataflowGraphAnalysis &graph;
 };
 } // namespace
 
 namespace {
 struct MergeMultiProducer : public OpRewritePattern<ScheduleOp> {
-  using OpRewritePattern<ScheduleOp>::OpRewritePattern;
+  MergeMultiProducer(MLIRContext *context, DataflowGraphAnalysis &graph)
+      : OpRewritePattern<ScheduleOp>(context), graph(graph) {}
 
   LogicalResult matchAndRewrite(ScheduleOp schedule,
                                 PatternRewriter &rewriter) const override {
-    DominanceInfo DT(schedule);
     bool hasChanged = false;
 
     SmallVector<Value> externalBuffers;
@@ -171,13 +181,12 @@ struct MergeMultiProducer : public OpRewritePattern<ScheduleOp> {
       externalBuffers.push_back(arg);
 
     for (auto buffer : externalBuffers) {
-      SmallVector<NodeOp> producers(getProducers(buffer));
+      SmallVector<NodeOp> producers(graph.getProducers(buffer));
       if (producers.size() <= 1)
         continue;
 
-      llvm::sort(producers, [&](NodeOp a, NodeOp b) {
-        return DT.properlyDominates(a, b);
-      });
+      llvm::sort(producers,
+                 [&](NodeOp a, NodeOp b) { return graph.isBefore(a, b); });
 
       auto allNodes = SmallVector<NodeOp>(schedule.getOps<NodeOp>().begin(),
                                           schedule.getOps<NodeOp>().end());
@@ -187,11 +196,14 @@ struct MergeMultiProducer : public OpRewritePattern<ScheduleOp> {
           }))
         continue;
 
-      fuseNodeOps(producers, rewriter);
+      graph.fuseNodes(producers, rewriter);
       hasChanged = true;
     }
     return success(hasChanged);
   }
+
+private:
+  DataflowGraphAnalysis &graph;
 };
 } // namespace
 
@@ -202,9 +214,11 @@ struct EliminateMultiProducer
     auto func = getOperation();
     auto context = func.getContext();
 
+    auto &graph = getAnalysis<DataflowGraphAnalysis>();
+
     mlir::RewritePatternSet patterns(context);
-    patterns.add<BufferMultiProducer>(context);
-    patterns.add<MergeMultiProducer>(context);
+    patterns.add<BufferMultiProducer>(context, graph);
+    patterns.add<MergeMultiProducer>(context, graph);
     (void)applyPatternsAndFoldGreedily(func, std::move(patterns));
   }
 };
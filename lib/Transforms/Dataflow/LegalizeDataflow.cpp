@@ -4,8 +4,8 @@
 //
 //===----------------------------------------------------------------------===//
 
-#include "mlir/IR/Dominance.h"
 #include "mlir/Transforms/GreedyPatternRewriteDriver.h"
+#include "scalehls/Dialect/HLS/Analysis.h"
 #include "scalehls/Transforms/Passes.h"
 #include "scalehls/Transforms/Utils.h"
 
@@ -13,21 +13,23 @@ using namespace mlir;
 using namespace scalehls;
 using namespace hls;
 
-static void collectNodes(llvm::SmallDenseSet<NodeOp> const &allNodes,
+static void collectNodes(DataflowGraphAnalysis const &graph,
+                         llvm::SmallDenseSet<NodeOp> const &allNodes,
                          llvm::SmallDenseSet<NodeOp> &visitedNodes,
                          SmallVector<NodeOp> &nodesToMerge, NodeOp node) {
   if (!visitedNodes.insert(node).second)
     return;
   nodesToMerge.push_back(node);
   for (auto input : node.getInputs())
-    for (auto consumer : getConsumersExcept(input, node))
+    for (auto consumer : graph.getConsumersExcept(input, node))
       if (allNodes.count(consumer))
-        collectNodes(allNodes, visitedNodes, nodesToMerge, consumer);
+        collectNodes(graph, allNodes, visitedNodes, nodesToMerge, consumer);
 }
 
 namespace {
 struct FuseMultiConsumer : public OpRewritePattern<ScheduleOp> {
-  using OpRewritePattern<ScheduleOp>::OpRewritePattern;
+  FuseMultiConsumer(MLIRContext *context, DataflowGraphAnalysis &graph)
+      : OpRewritePattern<ScheduleOp>(context), graph(graph) {}
 
   LogicalResult matchAndRewrite(ScheduleOp schedule,
                                 PatternRewriter &rewriter) const override {
@@ -42,7 +44,6 @@ struct FuseMultiConsumer : public OpRewritePattern<ScheduleOp> {
 
     // Merge nodes at the same level if they share the same input (to remove
     // multi-consumer violation).
-    DominanceInfo domInfo;
     bool hasChanged = false;
     for (const auto &p : levelToNodesMap) {
       // llvm::outs() << p.first << "\n";
@@ -53,7 +54,7 @@ struct FuseMultiConsumer : public OpRewritePattern<ScheduleOp> {
         if (visitedNodes.count(node))
           continue;
         SmallVector<NodeOp> nodesToMerge;
-        collectNodes(p.second, visitedNodes, nodesToMerge, node);
+        collectNodes(graph, p.second, visitedNodes, nodesToMerge, node);
         if (nodesToMerge.size() > 1)
           worklist.push_back(nodesToMerge);
       }
@@ -61,8 +62,8 @@ struct FuseMultiConsumer : public OpRewritePattern<ScheduleOp> {
       for (auto nodesToMerge : worklist) {
         // llvm::outs() << "merged " << nodesToMerge.size() << "\n";
         llvm::sort(nodesToMerge,
-                   [&](NodeOp a, NodeOp b) { return domInfo.dominates(a, b); });
-        auto newNode = fuseNodeOps(nodesToMerge, rewriter);
+                   [&](NodeOp a, NodeOp b) { return graph.isBefore(a, b); });
+        auto newNode = graph.fuseNodes(nodesToMerge, rewriter);
         newNode.setLevelAttr(rewriter.getI32IntegerAttr(p.first));
         hasChanged = true;
       }
@@ -70,10 +71,14 @@ struct FuseMultiConsumer : public OpRewritePattern<ScheduleOp> {
     // schedule.setIsLegalAttr(rewriter.getUnitAttr());
     return success(hasChanged);
   }
+
+private:
+  DataflowGraphAnalysis &graph;
 };
 } // namespace
 
 static void collectBypassNodes(
+    DataflowGraphAnalysis const &graph,
     llvm::SmallDenseMap<unsigned, llvm::SmallDenseSet<NodeOp>> const &map,
     llvm::SmallDenseSet<unsigned> &mergedLevels,
     SmallVector<NodeOp> &nodesToMerge, unsigned targetLevel) {
@@ -92,9 +97,13 @@ static void collectBypassNodes(
         continue;
 
       SmallVector<std::pair<unsigned, NodeOp>, 4> bypassNodes;
-      for (auto consumer : getDependentConsumers(output, node)) {
+      for (auto consumer : graph.getDependentConsumers(output, node)) {
+        // Consumers that access a multi-bank buffer through input taps have
+        // been balanced and are not considered as bypass nodes.
+        auto idx = llvm::find(consumer.getInputs(), output) -
+                   consumer.getInputs().begin();
         auto diff = node.getLevel().value() - consumer.getLevel().value();
-        if (diff > 1)
+        if (diff > 1 + consumer.getInputTap(idx))
           bypassNodes.push_back({diff, consumer});
       }
       if (bypassNodes.empty())
@@ -114,13 +123,14 @@ static void collectBypassNodes(
     // llvm::outs() << "---------- " << level << "\n";
     for (auto node : map.lookup(level))
       nodesToMerge.push_back(node);
-    collectBypassNodes(map, mergedLevels, nodesToMerge, level);
+    collectBypassNodes(graph, map, mergedLevels, nodesToMerge, level);
   }
 }
 
 namespace {
 struct FuseBypassPath : public OpRewritePattern<ScheduleOp> {
-  using OpRewritePattern<ScheduleOp>::OpRewritePattern;
+  FuseBypassPath(MLIRContext *context, DataflowGraphAnalysis &graph)
+      : OpRewritePattern<ScheduleOp>(context), graph(graph) {}
 
   LogicalResult matchAndRewrite(ScheduleOp schedule,
                                 PatternRewriter &rewriter) const override {
@@ -144,24 +154,27 @@ struct FuseBypassPath : public OpRewritePattern<ScheduleOp> {
         continue;
       // llvm::outs() << "\n========== " << level << "\n";
       SmallVector<NodeOp> nodesToMerge;
-      collectBypassNodes(levelToNodesMap, mergedLevels, nodesToMerge, level);
+      collectBypassNodes(graph, levelToNodesMap, mergedLevels, nodesToMerge,
+                         level);
       if (nodesToMerge.size() > 1)
         worklist.push_back(nodesToMerge);
     }
 
     bool hasChanged = false;
-    DominanceInfo domInfo;
     for (auto nodesToMerge : worklist) {
       // llvm::outs() << "merged " << nodesToMerge.size() << "\n";
       llvm::sort(nodesToMerge,
-                 [&](NodeOp a, NodeOp b) { return domInfo.dominates(a, b); });
-      auto newNode = fuseNodeOps(nodesToMerge, rewriter);
-      newNode.setLevelAttr(
-          rewriter.getI32IntegerAttr(nodesToMerge.front().getLevel().value()));
+                 [&](NodeOp a, NodeOp b) { return graph.isBefore(a, b); });
+      auto level = nodesToMerge.front().getLevel().value();
+      auto newNode = graph.fuseNodes(nodesToMerge, rewriter);
+      newNode.setLevelAttr(rewriter.getI32IntegerAttr(level));
       hasChanged = true;
     }
     return success(hasChanged);
   }
+
+private:
+  DataflowGraphAnalysis &graph;
 };
 } // namespace
 
@@ -192,10 +205,12 @@ struct LegalizeDataflow : public LegalizeDataflowBase<LegalizeDataflow> {
     auto func = getOperation();
     auto context = func.getContext();
 
+    auto &graph = getAnalysis<DataflowGraphAnalysis>();
+
     // Fuse multi consumer and bypass path dataflow nodes.
     mlir::RewritePatternSet patterns(context);
-    patterns.add<FuseMultiConsumer>(context);
-    patterns.add<FuseBypassPath>(context);
+    patterns.add<FuseMultiConsumer>(context, graph);
+    patterns.add<FuseBypassPath>(context, graph);
     auto frozenPatterns = FrozenRewritePatternSet(std::move(patterns));
 
     func.walk([&](ScheduleOp schedule) {
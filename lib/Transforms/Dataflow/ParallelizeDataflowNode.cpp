@@ -9,8 +9,10 @@
 #include "mlir/Dialect/Affine/Utils.h"
 #include "mlir/Transforms/GreedyPatternRewriteDriver.h"
 #include "scalehls/Dialect/HLS/Analysis.h"
+#include "scalehls/Transforms/Estimator.h"
 #include "scalehls/Transforms/Passes.h"
 #include "scalehls/Transforms/Utils.h"
+#include "llvm/ADT/TypeSwitch.h"
 #include "llvm/Support/Debug.h"
 
 #define DEBUG_TYPE "parallelize-dataflow-node"
@@ -42,6 +44,41 @@ static bool applyLoopVectorization(AffineLoopBand &band,
   return true;
 }
 
+/// Return the DSP usage of one iteration of the given dataflow node, where the
+/// operators are characterized in the same way as the QoR estimator.
+static int64_t getNodeDspUsage(NodeOp node,
+                               llvm::StringMap<int64_t> &dspUsageMap) {
+  int64_t dspNum = 0;
+  node.walk([&](Operation *op) {
+    auto keyName = llvm::TypeSwitch<Operation *, StringRef>(op)
+                       .Case<arith::AddFOp, arith::SubFOp>(
+                           [](auto) { return "fadd"; })
+                       .Case<arith::MulFOp>([](auto) { return "fmul"; })
+                       .Case<arith::DivFOp>([](auto) { return "fdiv"; })
+                       .Case<arith::CmpFOp>([](auto) { return "fcmp"; })
+                       .Case<math::ExpOp>([](auto) { return "fexp"; })
+                       .Default([](auto) { return ""; });
+    if (!keyName.empty())
+      dspNum += dspUsageMap.lookup(keyName);
+  });
+  return dspNum;
+}
+
+/// Scale the given unroll factor with the "increase" and "decrease" hints
+/// attached to the schedule.
+// FIXME: A hacky method to hand tune the factors and resolve outstanding
+// dataflow nodes.
+static unsigned long applyScheduleFactorHints(ScheduleOp schedule,
+                                              unsigned long factor) {
+  if (auto attr = schedule->getAttr("increase"))
+    if (auto annoFactor = attr.dyn_cast<IntegerAttr>())
+      factor *= annoFactor.getInt();
+  if (auto attr = schedule->getAttr("decrease"))
+    if (auto annoFactor = attr.dyn_cast<IntegerAttr>())
+      factor /= annoFactor.getInt();
+  return factor;
+}
+
 namespace {
 struct GenerateBufferLayout
     : public OpInterfaceRewritePattern<VectorTransferOpInterface> {
@@ -84,11 +121,102 @@ struct ParallelizeDataflowNode
     : public ParallelizeDataflowNodeBase<ParallelizeDataflowNode> {
   ParallelizeDataflowNode() = default;
   ParallelizeDataflowNode(unsigned loopUnrollFactor, bool unrollPointLoopOnly,
-                          bool argComplexityAware, bool argCorrelationAware) {
+                          bool argComplexityAware, bool argCorrelationAware,
+                          bool argThroughputAware, unsigned argMaxDspNum) {
     maxUnrollFactor = loopUnrollFactor;
     pointLoopOnly = unrollPointLoopOnly;
     complexityAware = argComplexityAware;
     correlationAware = argCorrelationAware;
+    throughputAware = argThroughputAware;
+    maxDspNum = argMaxDspNum;
+  }
+
+  /// Explore the unroll factors of all leaf dataflow nodes to minimize the
+  /// maximum node II under the DSP budget. The II of each node is approximated
+  /// as its complexity divided by its unroll factor rather than estimated with
+  /// the QoR estimator, and the DSP usage of each node is proportional to its
+  /// unroll factor. Each time, the unroll factor of the bottleneck node is
+  /// doubled, until the bottleneck node can't be further parallelized. Nodes
+  /// with hierarchy are not parallelized by themselves. Finally, the factors
+  /// are scaled with the hints of the parent schedules.
+  void getThroughputAwareParallelFactorMap(func::FuncOp func) {
+    auto compAnal = ComplexityAnalysis(func);
+    nodeParallelFactorMap.clear();
+
+    // The DSP usage of each operator is based on Xilinx PYNQ-Z1 board.
+    llvm::json::Object config{{"dsp_usage", llvm::json::Object()}};
+    llvm::StringMap<int64_t> dspUsageMap;
+    getDspUsageMap(&config, dspUsageMap);
+
+    struct NodeKnob {
+      NodeOp node;
+      unsigned long complexity;
+      int64_t dspUsage;
+      unsigned long maxFactor;
+      unsigned long factor;
+
+      unsigned long getII() const {
+        return (complexity + factor - 1) / factor;
+      }
+    };
+    SmallVector<NodeKnob> knobs;
+    int64_t dspNum = 0;
+
+    auto result = func.walk([&](NodeOp node) {
+      if (node.hasHierarchy()) {
+        nodeParallelFactorMap.insert({node, 1});
+        return WalkResult::advance();
+      }
+
+      auto nodeComplexity = compAnal.getNodeComplexity(node);
+      if (!nodeComplexity.has_value()) {
+        node.emitOpError("failed to get node complexity");
+        return WalkResult::interrupt();
+      }
+
+      // The unroll factor can't exceed the overall trip count of the node.
+      unsigned long maxFactor = 1;
+      for (auto loop : getNodeLoopBand(node))
+        if (auto tripCount = getConstantTripCount(loop))
+          maxFactor *= tripCount.value();
+
+      auto dspUsage = getNodeDspUsage(node, dspUsageMap);
+      knobs.push_back({node, nodeComplexity.value(), dspUsage, maxFactor, 1});
+      dspNum += dspUsage;
+      return WalkResult::advance();
+    });
+    if (result.wasInterrupted())
+      return;
+
+    while (!knobs.empty()) {
+      auto bottleneck = llvm::max_element(knobs, [](auto &a, auto &b) {
+        return a.getII() < b.getII();
+      });
+      auto newDspNum = dspNum + bottleneck->dspUsage * bottleneck->factor;
+      if (bottleneck->factor * 2 > bottleneck->maxFactor ||
+          newDspNum > (int64_t)maxDspNum.getValue())
+        break;
+
+      dspNum = newDspNum;
+      bottleneck->factor *= 2;
+    }
+
+    for (auto &knob : knobs) {
+      auto schedule = knob.node->getParentOfType<ScheduleOp>();
+      knob.factor = std::clamp(applyScheduleFactorHints(schedule, knob.factor),
+                               1UL, knob.maxFactor);
+      nodeParallelFactorMap.insert({knob.node, knob.factor});
+      LLVM_DEBUG(
+          // clang-format off
+          llvm::dbgs() << "\nNode Complexity: " << knob.complexity << "\n";
+          llvm::dbgs() << "Node Factor: " << knob.factor << "\n";
+          llvm::dbgs() << "Node II: " << knob.getII() << "\n";
+          llvm::dbgs() << "Node at " << knob.node.getLoc() << ": \n"
+                       << knob.node << "\n";
+          // clang-format on
+      );
+    }
+    LLVM_DEBUG(llvm::dbgs() << "\nDSP Usage: " << dspNum << "\n";);
   }
 
   /// Try to calculate the unroll factors of the nodes contained in each
@@ -104,15 +232,8 @@ struct ParallelizeDataflowNode
           parentNode.emitOpError("failed to get parent node's unroll factor");
           return WalkResult::interrupt();
         }
-        scheduleUnrollFactor = nodeParallelFactorMap.lookup(parentNode);
-        // FIXME: A hacky method to hand tune the factors and resolve
-        // outstanding dataflow nodes.
-        if (auto attr = schedule->getAttr("increase"))
-          if (auto annoFactor = attr.dyn_cast<IntegerAttr>())
-            scheduleUnrollFactor *= annoFactor.getInt();
-        if (auto attr = schedule->getAttr("decrease"))
-          if (auto annoFactor = attr.dyn_cast<IntegerAttr>())
-            scheduleUnrollFactor /= annoFactor.getInt();
+        scheduleUnrollFactor = applyScheduleFactorHints(
+            schedule, nodeParallelFactorMap.lookup(parentNode));
       }
 
       auto scheduleComplexity = compAnal.getScheduleComplexity(schedule);
@@ -150,7 +271,7 @@ struct ParallelizeDataflowNode
   /// complexity aware, always unroll with the max unroll factor.
   void applyNaiveLoopUnroll(NodeOp node, unsigned parallelFactor) {
     auto unrollFactor = parallelFactor;
-    if (!complexityAware)
+    if (!complexityAware && !throughputAware)
       unrollFactor = maxUnrollFactor.getValue();
 
     // Collect all loop bands to be unrolled.
@@ -216,7 +337,8 @@ struct ParallelizeDataflowNode
       // Get the parallel factor and loop band associated with the current node.
       // Also initialize the unroll factors as one.
       auto parallelFactor = maxUnrollFactor.getValue();
-      if (complexityAware && nodeParallelFactorMap.count(node))
+      if ((complexityAware || throughputAware) &&
+          nodeParallelFactorMap.count(node))
         parallelFactor = nodeParallelFactorMap.lookup(node);
       auto band = getNodeLoopBand(node);
       auto factors = FactorList(band.size(), 1);
@@ -320,7 +442,10 @@ struct ParallelizeDataflowNode
   void runOnOperation() override {
     auto func = getOperation();
     auto context = func.getContext();
-    getNodeParallelFactorMap(func);
+    if (throughputAware)
+      getThroughputAwareParallelFactorMap(func);
+    else
+      getNodeParallelFactorMap(func);
     if (correlationAware)
       applyCorrelationAwareUnroll(func);
     else {
@@ -340,7 +465,8 @@ private:
 
 std::unique_ptr<Pass> scalehls::createParallelizeDataflowNodePass(
     unsigned loopUnrollFactor, bool unrollPointLoopOnly, bool complexityAware,
-    bool correlationAware) {
+    bool correlationAware, bool throughputAware, unsigned maxDspNum) {
   return std::make_unique<ParallelizeDataflowNode>(
-      loopUnrollFactor, unrollPointLoopOnly, complexityAware, correlationAware);
+      loopUnrollFactor, unrollPointLoopOnly, complexityAware, correlationAware,
+      throughputAware, maxDspNum);
 }
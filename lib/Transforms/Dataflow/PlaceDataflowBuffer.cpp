@@ -4,26 +4,228 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "mlir/Dialect/Affine/Analysis/LoopAnalysis.h"
+#include "mlir/Support/FileUtilities.h"
 #include "mlir/Transforms/DialectConversion.h"
 #include "mlir/Transforms/GreedyPatternRewriteDriver.h"
 #include "scalehls/Transforms/Passes.h"
 #include "scalehls/Transforms/Utils.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+#define DEBUG_TYPE "scalehls-place-dataflow-buffer"
 
 using namespace mlir;
 using namespace scalehls;
 using namespace hls;
 
+//===----------------------------------------------------------------------===//
+// BufferPlacementSolver Class Definition
+//===----------------------------------------------------------------------===//
+
+/// Get the number of BRAM18Ks occupied by a buffer with the given data width
+/// and depth, where the most efficient aspect ratio of BRAM18K is selected.
+static int64_t getBramNum(int64_t width, int64_t depth) {
+  static const std::pair<int64_t, int64_t> aspectRatios[] = {
+      {1, 16384}, {2, 8192}, {4, 4096}, {9, 2048}, {18, 1024}, {36, 512}};
+  auto bramNum = INT64_MAX;
+  for (auto [bramWidth, bramDepth] : aspectRatios)
+    bramNum = std::min(bramNum, llvm::divideCeil(width, bramWidth) *
+                                    llvm::divideCeil(depth, bramDepth));
+  return bramNum;
+}
+
+/// Get the number of URAMs (with a fixed aspect ratio of 72x4096) occupied by a
+/// buffer with the given data width and depth.
+static int64_t getUramNum(int64_t width, int64_t depth) {
+  return llvm::divideCeil(width, 72) * llvm::divideCeil(depth, 4096);
+}
+
+/// Get the number of LUTs occupied by a buffer with the given data width and
+/// depth, where each LUT implements a 64x1 distributed RAM.
+static int64_t getLutramNum(int64_t width, int64_t depth) {
+  return width * llvm::divideCeil(depth, 64);
+}
+
+namespace {
+/// Place buffers in LUTRAM, BRAM, URAM, or DRAM with a greedy knapsack
+/// heuristic. Buffers are sorted by their access density (the number of
+/// accesses per bit), and each buffer is placed in the on-chip memory with the
+/// lowest relative cost that still fits the remaining budget. Buffers that
+/// don't fit any on-chip memory are placed in DRAM.
+class BufferPlacementSolver {
+public:
+  BufferPlacementSolver(int64_t maxLutram, int64_t maxBram, int64_t maxUram,
+                        int64_t maxLutramBits)
+      : maxLutram(maxLutram), maxBram(maxBram), maxUram(maxUram),
+        maxLutramBits(maxLutramBits) {}
+
+  /// Solve the placement of all buffers of the given function.
+  void solve(func::FuncOp func, bool placeExternalBuffer);
+
+  /// Get the placement of the given buffer. Return an empty optional if the
+  /// buffer is not handled by the solver.
+  Optional<MemoryKind> getPlacement(Value memref) const {
+    auto it = placementMap.find(memref);
+    if (it == placementMap.end())
+      return Optional<MemoryKind>();
+    return it->second;
+  }
+
+private:
+  /// Count the number of accesses to each buffer, where each access is weighted
+  /// by the trip count of its surrounding loops.
+  void countAccesses(func::FuncOp func);
+
+  DenseMap<Value, int64_t> accessNumMap;
+  DenseMap<Value, MemoryKind> placementMap;
+
+  int64_t maxLutram;
+  int64_t maxBram;
+  int64_t maxUram;
+  int64_t maxLutramBits;
+};
+} // namespace
+
+/// Trace the given memref back to its root buffer through view-like ops.
+static Value getRootMemref(Value memref) {
+  while (auto viewOp = memref.getDefiningOp<ViewLikeOpInterface>())
+    memref = viewOp.getViewSource();
+  return memref;
+}
+
+void BufferPlacementSolver::countAccesses(func::FuncOp func) {
+  func.walk([&](Operation *op) {
+    SmallVector<Value, 2> memrefs;
+    int64_t accessNum = 1;
+    if (auto read = dyn_cast<mlir::AffineReadOpInterface>(op))
+      memrefs.push_back(read.getMemRef());
+    else if (auto write = dyn_cast<mlir::AffineWriteOpInterface>(op))
+      memrefs.push_back(write.getMemRef());
+    else if (auto load = dyn_cast<memref::LoadOp>(op))
+      memrefs.push_back(load.getMemRef());
+    else if (auto store = dyn_cast<memref::StoreOp>(op))
+      memrefs.push_back(store.getMemRef());
+    else if (auto copy = dyn_cast<memref::CopyOp>(op)) {
+      memrefs.append({copy.getSource(), copy.getTarget()});
+      if (auto type = copy.getSource().getType().dyn_cast<MemRefType>())
+        if (type.hasStaticShape())
+          accessNum = type.getNumElements();
+    } else
+      return;
+
+    // Weight the access with the trip count of all surrounding loops.
+    for (auto loop = op->getParentOfType<AffineForOp>(); loop;
+         loop = loop->getParentOfType<AffineForOp>())
+      accessNum *= getConstantTripCount(loop).value_or(1);
+    for (auto memref : memrefs)
+      accessNumMap[getRootMemref(memref)] += accessNum;
+  });
+}
+
+void BufferPlacementSolver::solve(func::FuncOp func, bool placeExternalBuffer) {
+  countAccesses(func);
+
+  struct BufferItem {
+    Value memref;
+    int64_t width;
+    int64_t depth;
+    double density;
+  };
+
+  // Collect all buffers and function arguments to be placed.
+  SmallVector<Value, 32> memrefs;
+  for (auto arg : func.getArguments())
+    if (arg.getType().isa<MemRefType>())
+      memrefs.push_back(arg);
+  func.walk([&](hls::BufferLikeInterface buffer) {
+    memrefs.push_back(buffer.getMemref());
+  });
+
+  SmallVector<BufferItem, 32> items;
+  for (auto memref : memrefs) {
+    auto type = memref.getType().cast<MemRefType>();
+    if (!type.hasStaticShape()) {
+      placementMap[memref] =
+          placeExternalBuffer ? MemoryKind::DRAM : MemoryKind::BRAM_T2P;
+      continue;
+    }
+    auto elementType = type.getElementType();
+    int64_t width =
+        elementType.isIntOrFloat() ? elementType.getIntOrFloatBitWidth() : 64;
+    int64_t depth = std::max(type.getNumElements(), (int64_t)1);
+    double density = (double)accessNumMap.lookup(memref) / (width * depth);
+    items.push_back({memref, width, depth, density});
+  }
+
+  // Buffers that are accessed more frequently per bit are placed first.
+  llvm::stable_sort(items, [](const BufferItem &a, const BufferItem &b) {
+    return a.density > b.density;
+  });
+
+  int64_t lutram = 0, bram = 0, uram = 0;
+  for (auto &item : items) {
+    // Find the on-chip memory with the lowest cost relative to its budget.
+    auto kind = MemoryKind::UNKNOWN;
+    double minCost = std::numeric_limits<double>::max();
+    auto tryMemory = [&](MemoryKind candidate, int64_t num, int64_t used,
+                         int64_t budget) {
+      if (num > budget - used)
+        return;
+      auto cost = (double)num / budget;
+      if (cost < minCost) {
+        minCost = cost;
+        kind = candidate;
+      }
+    };
+
+    auto lutramNum = getLutramNum(item.width, item.depth);
+    auto bramNum = getBramNum(item.width, item.depth);
+    auto uramNum = getUramNum(item.width, item.depth);
+    if (item.width * item.depth <= maxLutramBits)
+      tryMemory(MemoryKind::LUTRAM_2P, lutramNum, lutram, maxLutram);
+    tryMemory(MemoryKind::BRAM_T2P, bramNum, bram, maxBram);
+    tryMemory(MemoryKind::URAM_T2P, uramNum, uram, maxUram);
+
+    if (kind == MemoryKind::LUTRAM_2P)
+      lutram += lutramNum;
+    else if (kind == MemoryKind::BRAM_T2P)
+      bram += bramNum;
+    else if (kind == MemoryKind::URAM_T2P)
+      uram += uramNum;
+    else
+      kind = placeExternalBuffer ? MemoryKind::DRAM : MemoryKind::BRAM_T2P;
+    placementMap[item.memref] = kind;
+
+    LLVM_DEBUG(llvm::dbgs() << "Place " << item.memref.getType() << " ("
+                            << accessNumMap.lookup(item.memref)
+                            << " accesses) in "
+                            << stringifyMemoryKind(kind) << "\n";);
+  }
+
+  LLVM_DEBUG(llvm::dbgs() << "LUTRAM: " << lutram << "/" << maxLutram
+                          << ", BRAM: " << bram << "/" << maxBram
+                          << ", URAM: " << uram << "/" << maxUram << "\n";);
+}
+
 namespace {
 struct PlaceBuffer : public OpRewritePattern<func::FuncOp> {
   PlaceBuffer(MLIRContext *context, unsigned threshold,
-              bool placeExternalBuffer)
+              bool placeExternalBuffer, const BufferPlacementSolver *solver)
       : OpRewritePattern<func::FuncOp>(context), threshold(threshold),
-        placeExternalBuffer(placeExternalBuffer) {}
+        placeExternalBuffer(placeExternalBuffer), solver(solver) {}
 
-  // TODO: For now, we use a heuristic to determine the buffer location.
-  MemRefType getPlacedType(MemRefType type, bool isConstBuffer) const {
+  // If the placement solver is not provided, we use a heuristic to determine
+  // the buffer location.
+  MemRefType getPlacedType(Value memref, MemRefType type,
+                           bool isConstBuffer) const {
     auto kind = MemoryKind::BRAM_T2P;
-    if (placeExternalBuffer)
+    auto placement =
+        solver ? solver->getPlacement(memref) : Optional<MemoryKind>();
+    if (placement)
+      kind = placement.value();
+    else if (placeExternalBuffer)
       kind = type.getNumElements() >= threshold ? MemoryKind::DRAM
                                                 : MemoryKind::BRAM_T2P;
     auto newType = MemRefType::get(
@@ -43,11 +245,12 @@ struct PlaceBuffer : public OpRewritePattern<func::FuncOp> {
                                 PatternRewriter &rewriter) const override {
     for (auto arg : func.getArguments())
       if (auto type = arg.getType().dyn_cast<MemRefType>())
-        arg.setType(getPlacedType(type, false));
+        arg.setType(getPlacedType(arg, type, false));
 
     func.walk([&](hls::BufferLikeInterface buffer) {
       buffer.getMemref().setType(getPlacedType(
-          buffer.getMemrefType(), isa<ConstBufferOp>(buffer.getOperation())));
+          buffer.getMemref(), buffer.getMemrefType(),
+          isa<ConstBufferOp>(buffer.getOperation())));
     });
 
     func.walk([](YieldOp yield) {
@@ -65,6 +268,7 @@ struct PlaceBuffer : public OpRewritePattern<func::FuncOp> {
 private:
   unsigned threshold;
   bool placeExternalBuffer;
+  const BufferPlacementSolver *solver;
 };
 } // namespace
 
@@ -95,17 +299,56 @@ struct PlaceDataflowBuffer
     : public PlaceDataflowBufferBase<PlaceDataflowBuffer> {
   PlaceDataflowBuffer() = default;
   explicit PlaceDataflowBuffer(unsigned argThreshold,
-                               bool argPlaceExternalBuffer) {
+                               bool argPlaceExternalBuffer,
+                               bool argResourceAware,
+                               std::string argTargetSpec) {
     threshold = argThreshold;
     placeExternalBuffer = argPlaceExternalBuffer;
+    resourceAware = argResourceAware;
+    targetSpec = argTargetSpec;
   }
 
   void runOnOperation() override {
     auto func = getOperation();
     auto context = func.getContext();
 
+    // Solve the buffer placement under the memory budgets of the target
+    // device, where default values are based on Xilinx PYNQ-Z1 board.
+    std::unique_ptr<BufferPlacementSolver> solver;
+    if (resourceAware) {
+      llvm::json::Object config;
+      if (!targetSpec.empty()) {
+        std::string errorMessage;
+        auto configFile = mlir::openInputFile(targetSpec, &errorMessage);
+        if (!configFile) {
+          llvm::errs() << errorMessage << "\n";
+          return signalPassFailure();
+        }
+        auto parsedConfig = llvm::json::parse(configFile->getBuffer());
+        if (!parsedConfig) {
+          llvm::errs() << "failed to parse the target spec json file\n";
+          return signalPassFailure();
+        }
+        auto configObj = parsedConfig.get().getAsObject();
+        if (!configObj) {
+          llvm::errs() << "support an object in the target spec json file, "
+                          "found something else\n";
+          return signalPassFailure();
+        }
+        config = std::move(*configObj);
+      }
+
+      solver = std::make_unique<BufferPlacementSolver>(
+          config.getInteger("lutram").value_or(17400),
+          config.getInteger("bram").value_or(280),
+          config.getInteger("uram").value_or(0),
+          config.getInteger("lutram_bits").value_or(1024));
+      solver->solve(func, placeExternalBuffer);
+    }
+
     mlir::RewritePatternSet patterns(context);
-    patterns.add<PlaceBuffer>(context, threshold, placeExternalBuffer);
+    patterns.add<PlaceBuffer>(context, threshold, placeExternalBuffer,
+                              solver.get());
     (void)applyOpPatternsAndFold(func, std::move(patterns));
 
     patterns.clear();
@@ -117,6 +360,9 @@ struct PlaceDataflowBuffer
 
 std::unique_ptr<Pass>
 scalehls::createPlaceDataflowBufferPass(unsigned threshold,
-                                        bool placeExternalBuffer) {
-  return std::make_unique<PlaceDataflowBuffer>(threshold, placeExternalBuffer);
+                                        bool placeExternalBuffer,
+                                        bool resourceAware,
+                                        std::string targetSpec) {
+  return std::make_unique<PlaceDataflowBuffer>(threshold, placeExternalBuffer,
+                                               resourceAware, targetSpec);
 }
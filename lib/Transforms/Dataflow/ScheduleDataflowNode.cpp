@@ -4,8 +4,7 @@
 //
 //===----------------------------------------------------------------------===//
 
-#include "mlir/IR/Dominance.h"
-#include "mlir/Transforms/GreedyPatternRewriteDriver.h"
+#include "scalehls/Dialect/HLS/Analysis.h"
 #include "scalehls/Transforms/Passes.h"
 #include "scalehls/Transforms/Utils.h"
 
@@ -13,62 +12,105 @@ using namespace mlir;
 using namespace scalehls;
 using namespace hls;
 
-namespace {
-struct ALAPScheduleNode : public OpRewritePattern<NodeOp> {
-  ALAPScheduleNode(MLIRContext *context, bool ignoreViolations)
-      : OpRewritePattern<NodeOp>(context), ignoreViolations(ignoreViolations) {}
+/// Schedule the nodes of the given schedule op in an ALAP manner. The dataflow
+/// graph is traversed in a reverse topological order with a worklist, where a
+/// node is scheduled once all its dependent consumers are scheduled. Nodes that
+/// already have a level are kept unchanged. If "maxNodesPerLevel" is positive,
+/// a node is postponed to the next level that still has free slots.
+static void scheduleNodes(ScheduleOp schedule, DataflowGraphAnalysis &graph,
+                          bool ignoreViolations, unsigned maxNodesPerLevel) {
+  auto builder = Builder(schedule.getContext());
 
-  LogicalResult matchAndRewrite(NodeOp node,
-                                PatternRewriter &rewriter) const override {
-    if (node.getLevel())
-      return failure();
+  llvm::SmallDenseMap<NodeOp, SmallVector<NodeOp, 4>> successorsMap;
+  llvm::SmallDenseMap<NodeOp, SmallVector<NodeOp, 4>> predecessorsMap;
+  llvm::SmallDenseMap<NodeOp, unsigned> numUnscheduledSuccessors;
+  llvm::SmallDenseMap<unsigned, unsigned> levelUsageMap;
+  llvm::SmallDenseSet<NodeOp> blockedNodes;
 
-    DominanceInfo domInfo;
-    unsigned level = 0;
+  // Build the dependencies between all unscheduled nodes.
+  SmallVector<NodeOp> nodes;
+  for (auto node : schedule.getOps<NodeOp>()) {
+    if (auto level = node.getLevel()) {
+      ++levelUsageMap[level.value()];
+      continue;
+    }
+    nodes.push_back(node);
+
+    auto &successors = successorsMap[node];
     for (auto output : node.getOutputs()) {
+      auto consumers = graph.getDependentConsumers(output, node);
+
       // Stop to schedule the node if an internal buffer has multi-producer or
       // multi-consumer violation. DRAM buffer is not considered - the
       // dependencies associated with them are handled later by tokens.
       if (!isExtBuffer(output) && !ignoreViolations)
-        if (getDependentConsumers(output, node).size() > 1 ||
-            getProducers(output).size() > 1)
-          return failure();
-
-      for (auto consumer : getDependentConsumers(output, node)) {
-        if (!consumer.getLevel())
-          return failure();
-        level = std::max(level, consumer.getLevel().value() + 1);
-      }
+        if (consumers.size() > 1 || graph.getProducers(output).size() > 1)
+          blockedNodes.insert(node);
+      successors.append(consumers.begin(), consumers.end());
     }
-    node.setLevelAttr(rewriter.getI32IntegerAttr(level));
-    return success();
   }
 
-private:
-  bool ignoreViolations;
-};
-} // namespace
+  SmallVector<NodeOp> worklist;
+  for (auto node : nodes) {
+    unsigned numUnscheduled = 0;
+    for (auto successor : successorsMap[node])
+      if (!successor.getLevel()) {
+        predecessorsMap[successor].push_back(node);
+        ++numUnscheduled;
+      }
+    numUnscheduledSuccessors[node] = numUnscheduled;
+    if (!numUnscheduled && !blockedNodes.count(node))
+      worklist.push_back(node);
+  }
+
+  // Schedule nodes in a first-in-first-out order. Nodes that are blocked by
+  // violations or involved in a dependence cycle are left unscheduled.
+  for (unsigned i = 0; i < worklist.size(); ++i) {
+    auto node = worklist[i];
+    unsigned level = 0;
+    for (auto successor : successorsMap[node])
+      level = std::max(level, successor.getLevel().value() + 1);
+
+    if (maxNodesPerLevel)
+      while (levelUsageMap.lookup(level) >= maxNodesPerLevel)
+        ++level;
+    ++levelUsageMap[level];
+    node.setLevelAttr(builder.getI32IntegerAttr(level));
+
+    for (auto predecessor : predecessorsMap.lookup(node))
+      if (!--numUnscheduledSuccessors[predecessor] &&
+          !blockedNodes.count(predecessor))
+        worklist.push_back(predecessor);
+  }
+}
 
 namespace {
 struct ScheduleDataflowNode
     : public ScheduleDataflowNodeBase<ScheduleDataflowNode> {
   ScheduleDataflowNode() = default;
-  explicit ScheduleDataflowNode(bool argIgnoreViolations) {
+  explicit ScheduleDataflowNode(bool argIgnoreViolations,
+                                unsigned argMaxNodesPerLevel) {
     ignoreViolations = argIgnoreViolations;
+    maxNodesPerLevel = argMaxNodesPerLevel;
   }
 
   void runOnOperation() override {
     auto func = getOperation();
-    auto context = func.getContext();
+    auto &graph = getAnalysis<DataflowGraphAnalysis>();
+
+    func.walk([&](ScheduleOp schedule) {
+      scheduleNodes(schedule, graph, ignoreViolations, maxNodesPerLevel);
+    });
 
-    mlir::RewritePatternSet patterns(context);
-    patterns.add<ALAPScheduleNode>(context, ignoreViolations.getValue());
-    (void)applyPatternsAndFoldGreedily(func, std::move(patterns));
+    // Scheduling only sets node levels and keeps the dataflow graph intact.
+    markAnalysesPreserved<DataflowGraphAnalysis>();
   }
 };
 } // namespace
 
 std::unique_ptr<Pass>
-scalehls::createScheduleDataflowNodePass(bool ignoreViolations) {
-  return std::make_unique<ScheduleDataflowNode>(ignoreViolations);
+scalehls::createScheduleDataflowNodePass(bool ignoreViolations,
+                                         unsigned maxNodesPerLevel) {
+  return std::make_unique<ScheduleDataflowNode>(ignoreViolations,
+                                                maxNodesPerLevel);
 }
@@ -0,0 +1,443 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright 2020-2021 The ScaleHLS Authors.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/Support/FileUtilities.h"
+#include "scalehls/Transforms/Estimator.h"
+#include "scalehls/Transforms/Passes.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include <deque>
+#include <queue>
+
+#define DEBUG_TYPE "scalehls-size-dataflow-stream"
+
+using namespace mlir;
+using namespace scalehls;
+using namespace hls;
+
+//===----------------------------------------------------------------------===//
+// DataflowSimulator Class Definition
+//===----------------------------------------------------------------------===//
+
+/// Trace the channel accessed inside of the node back to the operand of the
+/// node. Return nullptr if the channel is not passed in from the node.
+static Value getNodeOperand(Value channel, NodeOp node) {
+  while (auto arg = channel.dyn_cast<BlockArgument>()) {
+    auto parentOp = arg.getOwner()->getParentOp();
+    if (!isa<NodeOp, ScheduleOp>(parentOp))
+      return nullptr;
+    channel = parentOp->getOperand(arg.getArgNumber());
+    if (parentOp == node)
+      return channel;
+  }
+  return nullptr;
+}
+
+namespace {
+/// A cycle-approximate discrete-event simulator of a dataflow schedule. Each
+/// node is simulated as a sequential process iterating over frames. Stream
+/// channels are simulated at the granularity of tokens, where the nominal time
+/// of each stream access is derived from the estimated schedule of the node.
+/// Buffer channels are simulated at the granularity of frames, where a frame
+/// can be consumed once the producer finishes it, and a producer is blocked
+/// when all ping-pong slots of the buffer are occupied.
+class DataflowSimulator {
+public:
+  DataflowSimulator(ScheduleOp schedule, ScaleHLSEstimator &estimator);
+
+  /// Simulate the given number of frames with unbounded stream channels, such
+  /// that no stream access is ever stalled by a full FIFO. Return false if the
+  /// dataflow is deadlocked.
+  bool simulate(unsigned numFrames);
+
+  /// Get the maximum occupancy of the stream channel in the last simulation.
+  /// Because the writer never finds the FIFO full, this is the minimal depth
+  /// that reproduces the stall-free behavior, which is deadlock-free as well.
+  int64_t getMaxOccupancy(StreamOp stream) const {
+    return channels[channelMap.lookup(stream.getChannel())].maxOccupancy;
+  }
+
+  ArrayRef<StreamOp> getStreams() const { return streams; }
+
+private:
+  /// A sequence of "count" accesses to a stream channel, where the i-th access
+  /// is nominally issued at "offset + i * period" relative to the beginning of
+  /// the frame.
+  struct Access {
+    unsigned channel;
+    bool isWrite;
+    int64_t offset;
+    int64_t count;
+    int64_t period;
+  };
+
+  /// A frame-level dependence, where a frame "f" of the process can only begin
+  /// once the number of frames finished by "process" plus "shift" is larger
+  /// than "f".
+  struct FrameDep {
+    unsigned process;
+    int64_t shift;
+  };
+
+  struct Process {
+    int64_t latency = 0;
+    SmallVector<Access, 4> accesses;
+    SmallVector<FrameDep, 4> frameDeps;
+
+    // Simulation states.
+    unsigned frame = 0;
+    bool isStarted = false;
+    bool isFinishing = false;
+    int64_t frameBegin = 0;
+    int64_t frameEnd = 0;
+    int64_t slip = 0;
+    SmallVector<int64_t, 4> cursors;
+  };
+
+  struct Channel {
+    // The available time of each token in the FIFO.
+    std::deque<int64_t> tokens;
+    SmallVector<unsigned, 2> blockedReaders;
+    int64_t lastReadTime = -1;
+    int64_t numReadsAtLastTime = 0;
+    int64_t maxOccupancy = 0;
+  };
+
+  bool isFrameReady(Process &process);
+  void step(unsigned idx, int64_t time);
+
+  SmallVector<StreamOp, 8> streams;
+  llvm::DenseMap<Value, unsigned> channelMap;
+
+  SmallVector<Process, 16> processes;
+  SmallVector<Channel, 8> channels;
+
+  unsigned numFrames = 0;
+  SmallVector<unsigned, 8> blockedProcesses;
+  std::priority_queue<std::pair<int64_t, unsigned>,
+                      std::vector<std::pair<int64_t, unsigned>>,
+                      std::greater<std::pair<int64_t, unsigned>>>
+      queue;
+};
+} // namespace
+
+DataflowSimulator::DataflowSimulator(ScheduleOp schedule,
+                                     ScaleHLSEstimator &estimator) {
+  for (auto stream : schedule.getOps<StreamOp>()) {
+    channelMap[stream.getChannel()] = streams.size();
+    streams.push_back(stream);
+  }
+  channels.resize(streams.size());
+
+  SmallVector<NodeOp, 16> nodes(schedule.getOps<NodeOp>());
+  llvm::SmallDenseMap<Operation *, unsigned, 16> processMap;
+  for (unsigned idx = 0, e = nodes.size(); idx < e; ++idx)
+    processMap[nodes[idx]] = idx;
+  processes.resize(nodes.size());
+
+  // If all nodes have been scheduled, producers always have higher levels than
+  // their consumers. Otherwise, we fall back to the program order.
+  auto hasLevels =
+      llvm::all_of(nodes, [](NodeOp node) { return node.getLevel(); });
+  auto isFrameBefore = [&](NodeOp a, NodeOp b) {
+    if (hasLevels)
+      return a.getLevel().value() > b.getLevel().value();
+    return a->isBeforeInBlock(b);
+  };
+
+  for (auto node : nodes) {
+    auto &process = processes[processMap[node]];
+    process.latency = estimator.getTiming(node).getLatency();
+
+    // Collect all stream accesses in the node. The nominal time of the first
+    // access is accumulated from the relative schedule levels of all ancestors
+    // in the node, and the following accesses are assumed to be uniformly
+    // distributed in the outermost surrounding loop.
+    node.walk([&](Operation *op) {
+      if (!isa<StreamReadOp, StreamWriteOp>(op))
+        return;
+      auto channel = getNodeOperand(op->getOperand(0), node);
+      if (!channel || !channelMap.count(channel))
+        return;
+
+      int64_t offset = 0;
+      int64_t count = 1;
+      Operation *outermost = nullptr;
+      for (auto current = op; current != node;
+           current = current->getParentOp()) {
+        offset += estimator.getTiming(current).getBegin();
+        if (auto loop = dyn_cast<AffineForOp>(current)) {
+          count *= getConstantTripCount(loop).value_or(1);
+          outermost = loop;
+        }
+      }
+
+      int64_t period = 1;
+      if (outermost)
+        period = std::max(estimator.getTiming(outermost).getLatency() / count,
+                          (int64_t)1);
+      process.accesses.push_back({channelMap[channel],
+                                  isa<StreamWriteOp>(op), offset, count,
+                                  period});
+    });
+
+    // Collect the frame-level dependences through buffers. A consumer with tap
+    // "t" reads the frame produced "t" frames earlier, and a back dependence
+    // reads the frame produced by the previous iteration. Meanwhile, a buffer
+    // with depth "d" has "d + 1" slots, which are released once the consumers
+    // finish the corresponding frames.
+    for (auto input : llvm::enumerate(node.getInputs())) {
+      if (input.value().getType().isa<StreamType>())
+        continue;
+
+      int64_t slots = 2;
+      if (auto buffer = input.value().getDefiningOp<BufferOp>())
+        slots = buffer.getDepth() + 1;
+
+      for (auto producer : getProducersExcept(input.value(), node)) {
+        if (!processMap.count(producer))
+          continue;
+        int64_t shift = node.getInputTap(input.index());
+        if (!isFrameBefore(producer, node))
+          ++shift;
+
+        auto producerIdx = processMap[producer];
+        process.frameDeps.push_back({producerIdx, shift});
+        processes[producerIdx].frameDeps.push_back(
+            {processMap[node], std::max(slots - shift, (int64_t)1)});
+      }
+    }
+  }
+}
+
+bool DataflowSimulator::isFrameReady(Process &process) {
+  return llvm::all_of(process.frameDeps, [&](FrameDep dep) {
+    return processes[dep.process].frame + dep.shift > process.frame;
+  });
+}
+
+/// Advance the process at the given time until it is blocked or waiting for a
+/// future time. In the latter case, the process is pushed back into the queue.
+void DataflowSimulator::step(unsigned idx, int64_t time) {
+  auto &process = processes[idx];
+  while (process.frame < numFrames) {
+    // Finish the current frame and wake up all blocked processes, which may be
+    // waiting for the frame.
+    if (process.isFinishing) {
+      process.isFinishing = false;
+      process.frameEnd = time;
+      process.isStarted = false;
+      ++process.frame;
+      for (auto blocked : blockedProcesses)
+        queue.push({time, blocked});
+      blockedProcesses.clear();
+      continue;
+    }
+
+    // Begin a new frame once all frame-level dependences are resolved.
+    if (!process.isStarted) {
+      if (!isFrameReady(process)) {
+        blockedProcesses.push_back(idx);
+        return;
+      }
+      process.isStarted = true;
+      process.frameBegin = time;
+      process.frameEnd = time;
+      process.slip = 0;
+      process.cursors.assign(process.accesses.size(), 0);
+    }
+
+    // Find the next stream access in the order of the nominal time.
+    Optional<unsigned> next;
+    int64_t nextTime = 0;
+    for (auto access : llvm::enumerate(process.accesses)) {
+      auto cursor = process.cursors[access.index()];
+      if (cursor >= access.value().count)
+        continue;
+      auto nominal = process.frameBegin + process.slip +
+                     access.value().offset + cursor * access.value().period;
+      if (!next || nominal < nextTime) {
+        next = access.index();
+        nextTime = nominal;
+      }
+    }
+
+    // If all accesses have been issued, the frame is finished once the node
+    // latency, extended by all stalls, is elapsed.
+    if (!next) {
+      auto end = std::max(process.frameBegin + process.slip + process.latency,
+                          process.frameEnd);
+      process.isFinishing = true;
+      if (end > time)
+        return queue.push({end, idx});
+      continue;
+    }
+    if (nextTime > time)
+      return queue.push({nextTime, idx});
+
+    auto &access = process.accesses[next.value()];
+    auto &channel = channels[access.channel];
+    if (access.isWrite) {
+      // The token is available in the next cycle. The reads at the same time
+      // are not able to free up any space for the write.
+      channel.tokens.push_back(time + 1);
+      auto occupancy = (int64_t)channel.tokens.size();
+      if (channel.lastReadTime == time)
+        occupancy += channel.numReadsAtLastTime;
+      channel.maxOccupancy = std::max(channel.maxOccupancy, occupancy);
+
+      for (auto reader : channel.blockedReaders)
+        queue.push({time + 1, reader});
+      channel.blockedReaders.clear();
+    } else {
+      // Stall the read if the FIFO is empty or the token is not yet available.
+      if (channel.tokens.empty()) {
+        channel.blockedReaders.push_back(idx);
+        return;
+      }
+      if (channel.tokens.front() > time)
+        return queue.push({channel.tokens.front(), idx});
+
+      channel.tokens.pop_front();
+      if (channel.lastReadTime != time) {
+        channel.lastReadTime = time;
+        channel.numReadsAtLastTime = 0;
+      }
+      ++channel.numReadsAtLastTime;
+    }
+
+    // Any stall of the access delays all the following accesses.
+    process.slip += time - nextTime;
+    process.frameEnd = std::max(process.frameEnd, time + 1);
+    ++process.cursors[next.value()];
+  }
+}
+
+bool DataflowSimulator::simulate(unsigned frames) {
+  numFrames = frames;
+  for (auto &process : processes)
+    process = Process{process.latency, process.accesses, process.frameDeps};
+  for (auto &channel : channels)
+    channel = Channel();
+  blockedProcesses.clear();
+
+  for (unsigned idx = 0, e = processes.size(); idx < e; ++idx)
+    queue.push({0, idx});
+  while (!queue.empty()) {
+    auto [time, idx] = queue.top();
+    queue.pop();
+    step(idx, time);
+  }
+
+  LLVM_DEBUG({
+    for (auto process : llvm::enumerate(processes))
+      llvm::dbgs() << "process " << process.index() << " finished "
+                   << process.value().frame << " frames at cycle "
+                   << process.value().frameEnd << "\n";
+  });
+
+  return llvm::all_of(processes, [&](const Process &process) {
+    return process.frame == numFrames;
+  });
+}
+
+//===----------------------------------------------------------------------===//
+// SizeDataflowStream Pass Definition
+//===----------------------------------------------------------------------===//
+
+/// Set the depth of the stream channel and update the signature of all nodes
+/// using the channel.
+static void setStreamDepth(StreamOp stream, unsigned depth) {
+  auto type = stream.getChannel().getType().cast<StreamType>();
+  auto builder = Builder(stream.getContext());
+  stream.setDepthAttr(builder.getI32IntegerAttr(depth));
+  stream.getChannel().setType(
+      StreamType::get(stream.getContext(), type.getElementType(), depth));
+
+  for (auto user : stream->getUsers())
+    if (auto node = dyn_cast<NodeOp>(user))
+      node.updateSignatureRecursively();
+}
+
+namespace {
+struct SizeDataflowStream
+    : public SizeDataflowStreamBase<SizeDataflowStream> {
+  SizeDataflowStream() = default;
+  SizeDataflowStream(std::string streamTargetSpec, unsigned streamNumFrames) {
+    targetSpec = streamTargetSpec;
+    numFrames = streamNumFrames;
+  }
+
+  void runOnOperation() override {
+    auto func = getOperation();
+
+    // Collect profiling latency, DSP and LUT usage data. If the target spec is
+    // not provided, default values are based on Xilinx PYNQ-Z1 board.
+    llvm::StringMap<int64_t> latencyMap;
+    llvm::StringMap<int64_t> dspUsageMap;
+    llvm::StringMap<int64_t> lutUsageMap;
+    if (targetSpec.empty()) {
+      llvm::json::Object config{{"100MHz", llvm::json::Object()},
+                                {"dsp_usage", llvm::json::Object()}};
+      getLatencyMap(&config, latencyMap);
+      getDspUsageMap(&config, dspUsageMap);
+      getLutUsageMap(&config, lutUsageMap);
+    } else {
+      std::string errorMessage;
+      auto configFile = mlir::openInputFile(targetSpec, &errorMessage);
+      if (!configFile) {
+        llvm::errs() << errorMessage << "\n";
+        return signalPassFailure();
+      }
+      auto config = llvm::json::parse(configFile->getBuffer());
+      if (!config) {
+        llvm::errs() << "failed to parse the target spec json file\n";
+        return signalPassFailure();
+      }
+      auto configObj = config.get().getAsObject();
+      if (!configObj) {
+        llvm::errs() << "support an object in the target spec json file, "
+                        "found something else\n";
+        return signalPassFailure();
+      }
+      getLatencyMap(configObj, latencyMap);
+      getDspUsageMap(configObj, dspUsageMap);
+      getLutUsageMap(configObj, lutUsageMap);
+    }
+
+    SmallVector<ScheduleOp, 4> schedules;
+    func.walk([&](ScheduleOp schedule) { schedules.push_back(schedule); });
+
+    auto estimator =
+        ScaleHLSEstimator(latencyMap, dspUsageMap, lutUsageMap, true);
+    estimator.setAlwaysMaterialize(false);
+    for (auto schedule : schedules) {
+      if (schedule.getOps<StreamOp>().empty())
+        continue;
+
+      estimator.estimateSchedule(schedule);
+      DataflowSimulator simulator(schedule, estimator);
+      if (!simulator.simulate(numFrames)) {
+        schedule.emitWarning("dataflow is deadlocked in the simulation, "
+                             "stream depths are not changed");
+        continue;
+      }
+
+      for (auto stream : simulator.getStreams()) {
+        auto depth = std::max(simulator.getMaxOccupancy(stream), (int64_t)1);
+        if (depth != (int64_t)stream.getDepth())
+          setStreamDepth(stream, depth);
+      }
+    }
+  }
+};
+} // namespace
+
+std::unique_ptr<Pass>
+scalehls::createSizeDataflowStreamPass(std::string targetSpec,
+                                       unsigned numFrames) {
+  return std::make_unique<SizeDataflowStream>(targetSpec, numFrames);
+}
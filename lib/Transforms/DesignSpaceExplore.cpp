@@ -6,13 +6,18 @@
 
 #include "mlir/Dialect/Affine/Analysis/LoopAnalysis.h"
 #include "mlir/Dialect/Affine/Analysis/Utils.h"
+#include "mlir/IR/Threading.h"
 #include "mlir/Support/FileUtilities.h"
 #include "scalehls/Transforms/Explorer.h"
 #include "scalehls/Transforms/Passes.h"
+#include "llvm/ADT/PostOrderIterator.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/MathExtras.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/ToolOutputFile.h"
-#include <numeric>
+#include <cmath>
+#include <functional>
 // #include <pthread.h>
 
 #define DEBUG_TYPE "scalehls"
@@ -20,37 +25,46 @@
 using namespace mlir;
 using namespace scalehls;
 
+/// Return the objectives of the design point to be minimized, which are ordered
+/// by their priorities.
+template <typename DesignPointType>
+static std::array<int64_t, 4> getObjectives(const DesignPointType &point) {
+  return {point.latency, point.resource.dsp, point.resource.bram,
+          point.resource.lut};
+}
+
+/// Return whether objectives "a" dominates objectives "b", which means "a" is
+/// no worse than "b" in all objectives and is better in at least one objective.
+static bool dominates(ArrayRef<int64_t> a, ArrayRef<int64_t> b) {
+  bool isBetter = false;
+  for (auto [objA, objB] : llvm::zip(a, b)) {
+    if (objA > objB)
+      return false;
+    isBetter |= objA < objB;
+  }
+  return isBetter;
+}
+
 /// Update paretoPoints to remove design points that are not pareto frontiers.
+/// The design points are first sorted in the lexicographic order of objectives,
+/// such that each design point can only be dominated by the design points in
+/// front of it. Therefore, each design point only needs to be checked against
+/// the pareto frontiers that have been found.
 template <typename DesignPointType>
 static void updateParetoPoints(SmallVector<DesignPointType, 16> &paretoPoints) {
-  // Sort the pareto points with in an ascending order of latency and the an
-  // ascending order of dsp number.
-  auto latencyThenDspNum = [&](const DesignPointType &a,
-                               const DesignPointType &b) {
-    return (a.latency < b.latency ||
-            (a.latency == b.latency && a.dspNum < b.dspNum));
+  auto objectivesOrder = [&](const DesignPointType &a,
+                             const DesignPointType &b) {
+    return getObjectives(a) < getObjectives(b);
   };
-  llvm::sort(paretoPoints, latencyThenDspNum);
+  llvm::sort(paretoPoints, objectivesOrder);
 
-  // Find pareto frontiers. After the sorting, the first design point must be a
-  // pareto point.
-  auto paretoPoint = paretoPoints[0];
-  auto paretoLatency = paretoPoint.latency;
-  auto paretoDspNum = paretoPoint.dspNum;
   SmallVector<DesignPointType, 16> frontiers;
-
-  for (auto point : paretoPoints) {
-    auto tmpLatency = point.latency;
-    auto tmpDspNum = point.dspNum;
-
-    if (tmpDspNum < paretoDspNum) {
-      frontiers.push_back(point);
-
-      paretoPoint = point;
-      paretoLatency = tmpLatency;
-      paretoDspNum = tmpDspNum;
-
-    } else if (tmpDspNum == paretoDspNum && tmpLatency == paretoLatency)
+  for (auto &point : paretoPoints) {
+    auto objectives = getObjectives(point);
+    auto isDominated = llvm::any_of(frontiers, [&](DesignPointType &frontier) {
+      return dominates(getObjectives(frontier), objectives);
+    });
+    if (!isDominated)
       frontiers.push_back(point);
   }
 
@@ -74,15 +88,22 @@ static void emitTileListDebugInfo(FactorList tileList) {
 
 LoopDesignSpace::LoopDesignSpace(func::FuncOp func, AffineLoopBand &band,
                                  ScaleHLSEstimator &estimator,
-                                 unsigned maxDspNum, unsigned maxExplParallel,
+                                 MemoryOptsPipeline &pipeline,
+                                 DesignResource maxResource,
+                                 unsigned maxExplParallel,
                                  unsigned maxLoopParallel, bool directiveOnly)
-    : func(func), band(band), estimator(estimator), maxDspNum(maxDspNum) {
+    : func(func), band(band), estimator(estimator), pipeline(pipeline),
+      maxResource(maxResource), maxExplParallel(maxExplParallel),
+      directiveOnly(directiveOnly) {
   // Initialize tile vector related members.
   validTileConfigNum = 1;
   for (auto loop : band) {
     auto optionalTripCount = getConstantTripCount(loop);
-    if (!optionalTripCount)
+    if (!optionalTripCount) {
       loop.emitError("has variable loop bound");
+      valid = false;
+      return;
+    }
 
     unsigned tripCount = optionalTripCount.value();
     tripCountList.push_back(tripCount);
@@ -100,41 +121,102 @@ LoopDesignSpace::LoopDesignSpace(func::FuncOp func, AffineLoopBand &band,
     }
 
     validTileSizesList.push_back(validSizes);
-    validTileConfigNum *= validSizes.size();
+    bool overflowed = false;
+    validTileConfigNum = llvm::SaturatingMultiply(
+        validTileConfigNum, (TileConfig)validSizes.size(), &overflowed);
+    if (overflowed) {
+      loop.emitError("has too many tile size combinations to be encoded");
+      valid = false;
+      return;
+    }
   }
 
   // The last design point (all loops are fully unrolled) is removed.
   --validTileConfigNum;
+}
 
-  for (TileConfig config = 0; config < validTileConfigNum; ++config) {
-    auto tileList = getTileList(config);
+/// Return whether the given tile list meets the constraint of directive only
+/// optimization, where once one loop is unrolled, all inner loops should be
+/// fully unrolled.
+static bool isDirectiveOnlyTileList(ArrayRef<unsigned> tileList,
+                                    ArrayRef<unsigned> tripCountList) {
+  bool mustFullyUnroll = false;
+  for (auto [tile, tripCount] : llvm::zip(tileList, tripCountList)) {
+    if (mustFullyUnroll && tile != tripCount)
+      return false;
+    if (tile != 1)
+      mustFullyUnroll = true;
+  }
+  return true;
+}
 
-    // If the overall parallelism is out of bound, continue to next config.
-    auto parallel = std::accumulate(tileList.begin(), tileList.end(),
-                                    (unsigned)1, std::multiplies<unsigned>());
-    if (parallel > maxExplParallel)
-      continue;
+/// Return whether the given tile config is in the design space.
+bool LoopDesignSpace::isValidTileConfig(TileConfig config) {
+  if (config >= validTileConfigNum)
+    return false;
+
+  auto tileList = getTileList(config);
+
+  // If the overall parallelism is out of bound, the tile config is invalid.
+  uint64_t parallel = 1;
+  for (auto tile : tileList)
+    if ((parallel *= tile) > maxExplParallel)
+      return false;
+
+  return !directiveOnly || isDirectiveOnlyTileList(tileList, tripCountList);
+}
 
-    // In only directive opt should be applied, once one loop is unrolled, all
-    // innter loops should be fully unrolled.
-    if (directiveOnly) {
-      bool mustFullyUnroll = false;
-      bool isInvalid = false;
-      unsigned i = 0;
-
-      for (auto tile : tileList) {
-        if (mustFullyUnroll && tile != tripCountList[i])
-          isInvalid = true;
-        if (tile != 1)
-          mustFullyUnroll = true;
-        ++i;
+/// Return the first valid tile config that is no smaller than "begin" and
+/// whose overall parallelism is within "maxParallel".
+Optional<TileConfig>
+LoopDesignSpace::getNextValidTileConfig(TileConfig begin,
+                                        unsigned maxParallel) {
+  if (begin >= validTileConfigNum)
+    return Optional<TileConfig>();
+
+  maxParallel = std::min(maxParallel, maxExplParallel);
+  auto tileIndices = getTileIndices(begin);
+  unsigned loopNum = tileIndices.size();
+
+  while (true) {
+    // Find the most significant loop where the overall parallelism of it and
+    // all more significant loops is out of bound. As the valid tile sizes are
+    // in ascending order, all tile configs sharing the tile sizes of these
+    // loops are out of bound and can be skipped.
+    Optional<unsigned> outOfBoundLoop;
+    uint64_t parallel = 1;
+    for (unsigned i = loopNum; i > 0; --i)
+      if ((parallel *= validTileSizesList[i - 1][tileIndices[i - 1]]) >
+          maxParallel) {
+        outOfBoundLoop = i - 1;
+        break;
       }
 
-      if (isInvalid)
-        continue;
+    unsigned carryLoop = 0;
+    if (!outOfBoundLoop) {
+      auto config = getTileConfigFromIndices(tileIndices);
+      if (config >= validTileConfigNum)
+        return Optional<TileConfig>();
+
+      SmallVector<unsigned, 8> tileList;
+      for (unsigned i = 0; i < loopNum; ++i)
+        tileList.push_back(validTileSizesList[i][tileIndices[i]]);
+      if (!directiveOnly || isDirectiveOnlyTileList(tileList, tripCountList))
+        return config;
+    } else {
+      for (unsigned i = 0; i <= outOfBoundLoop.value(); ++i)
+        tileIndices[i] = 0;
+      carryLoop = outOfBoundLoop.value() + 1;
     }
 
-    unestimatedTileConfigs.insert(config);
+    // Move to the next tile config with carry.
+    while (true) {
+      if (carryLoop == loopNum)
+        return Optional<TileConfig>();
+      if (++tileIndices[carryLoop] < validTileSizesList[carryLoop].size())
+        break;
+      tileIndices[carryLoop++] = 0;
+    }
   }
 }
 
@@ -143,7 +225,7 @@ FactorList LoopDesignSpace::getTileList(TileConfig config) {
   assert(config < validTileConfigNum && "invalid tile config");
 
   FactorList tileList;
-  unsigned factor = 1;
+  TileConfig factor = 1;
   for (auto validSizes : validTileSizesList) {
     auto idx = config / factor % validSizes.size();
     factor *= validSizes.size();
@@ -159,7 +241,7 @@ TileConfig LoopDesignSpace::getTileConfig(FactorList tileList) {
   assert(tileList.size() == validTileSizesList.size() && "invalid tile list");
 
   TileConfig config = 0;
-  unsigned factor = 1;
+  TileConfig factor = 1;
   for (unsigned i = 0, e = tileList.size(); i < e; ++i) {
     auto tile = tileList[i];
     auto validSizes = validTileSizesList[i];
@@ -175,6 +257,33 @@ TileConfig LoopDesignSpace::getTileConfig(FactorList tileList) {
   return config;
 }
 
+/// Return the index of the tile size of each loop given a tile config.
+SmallVector<unsigned, 8> LoopDesignSpace::getTileIndices(TileConfig config) {
+  SmallVector<unsigned, 8> tileIndices;
+  TileConfig factor = 1;
+  for (auto &validSizes : validTileSizesList) {
+    tileIndices.push_back(config / factor % validSizes.size());
+    factor *= validSizes.size();
+  }
+  return tileIndices;
+}
+
+/// Return the corresponding tile config given the index of the tile size of
+/// each loop. Note that the returned tile config is not guaranteed to be valid.
+TileConfig
+LoopDesignSpace::getTileConfigFromIndices(ArrayRef<unsigned> tileIndices) {
+  assert(tileIndices.size() == validTileSizesList.size() &&
+         "invalid tile indices");
+
+  TileConfig config = 0;
+  TileConfig factor = 1;
+  for (auto [idx, validSizes] : llvm::zip(tileIndices, validTileSizesList)) {
+    config += factor * idx;
+    factor *= validSizes.size();
+  }
+  return config;
+}
+
 /// Calculate the Euclid distance of config a and config b.
 float LoopDesignSpace::getTileConfigDistance(TileConfig configA,
                                              TileConfig configB) {
@@ -182,7 +291,7 @@ float LoopDesignSpace::getTileConfigDistance(TileConfig configA,
          "invalid tile config");
 
   int64_t distanceSquare = 0;
-  unsigned factor = 1;
+  TileConfig factor = 1;
   for (auto validSizes : validTileSizesList) {
     int64_t idxA = configA / factor % validSizes.size();
     int64_t idxB = configB / factor % validSizes.size();
@@ -197,28 +306,33 @@ float LoopDesignSpace::getTileConfigDistance(TileConfig configA,
 
 /// Evaluate all design points under the given tile config.
 bool LoopDesignSpace::evaluateTileConfig(TileConfig config) {
-  // If the current tile config is already estimated, return false.
-  if (!unestimatedTileConfigs.count(config))
+  // Annotate the current tile config as estimated. If the current tile config
+  // is already estimated, return false.
+  if (!markEstimated(config))
     return false;
 
-  // Annotate the current tile config as estimated.
-  unestimatedTileConfigs.erase(config);
+  emitTileListDebugInfo(getTileList(config));
 
-  // Clone a temporary loop band by cloning the outermost loop.
-  auto outerLoop = band.front();
-  auto tmpOuterLoop = outerLoop.clone();
-  AffineLoopBand tmpBand;
-  getLoopBandFromOutermost(tmpOuterLoop, tmpBand);
+  SmallVector<LoopDesignPoint, 16> points;
+  if (!evaluateTileConfig(config, func, band, estimator, pipeline, points))
+    return false;
 
-  // Insert the clone loop band to the front of the original band for the
-  // convenience of the estimation.
-  auto builder = OpBuilder(func);
-  builder.setInsertionPoint(outerLoop);
-  builder.insert(tmpOuterLoop);
+  for (auto point : points) {
+    allPoints.push_back(point);
+    if (point.resource.fitsIn(maxResource))
+      paretoPoints.push_back(point);
+  }
+  return true;
+}
 
-  // Apply the tile config and estimate the loop band.
+/// Evaluate the given tile config on "targetBand" located in "targetFunc" with
+/// "targetEstimator" and "targetPipeline", and return all generated design
+/// points in "points".
+bool LoopDesignSpace::evaluateTileConfig(
+    TileConfig config, func::FuncOp targetFunc, AffineLoopBand &targetBand,
+    ScaleHLSEstimator &targetEstimator, MemoryOptsPipeline &targetPipeline,
+    SmallVectorImpl<LoopDesignPoint> &points) {
   auto tileList = getTileList(config);
-  emitTileListDebugInfo(tileList);
 
   // Calculate the total iteration number.
   unsigned iterNum = 1;
@@ -229,54 +343,188 @@ bool LoopDesignSpace::evaluateTileConfig(TileConfig config) {
   if (iterNum == 1)
     return false;
 
+  // Clone a temporary loop band by cloning the outermost loop.
+  auto outerLoop = targetBand.front();
+  auto tmpOuterLoop = outerLoop.clone();
+  AffineLoopBand tmpBand;
+  getLoopBandFromOutermost(tmpOuterLoop, tmpBand);
+
+  // Insert the clone loop band to the front of the original band for the
+  // convenience of the estimation.
+  auto builder = OpBuilder(targetFunc);
+  builder.setInsertionPoint(outerLoop);
+  auto prevOp = outerLoop->getPrevNode();
+  builder.insert(tmpOuterLoop);
+
+  // Record the types of all memrefs defined outside of the temporary loop band
+  // and used anywhere in it, such that the array partition applied to the
+  // temporary loop band can be reverted after the estimation.
+  SmallVector<std::pair<Value, Type>, 8> memrefTypes;
+  llvm::SmallDenseSet<Value, 8> memrefs;
+  tmpOuterLoop.walk([&](Operation *op) {
+    for (auto operand : op->getOperands())
+      if (operand.getType().isa<MemRefType>() &&
+          !tmpOuterLoop->isAncestor(operand.getParentBlock()->getParentOp()) &&
+          memrefs.insert(operand).second)
+        memrefTypes.push_back({operand, operand.getType()});
+  });
+
+  // Erase the temporary loop band, which is always located between "prevOp"
+  // and the original loop band even if it has been optimized, and revert the
+  // memref types.
+  auto eraseTmpBand = [&]() {
+    while (outerLoop->getPrevNode() != prevOp)
+      outerLoop->getPrevNode()->erase();
+    for (auto [memref, type] : memrefTypes)
+      memref.setType(type);
+    auto resultTypes = targetFunc.front().getTerminator()->getOperandTypes();
+    auto inputTypes = targetFunc.front().getArgumentTypes();
+    targetFunc.setType(builder.getFunctionType(inputTypes, resultTypes));
+  };
+
   // Apply the current tiling config and start the estimation. Note that after
   // optimization, tmpBand is optimized in place and becomes a new loop band.
-  if (!applyOptStrategy(tmpBand, func, tileList, (unsigned)1))
+  if (!applyBandOptStrategy(tmpBand, targetFunc, tileList, (unsigned)1,
+                            targetPipeline)) {
+    eraseTmpBand();
     return false;
+  }
   tmpOuterLoop = tmpBand.front();
-  estimator.estimateLoop(tmpOuterLoop, func);
+  targetEstimator.estimateLoop(tmpOuterLoop, targetFunc);
+
+  // The extra BRAMs of the on-chip buffers partitioned for the loop band are
+  // charged to the loop band, while the unpartitioned buffers are charged to
+  // the function. This is conservative when several loop bands partition the
+  // same buffer.
+  int64_t partitionBram = 0;
+  for (auto [memref, type] : memrefTypes)
+    if (memref.getDefiningOp<BufferOp>())
+      partitionBram += getBramNum(memref.getType().cast<MemRefType>()) -
+                       getBramNum(type.cast<MemRefType>());
 
   // Fetch latency and resource utilization.
   auto tmpInnerLoop = tmpBand.back();
-  auto info = getLoopInfo(tmpInnerLoop);
-  auto resource = getResource(tmpOuterLoop);
+  auto info = targetEstimator.getLoopInfo(tmpInnerLoop);
+  auto resource = targetEstimator.getResource(tmpOuterLoop);
   assert(info && resource && "loop info or resource is not estimated");
+  auto totalLut = resource.getLut() * info.getMinII();
   auto totalDsp = resource.getDsp() * info.getMinII();
 
   // Improve target II until II is equal to iteration latency. Note that when II
   // equal to iteration latency, the pipeline pragma is similar to a region
-  // fully unroll pragma which unrolls all contained loops.
+  // fully unroll pragma which unrolls all contained loops. The operators are
+  // shared inside of II cycles, while the memories are not shareable.
   for (auto tmpII = info.getMinII(); tmpII <= info.getIterLatency(); ++tmpII) {
-    auto tmpDspNum = totalDsp / tmpII + 1;
+    auto tmpResource = DesignResource(totalLut / tmpII, totalDsp / tmpII + 1,
+                                      resource.getBram() + partitionBram);
     auto tmpLatency = info.getIterLatency() + tmpII * (iterNum - 1) + 2;
-    auto point = LoopDesignPoint(tmpLatency, tmpDspNum, config, tmpII);
-
-    allPoints.push_back(point);
-    if (tmpDspNum <= maxDspNum)
-      paretoPoints.push_back(point);
+    points.push_back(LoopDesignPoint(tmpLatency, tmpResource, config, tmpII));
   }
 
-  // Erase the temporary loop band.
-  tmpOuterLoop.erase();
+  eraseTmpBand();
   return true;
 }
 
-/// Initialize the design space.
-void LoopDesignSpace::initializeLoopDesignSpace(unsigned maxInitParallel) {
-  LLVM_DEBUG(llvm::dbgs() << "Initialize the loop design space...\n";);
+/// Evaluate all design points under the given tile configs. If "numThreads" is
+/// larger than one, the tile configs are evaluated in parallel, where each
+/// worker thread holds its own function clone and estimator.
+void LoopDesignSpace::evaluateTileConfigs(ArrayRef<TileConfig> configs,
+                                          unsigned numThreads) {
+  if (numThreads <= 1) {
+    for (auto config : configs)
+      evaluateTileConfig(config);
+    return;
+  }
 
-  for (TileConfig config = 0; config < validTileConfigNum; ++config) {
-    auto tileList = getTileList(config);
+  // Filter out all tile configs that have been estimated and annotate the
+  // remaining tile configs as estimated.
+  SmallVector<TileConfig, 32> targetConfigs;
+  for (auto config : configs)
+    if (markEstimated(config))
+      targetConfigs.push_back(config);
 
-    // We only evaluate the design points whose overall parallel is smaller
-    // than the maxInitParallel to improve the efficiency.
-    auto parallel = std::accumulate(tileList.begin(), tileList.end(),
-                                    (unsigned)1, std::multiplies<unsigned>());
+  numThreads = std::min(numThreads, (unsigned)targetConfigs.size());
+  if (numThreads == 0)
+    return;
 
-    if (parallel <= maxInitParallel) // || config == parallelConfig)
-      evaluateTileConfig(config);
+  // Clone one function for each worker thread. The outermost loop of the loop
+  // band is tagged before the cloning, so that the corresponding loop band can
+  // be found in the function clones. The clones are detached from the module,
+  // and the evaluation never looks up or updates sub-functions: the array
+  // partition is local to the loop band, and the calls of explored
+  // sub-functions are estimated through their annotations. Therefore, the
+  // worker threads never touch the IR shared with each other.
+  auto context = func.getContext();
+  band.front()->setAttr("opt_flag", BoolAttr::get(context, true));
+  SmallVector<func::FuncOp, 16> workerFuncs;
+  for (unsigned i = 0; i < numThreads; ++i)
+    workerFuncs.push_back(func.clone());
+  band.front()->removeAttr("opt_flag");
+
+  // The memory optimization pipeline holds a pass manager and thus cannot be
+  // shared between threads. Each worker thread holds its own pipeline.
+  SmallVector<std::unique_ptr<MemoryOptsPipeline>, 16> workerPipelines;
+  for (unsigned i = 0; i < numThreads; ++i)
+    workerPipelines.push_back(std::make_unique<MemoryOptsPipeline>(context));
+
+  // Each tile config holds a separate list of design points, thus the worker
+  // threads never write to the same list.
+  std::vector<SmallVector<LoopDesignPoint, 16>> pointsList(
+      targetConfigs.size());
+
+  // Note that all dialects required by the optimization pipeline have been
+  // loaded in the previous DSE stages, so that no dialect is loaded during the
+  // multi-threaded execution.
+  parallelFor(context, 0, numThreads, [&](size_t workerIdx) {
+    auto workerFunc = workerFuncs[workerIdx];
+    auto workerEstimator = estimator.fork();
+    auto &workerPipeline = *workerPipelines[workerIdx];
+
+    AffineForOp workerOuterLoop;
+    workerFunc.walk([&](AffineForOp loop) {
+      if (loop->getAttrOfType<BoolAttr>("opt_flag"))
+        workerOuterLoop = loop;
+    });
+    assert(workerOuterLoop && "failed to find the loop band in the clone");
+    workerOuterLoop->removeAttr("opt_flag");
+
+    AffineLoopBand workerBand;
+    getLoopBandFromOutermost(workerOuterLoop, workerBand);
+
+    for (unsigned i = workerIdx, e = targetConfigs.size(); i < e;
+         i += numThreads)
+      evaluateTileConfig(targetConfigs[i], workerFunc, workerBand,
+                         workerEstimator, workerPipeline, pointsList[i]);
+  });
+
+  // Merge the design points in the order of tile configs to make the result
+  // identical to the serial evaluation.
+  for (auto [config, points] : llvm::zip(targetConfigs, pointsList)) {
+    emitTileListDebugInfo(getTileList(config));
+    for (auto point : points) {
+      allPoints.push_back(point);
+      if (point.resource.fitsIn(maxResource))
+        paretoPoints.push_back(point);
+    }
   }
 
+  for (auto workerFunc : workerFuncs)
+    workerFunc.erase();
+}
+
+/// Initialize the design space.
+void LoopDesignSpace::initializeLoopDesignSpace(unsigned maxInitParallel,
+                                                unsigned numThreads) {
+  LLVM_DEBUG(llvm::dbgs() << "Initialize the loop design space...\n";);
+
+  // We only evaluate the design points whose overall parallel is smaller than
+  // the maxInitParallel to improve the efficiency.
+  SmallVector<TileConfig, 32> initConfigs;
+  for (auto config = getNextValidTileConfig(0, maxInitParallel); config;
+       config = getNextValidTileConfig(config.value() + 1, maxInitParallel))
+    initConfigs.push_back(config.value());
+  evaluateTileConfigs(initConfigs, numThreads);
+
   LLVM_DEBUG(llvm::dbgs() << "\n\n");
   updateParetoPoints(paretoPoints);
 }
@@ -293,13 +541,14 @@ void LoopDesignSpace::dumpLoopDesignSpace(StringRef csvFilePath) {
   // Print header row.
   for (unsigned i = 0; i < tripCountList.size(); ++i)
     os << "l" << i << ",";
-  os << "ii,cycle,dsp,type\n";
+  os << "ii,cycle,lut,dsp,bram,type\n";
 
   // Print pareto design points.
   for (auto &point : paretoPoints) {
     for (auto size : getTileList(point.tileConfig))
       os << size << ",";
-    os << point.targetII << "," << point.latency << "," << point.dspNum
+    os << point.targetII << "," << point.latency << "," << point.resource.lut
+       << "," << point.resource.dsp << "," << point.resource.bram
        << ",pareto\n";
   }
 
@@ -307,7 +556,8 @@ void LoopDesignSpace::dumpLoopDesignSpace(StringRef csvFilePath) {
   for (auto &point : allPoints) {
     for (auto size : getTileList(point.tileConfig))
       os << size << ",";
-    os << point.targetII << "," << point.latency << "," << point.dspNum
+    os << point.targetII << "," << point.latency << "," << point.resource.lut
+       << "," << point.resource.dsp << "," << point.resource.bram
        << ",non-pareto\n";
   }
 
@@ -319,77 +569,409 @@ void LoopDesignSpace::dumpLoopDesignSpace(StringRef csvFilePath) {
 /// Get a random tile config which is one of the closest neighbors of "point".
 Optional<TileConfig>
 LoopDesignSpace::getRandomClosestNeighbor(LoopDesignPoint point,
-                                          float maxDistance) {
-  // Traverse all unestimated tile configs and collect all neighbors.
-  SmallVector<std::pair<float, TileConfig>, 8> candidateConfigs;
-  for (auto config : unestimatedTileConfigs) {
-    auto distance = getTileConfigDistance(point.tileConfig, config);
-    if (distance <= maxDistance)
-      candidateConfigs.push_back(
-          std::pair<float, TileConfig>(distance, config));
-  }
+                                          float maxDistance,
+                                          std::mt19937 &rng) {
+  // Enumerate all tile index vectors within the "maxDistance" ball centered at
+  // the tile indices of "point", and collect the closest unestimated configs.
+  // The squared distance is accumulated in integer to avoid rounding errors.
+  auto centerIndices = getTileIndices(point.tileConfig);
+  auto neighborIndices = centerIndices;
+  int64_t maxDistanceSquare = maxDistance * maxDistance;
+  int64_t minDistanceSquare = maxDistanceSquare;
+  SmallVector<TileConfig, 8> closestConfigs;
+
+  std::function<void(unsigned, int64_t)> enumerate =
+      [&](unsigned dim, int64_t distanceSquare) {
+        if (dim == centerIndices.size()) {
+          auto config = getTileConfigFromIndices(neighborIndices);
+          if (!isUnestimated(config))
+            return;
+          if (distanceSquare < minDistanceSquare) {
+            minDistanceSquare = distanceSquare;
+            closestConfigs.clear();
+          }
+          closestConfigs.push_back(config);
+          return;
+        }
+
+        int64_t center = centerIndices[dim];
+        int64_t size = validTileSizesList[dim].size();
+        int64_t radius = sqrtf(minDistanceSquare - distanceSquare);
+        for (int64_t idx = std::max(center - radius, (int64_t)0),
+                     e = std::min(center + radius, size - 1);
+             idx <= e; ++idx) {
+          auto newDistanceSquare =
+              distanceSquare + (idx - center) * (idx - center);
+          // Prune the sub-lattice that is farther than the closest configs.
+          if (newDistanceSquare > minDistanceSquare)
+            continue;
+          neighborIndices[dim] = idx;
+          enumerate(dim + 1, newDistanceSquare);
+        }
+        neighborIndices[dim] = center;
+      };
+  enumerate(0, 0);
 
-  if (candidateConfigs.empty())
+  if (closestConfigs.empty())
     return Optional<TileConfig>();
 
-  // Sort candidate configs and collect the closest points.
-  llvm::sort(candidateConfigs);
-  SmallVector<TileConfig, 8> closestConfigs;
-  float minDistance = maxDistance;
+  // Randomly pick one as the return point.
+  llvm::shuffle(closestConfigs.begin(), closestConfigs.end(), rng);
+  return closestConfigs.front();
+}
 
-  for (auto configPair : candidateConfigs) {
-    if (configPair.first <= minDistance) {
-      closestConfigs.push_back(configPair.second);
-      minDistance = configPair.first;
-    } else
-      break;
+/// Get a random valid tile config that has not been estimated. The returned
+/// tile config is kept in the remaining tile configs, as it may not be
+/// evaluated by the search strategy.
+Optional<TileConfig>
+LoopDesignSpace::getRandomUnestimatedConfig(std::mt19937 &rng) {
+  if (!isRemainingCollected) {
+    for (auto config = getNextValidTileConfig(0); config;
+         config = getNextValidTileConfig(config.value() + 1))
+      if (!estimatedTileConfigs.count(config.value()))
+        remainingTileConfigs.push_back(config.value());
+    isRemainingCollected = true;
   }
 
-  // Randomly pick one as the return point.
-  std::srand(time(0));
-  llvm::shuffle(closestConfigs.begin(), closestConfigs.end(),
-                []() { return std::rand(); });
+  while (!remainingTileConfigs.empty()) {
+    auto idx = rng() % remainingTileConfigs.size();
+    auto config = remainingTileConfigs[idx];
+    if (isUnestimated(config))
+      return config;
 
-  return closestConfigs.front();
+    // Drop the estimated tile config by swapping it with the last one.
+    remainingTileConfigs[idx] = remainingTileConfigs.back();
+    remainingTileConfigs.pop_back();
+  }
+  return Optional<TileConfig>();
 }
 
-void LoopDesignSpace::exploreLoopDesignSpace(unsigned maxIterNum,
-                                             float maxDistance) {
+void LoopDesignSpace::exploreLoopDesignSpace(SearchStrategy &strategy,
+                                             unsigned maxEvalNum,
+                                             unsigned numThreads) {
   LLVM_DEBUG(llvm::dbgs() << "Explore the loop design space...\n";);
 
   // Exploration loop of the dse.
-  for (unsigned i = 0; i < maxIterNum; ++i) {
-    std::srand(time(0));
-    llvm::shuffle(paretoPoints.begin(), paretoPoints.end(),
-                  []() { return std::rand(); });
+  unsigned evalNum = 0;
+  while (evalNum < maxEvalNum) {
+    SmallVector<TileConfig, 16> configs;
+    strategy.propose(*this, configs, maxEvalNum - evalNum);
+
+    // Early termination if no tile config is proposed.
+    if (configs.empty())
+      break;
+
+    evaluateTileConfigs(configs, numThreads);
+    evalNum += configs.size();
+
+    // Update pareto points after each dse iteration.
+    updateParetoPoints(paretoPoints);
+  }
+  LLVM_DEBUG(llvm::dbgs() << "\n\n";);
+}
+
+//===----------------------------------------------------------------------===//
+// SearchStrategy Class Definition
+//===----------------------------------------------------------------------===//
+
+/// Get the cost of all evaluated tile configs, which is the minimum latency of
+/// the design points of each tile config. The latency of design points that do
+/// not fit in the resource budgets is penalized.
+static void getTileConfigCosts(LoopDesignSpace &space,
+                               DenseMap<TileConfig, double> &costs) {
+  for (auto &point : space.allPoints) {
+    double cost = point.latency;
+    if (!point.resource.fitsIn(space.maxResource))
+      cost *= 16;
+
+    auto result = costs.try_emplace(point.tileConfig, cost);
+    result.first->second = std::min(result.first->second, cost);
+  }
+}
+
+/// Get all unestimated tile configs whose tile indices only differ from the
+/// given tile config by one in one loop.
+static void getUnestimatedNeighbors(LoopDesignSpace &space, TileConfig config,
+                                    SmallVectorImpl<TileConfig> &neighbors) {
+  auto tileIndices = space.getTileIndices(config);
+  for (unsigned i = 0, e = tileIndices.size(); i < e; ++i) {
+    auto neighborIndices = tileIndices;
+    for (int64_t delta : {-1, 1}) {
+      auto idx = (int64_t)tileIndices[i] + delta;
+      if (idx < 0 || idx >= (int64_t)space.validTileSizesList[i].size())
+        continue;
+
+      neighborIndices[i] = idx;
+      auto neighbor = space.getTileConfigFromIndices(neighborIndices);
+      if (space.isUnestimated(neighbor))
+        neighbors.push_back(neighbor);
+    }
+  }
+}
+
+namespace {
+/// Walk from a random pareto point to one of its closest unestimated neighbors.
+class NeighborSearch : public SearchStrategy {
+public:
+  explicit NeighborSearch(unsigned seed, float maxDistance)
+      : SearchStrategy(seed), maxDistance(maxDistance) {}
 
-    bool foundValidNeighbor = false;
-    for (auto &point : paretoPoints) {
+  void propose(LoopDesignSpace &space, SmallVectorImpl<TileConfig> &configs,
+               unsigned maxNum) override {
+    llvm::shuffle(space.paretoPoints.begin(), space.paretoPoints.end(), rng);
+
+    for (auto &point : space.paretoPoints) {
       if (!point.isActive)
         continue;
 
-      auto closestNeighbor = getRandomClosestNeighbor(point, maxDistance);
+      auto closestNeighbor =
+          space.getRandomClosestNeighbor(point, maxDistance, rng);
       if (!closestNeighbor) {
         point.isActive = false;
         continue;
       }
+      configs.push_back(closestNeighbor.value());
+      return;
+    }
+  }
+
+private:
+  float maxDistance;
+};
+
+/// Evaluate all unestimated tile configs in the order of tile configs.
+class ExhaustiveSearch : public SearchStrategy {
+public:
+  using SearchStrategy::SearchStrategy;
+
+  void propose(LoopDesignSpace &space, SmallVectorImpl<TileConfig> &configs,
+               unsigned maxNum) override {
+    while (configs.size() < maxNum) {
+      auto config = space.getNextValidTileConfig(nextConfig);
+      if (!config)
+        break;
+      nextConfig = config.value() + 1;
+      if (space.isUnestimated(config.value()))
+        configs.push_back(config.value());
+    }
+  }
+
+private:
+  TileConfig nextConfig = 0;
+};
+
+/// Anneal from the best evaluated tile config, where a worse neighbor is
+/// accepted with a probability decreasing with the temperature.
+class SimulatedAnnealing : public SearchStrategy {
+public:
+  using SearchStrategy::SearchStrategy;
+
+  void propose(LoopDesignSpace &space, SmallVectorImpl<TileConfig> &configs,
+               unsigned maxNum) override {
+    DenseMap<TileConfig, double> costs;
+    getTileConfigCosts(space, costs);
+
+    // Decide whether to move to the candidate proposed in the last iteration.
+    if (candidate && costs.count(candidate.value())) {
+      auto candidateCost = costs[candidate.value()];
+      if (!current)
+        current = candidate;
+      else {
+        auto currentCost = costs[current.value()];
+        auto delta = (candidateCost - currentCost) / currentCost;
+        auto probability = std::uniform_real_distribution<double>(0, 1)(rng);
+        if (delta <= 0 || probability < std::exp(-delta / temperature))
+          current = candidate;
+      }
+      temperature *= coolingRate;
+    }
+    candidate = Optional<TileConfig>();
+
+    // Start from the best evaluated tile config.
+    if (!current || !costs.count(current.value())) {
+      current = Optional<TileConfig>();
+      double bestCost = 0;
+      for (auto &pair : costs)
+        if (!current || pair.second < bestCost ||
+            (pair.second == bestCost && pair.first < current.value())) {
+          current = pair.first;
+          bestCost = pair.second;
+        }
+    }
 
-      foundValidNeighbor = true;
-      auto config = closestNeighbor.value();
-      auto tileList = getTileList(config);
+    // Propose a random unestimated neighbor of the current tile config. If all
+    // neighbors have been evaluated, restart from a random tile config.
+    SmallVector<TileConfig, 16> neighbors;
+    if (current)
+      getUnestimatedNeighbors(space, current.value(), neighbors);
+    if (!neighbors.empty())
+      candidate = neighbors[rng() % neighbors.size()];
+    else
+      candidate = space.getRandomUnestimatedConfig(rng);
 
-      evaluateTileConfig(config);
-      break;
+    if (candidate)
+      configs.push_back(candidate.value());
+  }
+
+private:
+  Optional<TileConfig> current;
+  Optional<TileConfig> candidate;
+  double temperature = 1.0;
+  double coolingRate = 0.9;
+};
+
+/// Evolve a population of the best evaluated tile configs with tournament
+/// selection, uniform crossover, and mutation.
+class GeneticSearch : public SearchStrategy {
+public:
+  using SearchStrategy::SearchStrategy;
+
+  void propose(LoopDesignSpace &space, SmallVectorImpl<TileConfig> &configs,
+               unsigned maxNum) override {
+    auto childNum = std::min(populationSize, maxNum);
+    DenseMap<TileConfig, double> costs;
+    getTileConfigCosts(space, costs);
+
+    // Select the best evaluated tile configs as the population.
+    SmallVector<std::pair<double, TileConfig>, 32> population;
+    for (auto &pair : costs)
+      population.push_back({pair.second, pair.first});
+    llvm::sort(population);
+    if (population.size() > populationSize)
+      population.resize(populationSize);
+
+    llvm::SmallDenseSet<TileConfig, 16> children;
+    auto addChild = [&](TileConfig config) {
+      if (space.isUnestimated(config) && children.insert(config).second)
+        configs.push_back(config);
+    };
+
+    if (population.size() >= 2) {
+      auto select = [&]() {
+        auto a = population[rng() % population.size()];
+        auto b = population[rng() % population.size()];
+        return space.getTileIndices(std::min(a, b).second);
+      };
+
+      for (unsigned i = 0; i < childNum * 8 && children.size() < childNum;
+           ++i) {
+        auto parentA = select();
+        auto parentB = select();
+
+        SmallVector<unsigned, 8> childIndices;
+        for (unsigned j = 0, e = parentA.size(); j < e; ++j) {
+          auto idx = rng() % 2 ? parentA[j] : parentB[j];
+
+          // Mutate each loop with a probability of 1 / loop number.
+          auto sizeNum = space.validTileSizesList[j].size();
+          if (rng() % e == 0)
+            idx = rng() % 2 ? std::min(idx + 1, (unsigned)sizeNum - 1)
+                            : (idx > 0 ? idx - 1 : 0);
+          childIndices.push_back(idx);
+        }
+        addChild(space.getTileConfigFromIndices(childIndices));
+      }
     }
 
-    // Early termination if no valid neighbor is found.
-    if (!foundValidNeighbor)
-      break;
+    // Fill the population with random tile configs if required.
+    for (unsigned i = 0; i < childNum * 8 && children.size() < childNum; ++i)
+      if (auto config = space.getRandomUnestimatedConfig(rng))
+        addChild(config.value());
+      else
+        break;
+  }
 
-    // Update pareto points after each dse iteration.
-    updateParetoPoints(paretoPoints);
+private:
+  unsigned populationSize = 8;
+};
+
+/// Fit a local surrogate model with the nearest evaluated tile configs, and
+/// propose the candidate with the lowest confidence bound of the predicted
+/// cost. The candidates include the unestimated neighbors of the best tile
+/// configs and random unestimated tile configs.
+class BayesianSearch : public SearchStrategy {
+public:
+  using SearchStrategy::SearchStrategy;
+
+  void propose(LoopDesignSpace &space, SmallVectorImpl<TileConfig> &configs,
+               unsigned maxNum) override {
+    DenseMap<TileConfig, double> costs;
+    getTileConfigCosts(space, costs);
+
+    SmallVector<std::pair<double, TileConfig>, 64> evaluated;
+    for (auto &pair : costs)
+      evaluated.push_back({std::log(pair.second + 1), pair.first});
+    llvm::sort(evaluated);
+
+    // Collect candidates from the neighbors of the best tile configs and random
+    // tile configs.
+    SmallVector<TileConfig, 64> candidates;
+    for (unsigned i = 0, e = std::min((unsigned)evaluated.size(), 4u); i < e;
+         ++i)
+      getUnestimatedNeighbors(space, evaluated[i].second, candidates);
+    for (unsigned i = 0; i < 16; ++i)
+      if (auto config = space.getRandomUnestimatedConfig(rng))
+        candidates.push_back(config.value());
+
+    if (candidates.empty())
+      return;
+    if (evaluated.empty()) {
+      configs.push_back(candidates.front());
+      return;
+    }
+
+    Optional<TileConfig> bestCandidate;
+    double bestBound = 0;
+    for (auto candidate : candidates) {
+      // Predict the cost with the inverse distance weighted mean of the costs
+      // of the nearest evaluated tile configs. The distance to the nearest one
+      // is used as the uncertainty of the prediction.
+      SmallVector<std::pair<float, double>, 64> neighbors;
+      for (auto &pair : evaluated)
+        neighbors.push_back(
+            {space.getTileConfigDistance(candidate, pair.second), pair.first});
+      llvm::sort(neighbors);
+      if (neighbors.size() > neighborNum)
+        neighbors.resize(neighborNum);
+
+      double weightSum = 0;
+      double prediction = 0;
+      for (auto &neighbor : neighbors) {
+        auto weight = 1.0 / (neighbor.first * neighbor.first);
+        weightSum += weight;
+        prediction += weight * neighbor.second;
+      }
+      prediction /= weightSum;
+
+      auto bound = prediction - exploreRate * neighbors.front().first;
+      if (!bestCandidate || bound < bestBound) {
+        bestCandidate = candidate;
+        bestBound = bound;
+      }
+    }
+    configs.push_back(bestCandidate.value());
   }
-  LLVM_DEBUG(llvm::dbgs() << "\n\n";);
+
+private:
+  unsigned neighborNum = 4;
+  double exploreRate = 0.5;
+};
+} // namespace
+
+std::unique_ptr<SearchStrategy>
+scalehls::createSearchStrategy(StringRef name, unsigned seed,
+                               float maxDistance) {
+  if (name == "neighbor")
+    return std::make_unique<NeighborSearch>(seed, maxDistance);
+  if (name == "exhaustive")
+    return std::make_unique<ExhaustiveSearch>(seed);
+  if (name == "annealing")
+    return std::make_unique<SimulatedAnnealing>(seed);
+  if (name == "genetic")
+    return std::make_unique<GeneticSearch>(seed);
+  if (name == "bayesian")
+    return std::make_unique<BayesianSearch>(seed);
+  return nullptr;
 }
 
 //===----------------------------------------------------------------------===//
@@ -411,7 +993,9 @@ void FuncDesignSpace::dumpFuncDesignSpace(StringRef csvFilePath) {
       os << "b" << i << "l" << j << ",";
     os << "b" << i << "ii,";
   }
-  os << "cycle,dsp,type\n";
+  for (auto callee : calleeNames)
+    os << callee << ",";
+  os << "cycle,lut,dsp,bram,type\n";
 
   // Print pareto design points.
   for (auto &funcPoint : paretoPoints) {
@@ -423,7 +1007,11 @@ void FuncDesignSpace::dumpFuncDesignSpace(StringRef csvFilePath) {
         os << size << ",";
       os << loopPoint.targetII << ",";
     }
-    os << funcPoint.latency << "," << funcPoint.dspNum << ",pareto\n";
+    for (auto index : funcPoint.calleeDesignPoints)
+      os << index << ",";
+    os << funcPoint.latency << "," << funcPoint.resource.lut << ","
+       << funcPoint.resource.dsp << "," << funcPoint.resource.bram
+       << ",pareto\n";
   }
 
   csvFile->keep();
@@ -431,65 +1019,112 @@ void FuncDesignSpace::dumpFuncDesignSpace(StringRef csvFilePath) {
                           << csvFilePath << "\".\n\n");
 }
 
-void FuncDesignSpace::combLoopDesignSpaces() {
-  LLVM_DEBUG(llvm::dbgs() << "Combine the loop design spaces...\n";);
+/// Annotate the call with the given design point of the sub-function, such that
+/// the call can be estimated and partitioned without looking up the callee.
+static void annotateCall(func::CallOp call, const CalleeDesignPoint &point) {
+  call->setAttr("no_touch", BoolAttr::get(call.getContext(), true));
+  setTiming(call, -1, -1, point.latency, point.interval);
+  setResource(call, point.resource.lut, point.resource.dsp,
+              point.resource.bram);
+  setCalleeArgTypes(call, point.argTypes);
+}
 
-  // Initialize the function design space with the first loop design space.
-  auto &firstLoopSpace = loopDesignSpaces[0];
-  for (auto &loopPoint : firstLoopSpace.paretoPoints) {
-    // Annotate the first loop.
-    auto loop = targetLoops[0];
+void FuncDesignSpace::annotateFuncDesignPoint(const FuncDesignPoint &point) {
+  for (auto [loop, loopPoint] :
+       llvm::zip(targetLoops, point.loopDesignPoints)) {
     setTiming(loop, -1, -1, loopPoint.latency, -1);
-    setResource(loop, -1, loopPoint.dspNum, -1);
+    setResource(loop, loopPoint.resource.lut, loopPoint.resource.dsp,
+                loopPoint.resource.bram);
+  }
 
-    // Estimate the function and generate a new function design point.
-    estimator.estimateFunc(func);
-    auto latency = getTiming(func).getLatency();
-    auto dspNum = getResource(func).getDsp();
-    auto funcPoint = FuncDesignPoint(latency, dspNum, loopPoint);
+  for (auto [calls, calleeSpace, index] :
+       llvm::zip(targetCalls, calleeDesignSpaces, point.calleeDesignPoints)) {
+    for (auto call : calls)
+      annotateCall(call, calleeSpace->paretoPoints[index]);
+  }
+}
 
-    paretoPoints.push_back(funcPoint);
+/// Apply the given function design point to a clone of the function. The calls
+/// of explored sub-functions are annotated with their selected design points
+/// before cloning, thus the clone never looks up the sub-functions.
+func::FuncOp
+FuncDesignSpace::applyFuncDesignPoint(const FuncDesignPoint &point) {
+  std::vector<FactorList> tileLists;
+  SmallVector<unsigned, 4> targetIIs;
+  for (unsigned i = 0; i < loopDesignSpaces.size(); ++i) {
+    auto &loopPoint = point.loopDesignPoints[i];
+    tileLists.push_back(loopDesignSpaces[i].getTileList(loopPoint.tileConfig));
+    targetIIs.push_back(loopPoint.targetII);
   }
 
-  updateParetoPoints(paretoPoints);
-  LLVM_DEBUG(llvm::dbgs() << "Iteration 0 pareto points number: "
-                          << paretoPoints.size() << "\n";);
+  annotateFuncDesignPoint(point);
+  auto tmpFunc = func.clone();
+  if (!applyOptStrategy(tmpFunc, tileLists, targetIIs, pipeline)) {
+    tmpFunc.erase();
+    return nullptr;
+  }
+  return tmpFunc;
+}
 
-  // Combine other loop design spaces to the function design space one by one.
-  for (unsigned i = 1, e = loopDesignSpaces.size(); i < e; ++i) {
-    SmallVector<FuncDesignPoint, 16> newParetoPoints;
-    auto &loopSpace = loopDesignSpaces[i];
+/// Combine all sub-function and loop design spaces. Since only the annotations
+/// of the no_touch target calls and loops are changed between two estimations,
+/// the function is estimated incrementally, where the schedules of untouched
+/// loops are reused.
+void FuncDesignSpace::combLoopDesignSpaces() {
+  LLVM_DEBUG(llvm::dbgs() << "Combine the loop design spaces...\n";);
 
-    // Traverse all function design points.
-    for (auto &funcPoint : paretoPoints) {
-      // Annotate latency and dsp to all loops that are already included in the
-      // function point, they are static for all design points of the new loop.
-      for (unsigned ii = 0; ii < i; ++ii) {
-        auto &oldLoopPoint = funcPoint.loopDesignPoints[ii];
-        auto oldLoop = targetLoops[ii];
-        setTiming(oldLoop, -1, -1, oldLoopPoint.latency, -1);
-        setResource(oldLoop, -1, oldLoopPoint.dspNum, -1);
-      }
+  auto estimatePoint = [&](FuncDesignPoint &point) {
+    annotateFuncDesignPoint(point);
+    estimator.estimateFuncIncrementally(func);
+    auto timing = estimator.getTiming(func);
+    point.latency = timing.getLatency();
+    point.interval = timing.getInterval();
+    point.resource = DesignResource(estimator.getResource(func));
+  };
 
-      // Traverse all design points of the NEW loop.
-      for (auto &loopPoint : loopSpace.paretoPoints) {
-        // Annotate the new loop,
-        auto loop = targetLoops[i];
-        setTiming(loop, -1, -1, loopPoint.latency, -1);
-        setResource(loop, -1, loopPoint.dspNum, -1);
+  // Initialize the function design space with an empty design point, where no
+  // call or loop is annotated yet.
+  paretoPoints.clear();
+  paretoPoints.push_back(FuncDesignPoint(0, DesignResource()));
+  estimatePoint(paretoPoints.front());
 
-        // Estimate the function and generate a new function design point.
-        auto loopPoints = funcPoint.loopDesignPoints;
-        loopPoints.push_back(loopPoint);
+  // Combine the sub-function design spaces to the function design space one by
+  // one. The annotations of the calls and loops that are already included in
+  // the function point are static for all design points of the new dimension.
+  for (unsigned i = 0, e = calleeDesignSpaces.size(); i < e; ++i) {
+    SmallVector<FuncDesignPoint, 16> newParetoPoints;
+    auto &calleeSpace = *calleeDesignSpaces[i];
+    for (auto &funcPoint : paretoPoints)
+      for (unsigned j = 0, ej = calleeSpace.paretoPoints.size(); j < ej; ++j) {
+        // Only the applied design point can be selected if the sub-function
+        // has been applied.
+        if (calleeSpace.appliedPoint && j != calleeSpace.appliedPoint.value())
+          continue;
+
+        auto newFuncPoint = funcPoint;
+        newFuncPoint.calleeDesignPoints.push_back(j);
+        estimatePoint(newFuncPoint);
+        newParetoPoints.push_back(newFuncPoint);
+      }
 
-        estimator.estimateFunc(func);
-        auto latency = getTiming(func).getLatency();
-        auto dspNum = getResource(func).getDsp();
-        auto newFuncPoint = FuncDesignPoint(latency, dspNum, loopPoints);
+    // Update pareto points after each combination.
+    updateParetoPoints(newParetoPoints);
+    paretoPoints = newParetoPoints;
+    LLVM_DEBUG(llvm::dbgs() << "Callee " << calleeNames[i]
+                            << " pareto points number: " << paretoPoints.size()
+                            << "\n";);
+  }
 
+  // Combine the loop design spaces to the function design space one by one.
+  for (unsigned i = 0, e = loopDesignSpaces.size(); i < e; ++i) {
+    SmallVector<FuncDesignPoint, 16> newParetoPoints;
+    for (auto &funcPoint : paretoPoints)
+      for (auto &loopPoint : loopDesignSpaces[i].paretoPoints) {
+        auto newFuncPoint = funcPoint;
+        newFuncPoint.loopDesignPoints.push_back(loopPoint);
+        estimatePoint(newFuncPoint);
         newParetoPoints.push_back(newFuncPoint);
       }
-    }
 
     // Update pareto points after each combination.
     updateParetoPoints(newParetoPoints);
@@ -510,24 +1145,12 @@ bool FuncDesignSpace::exportParetoDesigns(unsigned outputNum,
   for (auto &funcPoint : paretoPoints) {
     // Only export sampled points.
     if (sampleIndex % sampleStep == 0) {
-      std::vector<FactorList> tileLists;
-      SmallVector<unsigned, 4> targetIIs;
-
-      for (unsigned i = 0; i < loopDesignSpaces.size(); ++i) {
-        auto &loopSpace = loopDesignSpaces[i];
-        auto &loopPoint = funcPoint.loopDesignPoints[i];
-        auto tileList = loopSpace.getTileList(loopPoint.tileConfig);
-        auto targetII = loopPoint.targetII;
-
-        tileLists.push_back(tileList);
-        targetIIs.push_back(targetII);
-      }
-
       // Clone a new function and apply optimization.
-      auto tmpFunc = func.clone();
-      if (!applyOptStrategy(tmpFunc, tileLists, targetIIs))
+      auto tmpFunc = applyFuncDesignPoint(funcPoint);
+      if (!tmpFunc)
         return false;
-      estimator.estimateFunc(tmpFunc);
+      estimator.estimateFunc(tmpFunc, /*useCache=*/false);
+      estimator.materializeResults(tmpFunc);
 
       // Parse a new output file.
       auto outputFilePath = outputRootPath.str() + func.getName().str() +
@@ -535,12 +1158,15 @@ bool FuncDesignSpace::exportParetoDesigns(unsigned outputNum,
 
       std::string errorMessage;
       auto outputFile = mlir::openOutputFile(outputFilePath, &errorMessage);
-      if (!outputFile)
+      if (!outputFile) {
+        tmpFunc.erase();
         return false;
+      }
 
       auto &os = outputFile->os();
       os << tmpFunc << "\n";
       outputFile->keep();
+      tmpFunc.erase();
     }
     ++sampleIndex;
   }
@@ -555,18 +1181,26 @@ bool FuncDesignSpace::exportParetoDesigns(unsigned outputNum,
 // Explorer Class Definition
 //===----------------------------------------------------------------------===//
 
+ScaleHLSExplorer::~ScaleHLSExplorer() {
+  for (auto &space : calleeSpaces)
+    if (auto originalFunc = space.second.originalFunc)
+      originalFunc.erase();
+}
+
 bool ScaleHLSExplorer::emitQoRDebugInfo(func::FuncOp func,
                                         std::string message) {
-  estimator.estimateFunc(func);
-  // auto latency = getTiming(func).getLatency();
-  auto dspNum = getResource(func).getDsp();
+  estimator.estimateFunc(func, /*useCache=*/false);
+  estimator.materializeResults(func);
+  // auto latency = estimator.getTiming(func).getLatency();
+  auto resource = DesignResource(estimator.getResource(func));
 
   LLVM_DEBUG(llvm::dbgs() << message + "\n";
              //  llvm::dbgs() << "The clock cycle is " << Twine(latency)
-             //               << ", DSP usage is " << Twine(dspNum) << ".\n\n";
+             //               << ", DSP usage is " << Twine(resource.dsp)
+             //               << ".\n\n";
   );
 
-  return dspNum <= maxDspNum;
+  return resource.fitsIn(maxResource);
 }
 
 static int64_t getInnerParallelism(Block &block) {
@@ -585,6 +1219,109 @@ static int64_t getInnerParallelism(Block &block) {
 
 bool ScaleHLSExplorer::evaluateFuncPipeline(func::FuncOp func) { return true; }
 
+void ScaleHLSExplorer::annotateCallees(func::FuncOp tmpFunc,
+                                       func::FuncOp func) {
+  llvm::StringMap<Optional<CalleeDesignPoint>> defaultPoints;
+  tmpFunc.walk([&](func::CallOp call) {
+    auto it = calleeSpaces.find(call.getCallee());
+    if (it == calleeSpaces.end() || it->second.paretoPoints.empty()) {
+      // The sub-functions that are not explored are estimated as they are in
+      // the module, which is not visible from the detached clone.
+      auto result = defaultPoints.try_emplace(call.getCallee());
+      auto &defaultPoint = result.first->second;
+      if (result.second) {
+        auto callee = SymbolTable::lookupNearestSymbolFrom<func::FuncOp>(
+            func, call.getCalleeAttr());
+        if (!callee || callee.isDeclaration())
+          return;
+
+        auto calleeEstimator = estimator.fork();
+        calleeEstimator.estimateFunc(callee);
+        auto timing = calleeEstimator.getTiming(callee);
+        if (!timing)
+          return;
+
+        CalleeDesignPoint point;
+        point.latency = timing.getLatency();
+        point.interval = timing.getInterval();
+        point.resource = DesignResource(calleeEstimator.getResource(callee));
+        point.argTypes = llvm::to_vector<4>(callee.getArgumentTypes());
+        defaultPoint = point;
+      }
+      if (defaultPoint)
+        annotateCall(call, defaultPoint.value());
+      return;
+    }
+
+    // The default design point is the applied one, or the one with the
+    // minimum latency.
+    auto &space = it->second;
+    auto point = llvm::min_element(space.paretoPoints, [](auto &a, auto &b) {
+      return a.latency < b.latency;
+    });
+    if (space.appliedPoint)
+      point = &space.paretoPoints[space.appliedPoint.value()];
+    annotateCall(call, *point);
+  });
+}
+
+bool ScaleHLSExplorer::applyCalleeDesignPoint(func::FuncOp func,
+                                              StringRef callee, unsigned index,
+                                              MemoryOptsPipeline &pipeline) {
+  auto &space = calleeSpaces[callee];
+  if (space.appliedPoint && space.appliedPoint.value() == index)
+    return true;
+
+  auto context = func.getContext();
+  auto calleeFunc = SymbolTable::lookupNearestSymbolFrom<func::FuncOp>(
+      func, StringAttr::get(context, callee));
+  if (!calleeFunc)
+    return false;
+
+  // Redirect all calls of the sub-function in "func" to the given function.
+  auto redirectCalls = [&](StringRef newCallee) {
+    func.walk([&](func::CallOp call) {
+      if (call.getCallee() == callee)
+        call.setCalleeAttr(FlatSymbolRefAttr::get(context, newCallee));
+    });
+  };
+
+  if (!space.appliedPoint)
+    space.appliedPoint = index;
+  else {
+    // The sub-function has been applied with a different design point selected
+    // by another caller. Reuse the specialized sub-function of the selected
+    // design point if it exists, otherwise clone a new one.
+    auto it = space.specializedFuncs.find(index);
+    if (it != space.specializedFuncs.end()) {
+      redirectCalls(it->second);
+      return true;
+    }
+
+    auto module = calleeFunc->getParentOfType<ModuleOp>();
+    if (!module || !space.originalFunc)
+      return false;
+    calleeFunc = space.originalFunc.clone();
+    SymbolTable(module).insert(calleeFunc);
+    space.specializedFuncs[index] = calleeFunc.getName().str();
+    redirectCalls(calleeFunc.getName());
+
+    LLVM_DEBUG(llvm::dbgs() << "Specialize callee " << callee << " as "
+                            << calleeFunc.getName() << " for design point "
+                            << index << "\n");
+  }
+
+  // Apply the selected design points of nested sub-functions before the
+  // sub-function itself.
+  auto &point = space.paretoPoints[index];
+  for (auto [nestedCallee, nestedIndex] : point.calleeDesignPoints)
+    if (!applyCalleeDesignPoint(calleeFunc, nestedCallee, nestedIndex,
+                                pipeline))
+      return false;
+  return applyOptStrategy(calleeFunc, point.tileLists, point.targetIIs,
+                          pipeline);
+}
+
 /// DSE Stage1: Simplify loop nests by unrolling. If we take the following loops
 /// as example, where each nodes represents one sequential loop nests (LN). In
 /// the simplification, we'll first try to pipeline LN1 and LN6. Suppose
@@ -624,6 +1361,7 @@ bool ScaleHLSExplorer::simplifyLoopNests(func::FuncOp func) {
   auto funcForOps = func.getOps<AffineForOp>();
   auto targetLoops =
       SmallVector<AffineForOp, 8>(funcForOps.begin(), funcForOps.end());
+  MemoryOptsPipeline pipeline(func.getContext());
 
   while (!targetLoops.empty()) {
     SmallVector<std::pair<int64_t, AffineForOp>, 8> candidateLoops;
@@ -661,13 +1399,14 @@ bool ScaleHLSExplorer::simplifyLoopNests(func::FuncOp func) {
       // Create a temporary function.
       candidate->setAttr("opt_flag", BoolAttr::get(func.getContext(), true));
       auto tmpFunc = func.clone();
+      annotateCallees(tmpFunc, func);
 
       // Find the candidate loop in the temporary function and apply fully loop
       // unrolling to it.
       tmpFunc.walk([&](AffineForOp loop) {
         if (loop->getAttrOfType<BoolAttr>("opt_flag")) {
           applyFullyLoopUnrolling(*loop.getBody());
-          applyMemoryOpts(tmpFunc);
+          pipeline.apply(tmpFunc);
           applyAutoArrayPartition(tmpFunc);
           return;
         }
@@ -677,9 +1416,9 @@ bool ScaleHLSExplorer::simplifyLoopNests(func::FuncOp func) {
       estimator.estimateFunc(tmpFunc);
 
       // Fully unroll the candidate loop or delve into child loops.
-      if (getResource(tmpFunc).getDsp() <= maxDspNum) {
+      if (DesignResource(estimator.getResource(tmpFunc)).fitsIn(maxResource)) {
         applyFullyLoopUnrolling(*candidate.getBody());
-        applyMemoryOpts(func);
+        pipeline.apply(func);
         applyAutoArrayPartition(func);
       } else {
         auto childForOps = candidate.getOps<AffineForOp>();
@@ -724,29 +1463,39 @@ bool ScaleHLSExplorer::optimizeLoopBands(func::FuncOp func,
 }
 
 /// DSE Stage3: Explore the function design space through dynamic programming.
-bool ScaleHLSExplorer::exploreDesignSpace(func::FuncOp func, bool directiveOnly,
-                                          StringRef outputRootPath,
-                                          StringRef csvRootPath) {
+LogicalResult ScaleHLSExplorer::exploreDesignSpace(func::FuncOp func,
+                                                   bool directiveOnly,
+                                                   StringRef outputRootPath,
+                                                   StringRef csvRootPath,
+                                                   bool isSubFunc) {
   LLVM_DEBUG(llvm::dbgs() << "----------\nStage3: Conduct top function design "
                              "space exploration...\n";);
 
   auto tmpFunc = func.clone();
+  annotateCallees(tmpFunc, func);
   AffineLoopBands targetBands;
   getLoopBands(tmpFunc.front(), targetBands);
   unsigned targetNum = targetBands.size();
+  MemoryOptsPipeline pipeline(func.getContext());
 
   // Search for the pareto frontiers of each target loop band.
   SmallVector<LoopDesignSpace, 4> loopSpaces;
   for (unsigned i = 0; i < targetNum; ++i) {
-    auto space =
-        LoopDesignSpace(tmpFunc, targetBands[i], estimator, maxDspNum,
-                        maxExplParallel, maxLoopParallel, directiveOnly);
+    auto space = LoopDesignSpace(tmpFunc, targetBands[i], estimator, pipeline,
+                                 maxResource, maxExplParallel,
+                                 maxLoopParallel, directiveOnly);
+    if (!space.isValid()) {
+      tmpFunc.erase();
+      return failure();
+    }
 
     LLVM_DEBUG(llvm::dbgs() << "Loop band " << i << ": ";);
-    space.initializeLoopDesignSpace(maxInitParallel);
+    space.initializeLoopDesignSpace(maxInitParallel, numThreads);
 
     LLVM_DEBUG(llvm::dbgs() << "Loop band " << i << ": ";);
-    space.exploreLoopDesignSpace(maxIterNum, maxDistance);
+    auto strategy =
+        createSearchStrategy(searchStrategy, searchSeed, maxDistance);
+    space.exploreLoopDesignSpace(*strategy, maxIterNum, numThreads);
     loopSpaces.push_back(space);
 
     // Dump design points to csv file for each loop band.
@@ -755,9 +1504,13 @@ bool ScaleHLSExplorer::exploreDesignSpace(func::FuncOp func, bool directiveOnly,
     space.dumpLoopDesignSpace(loopCsvFilePath);
   }
 
-  // Combine all loop design spaces into a function design space.
-  tmpFunc = func.clone();
-  auto funcSpace = FuncDesignSpace(tmpFunc, loopSpaces, estimator, maxDspNum);
+  // Combine all sub-function and loop design spaces into a function design
+  // space. All calls are annotated with default design points beforehand, such
+  // that the calls not combined yet are still estimated correctly.
+  auto combFunc = func.clone();
+  annotateCallees(combFunc, func);
+  auto funcSpace = FuncDesignSpace(combFunc, loopSpaces, calleeSpaces,
+                                   estimator, pipeline, maxResource);
   funcSpace.combLoopDesignSpaces();
 
   // Dump design points to csv file for each function.
@@ -768,9 +1521,56 @@ bool ScaleHLSExplorer::exploreDesignSpace(func::FuncOp func, bool directiveOnly,
   // Export sampled pareto points MLIR source.
   funcSpace.exportParetoDesigns(outputNum, outputRootPath);
 
-  // Apply the best function design point under the constraints.
+  // The design points of a sub-function are not applied until one of them is
+  // selected in the exploration of its callers. Only the design points under
+  // the constraints are recorded if there is any.
+  if (isSubFunc) {
+    auto &calleeSpace = calleeSpaces[func.getName()];
+    calleeSpace.originalFunc = func.clone();
+    auto &calleePoints = calleeSpace.paretoPoints;
+    for (bool onlyFeasible : {true, false}) {
+      for (auto &funcPoint : funcSpace.paretoPoints) {
+        if (onlyFeasible && !funcPoint.resource.fitsIn(maxResource))
+          continue;
+
+        // The argument types of the sub-function are decided by the array
+        // partition applied under the design point.
+        auto pointFunc = funcSpace.applyFuncDesignPoint(funcPoint);
+        if (!pointFunc)
+          continue;
+
+        CalleeDesignPoint calleePoint;
+        calleePoint.latency = funcPoint.latency;
+        calleePoint.interval = funcPoint.interval;
+        calleePoint.resource = funcPoint.resource;
+        calleePoint.argTypes = llvm::to_vector<4>(pointFunc.getArgumentTypes());
+        pointFunc.erase();
+        for (unsigned i = 0; i < targetNum; ++i) {
+          auto &loopPoint = funcPoint.loopDesignPoints[i];
+          calleePoint.tileLists.push_back(
+              funcSpace.loopDesignSpaces[i].getTileList(loopPoint.tileConfig));
+          calleePoint.targetIIs.push_back(loopPoint.targetII);
+        }
+        for (auto [callee, index] : llvm::zip(funcSpace.calleeNames,
+                                              funcPoint.calleeDesignPoints))
+          calleePoint.calleeDesignPoints.push_back({callee, index});
+        calleePoints.push_back(calleePoint);
+      }
+      if (!calleePoints.empty())
+        break;
+    }
+    combFunc.erase();
+    tmpFunc.erase();
+    return success();
+  }
+  combFunc.erase();
+  tmpFunc.erase();
+
+  // Apply the best function design point under the constraints. The design
+  // points of sub-functions are applied before the function, such that the
+  // array partitions of the sub-functions are propagated to the function.
   for (auto &funcPoint : funcSpace.paretoPoints) {
-    if (funcPoint.dspNum <= maxDspNum) {
+    if (funcPoint.resource.fitsIn(maxResource)) {
       std::vector<FactorList> tileLists;
       SmallVector<unsigned, 4> targetIIs;
 
@@ -789,13 +1589,25 @@ bool ScaleHLSExplorer::exploreDesignSpace(func::FuncOp func, bool directiveOnly,
         targetIIs.push_back(targetII);
       }
 
-      if (!applyOptStrategy(func, tileLists, targetIIs))
-        return false;
+      for (auto [callee, index] : llvm::zip(funcSpace.calleeNames,
+                                            funcPoint.calleeDesignPoints)) {
+        LLVM_DEBUG(llvm::dbgs() << "Callee " << callee << ": "
+                                << "Design point " << index << "\n");
+        if (!applyCalleeDesignPoint(func, callee, index, pipeline))
+          return func.emitError("failed to apply the design point of ")
+                 << callee;
+      }
+
+      // If the tiling or pipelining can't be applied, the function is left
+      // unoptimized.
+      if (!applyOptStrategy(func, tileLists, targetIIs, pipeline))
+        return success();
       break;
     }
   }
 
-  return emitQoRDebugInfo(func, "\nFinish Stage3.");
+  emitQoRDebugInfo(func, "\nFinish Stage3.");
+  return success();
 }
 
 //===----------------------------------------------------------------------===//
@@ -803,24 +1615,67 @@ bool ScaleHLSExplorer::exploreDesignSpace(func::FuncOp func, bool directiveOnly,
 //===----------------------------------------------------------------------===//
 
 /// This is a temporary approach that does not scale.
-void ScaleHLSExplorer::applyDesignSpaceExplore(func::FuncOp func,
-                                               bool directiveOnly,
-                                               StringRef outputRootPath,
-                                               StringRef csvRootPath) {
+LogicalResult ScaleHLSExplorer::applyDesignSpaceExplore(
+    func::FuncOp func, bool directiveOnly, StringRef outputRootPath,
+    StringRef csvRootPath, bool isSubFunc) {
   emitQoRDebugInfo(func, "Start multiple level DSE.");
 
-  // Simplify loop nests by unrolling.
+  // Simplify loop nests by unrolling. If the resource budgets are exceeded,
+  // the function is not explored further.
   if (!simplifyLoopNests(func))
-    return;
+    return success();
 
   // Optimize loop bands by loop perfection, loop order permutation, and loop
   // rectangularization.
   if (!optimizeLoopBands(func, directiveOnly))
-    return;
+    return success();
 
   // Explore the design space through a multiple level approach.
-  if (!exploreDesignSpace(func, directiveOnly, outputRootPath, csvRootPath))
-    return;
+  return exploreDesignSpace(func, directiveOnly, outputRootPath, csvRootPath,
+                            isSubFunc);
+}
+
+/// Return whether the function contains any loop or call.
+static bool hasLoopOrCall(func::FuncOp func) {
+  return func
+      .walk([](Operation *op) {
+        if (isa<AffineForOp, func::CallOp>(op))
+          return WalkResult::interrupt();
+        return WalkResult::advance();
+      })
+      .wasInterrupted();
+}
+
+LogicalResult ScaleHLSExplorer::applyHierarchicalDesignSpaceExplore(
+    func::FuncOp topFunc, CallGraph &callGraph, bool directiveOnly,
+    StringRef outputRootPath, StringRef csvRootPath) {
+  auto topNode = callGraph.lookupNode(&topFunc.getBody());
+  if (!topNode)
+    return success();
+
+  // Explore the sub-functions in a post order of the call graph, such that all
+  // callees have been explored before their callers.
+  for (auto node : llvm::post_order<const CallGraphNode *>(topNode)) {
+    if (node->isExternal())
+      continue;
+    auto func =
+        dyn_cast<func::FuncOp>(node->getCallableRegion()->getParentOp());
+    if (!func || func.isDeclaration() || calleeSpaces.count(func.getName()))
+      continue;
+
+    // The sub-functions without any loop or call have nothing to explore. They
+    // are left untouched and estimated as they are at their call sites.
+    if (func != topFunc && !hasLoopOrCall(func))
+      continue;
+
+    LLVM_DEBUG(llvm::dbgs() << "==========\nExplore function "
+                            << func.getName() << "...\n";);
+    if (failed(applyDesignSpaceExplore(func, directiveOnly, outputRootPath,
+                                       csvRootPath,
+                                       /*isSubFunc=*/func != topFunc)))
+      return failure();
+  }
+  return success();
 }
 
 namespace {
@@ -869,34 +1724,80 @@ struct DesignSpaceExplore : public DesignSpaceExploreBase<DesignSpaceExplore> {
     unsigned maxIterNum = configObj->getInteger("max_iter_num").value_or(30);
     float maxDistance = configObj->getNumber("max_distance").value_or(3.0);
 
+    // The search strategy of loop design spaces and its random seed.
+    auto searchStrategy =
+        configObj->getString("search_strategy").value_or("neighbor");
+    unsigned searchSeed = configObj->getInteger("search_seed").value_or(0);
+    if (!createSearchStrategy(searchStrategy, searchSeed, maxDistance)) {
+      llvm::errs() << "unknown search strategy \"" << searchStrategy << "\"\n";
+      return signalPassFailure();
+    }
+
+    // The number of worker threads used for evaluating tile configs, where 0
+    // indicates using all available hardware threads.
+    unsigned numThreads = configObj->getInteger("num_threads").value_or(1);
+    if (numThreads == 0)
+      numThreads = llvm::hardware_concurrency().compute_thread_count();
+
     bool directiveOnly =
         configObj->getBoolean("directive_only").value_or(false);
     bool resourceConstr =
         configObj->getBoolean("resource_constr").value_or(true);
 
-    // Collect profiling latency and DSP usage data, where default values are
-    // based on Xilinx PYNQ-Z1 board.
+    // Collect profiling latency, DSP and LUT usage data, where default values
+    // are based on Xilinx PYNQ-Z1 board.
     llvm::StringMap<int64_t> latencyMap;
     getLatencyMap(configObj, latencyMap);
     llvm::StringMap<int64_t> dspUsageMap;
     getDspUsageMap(configObj, dspUsageMap);
+    llvm::StringMap<int64_t> lutUsageMap;
+    getLutUsageMap(configObj, lutUsageMap);
+
+    // Collect the resource budgets of the target device, where default values
+    // are based on Xilinx PYNQ-Z1 board. LUT is only constrained if specified.
+    auto maxResource = DesignResource(INT64_MAX, INT64_MAX, INT64_MAX);
+    if (resourceConstr) {
+      if (auto lut = configObj->getInteger("lut"))
+        maxResource.lut = ceil(lut.value() * 1.1);
+      maxResource.dsp = ceil(configObj->getInteger("dsp").value_or(220) * 1.1);
+      maxResource.bram =
+          ceil(configObj->getInteger("bram").value_or(280) * 1.1);
+    }
 
-    unsigned maxDspNum = ceil(configObj->getInteger("dsp").value_or(220) * 1.1);
-    if (!resourceConstr)
-      maxDspNum = UINT_MAX;
-
-    // Initialize an performance and resource estimator.
-    auto estimator = ScaleHLSEstimator(latencyMap, dspUsageMap, true);
-    auto explorer = ScaleHLSExplorer(estimator, outputNum, maxDspNum,
+    // Initialize an performance and resource estimator. All estimations in the
+    // DSE share the same QoR cache. If a cache file is specified, the cache is
+    // loaded before and saved after the DSE. The estimation results are only
+    // materialized as attributes when the explored designs are emitted.
+    auto qorCachePath = configObj->getString("qor_cache").value_or("");
+    QoRCache qorCache;
+    if (!qorCachePath.empty() && !qorCache.load(qorCachePath))
+      LLVM_DEBUG(llvm::dbgs() << "Failed to load QoR cache from \""
+                              << qorCachePath << "\".\n");
+
+    auto estimator =
+        ScaleHLSEstimator(latencyMap, dspUsageMap, lutUsageMap, true);
+    estimator.setQoRCache(&qorCache);
+    estimator.setAlwaysMaterialize(false);
+    auto explorer = ScaleHLSExplorer(estimator, outputNum, maxResource,
                                      maxInitParallel, maxExplParallel,
-                                     maxLoopParallel, maxIterNum, maxDistance);
+                                     maxLoopParallel, maxIterNum, maxDistance,
+                                     numThreads, searchStrategy, searchSeed);
 
-    // Optimize the top function.
-    // TODO: Support to contain sub-functions.
+    // Optimize the top function and all its sub-functions hierarchically.
+    auto &callGraph = getAnalysis<CallGraph>();
     for (auto func : module.getOps<func::FuncOp>()) {
-      if (hasTopFuncAttr(func))
-        explorer.applyDesignSpaceExplore(func, directiveOnly, outputPath,
-                                         csvPath);
+      if (hasTopFuncAttr(func) &&
+          failed(explorer.applyHierarchicalDesignSpaceExplore(
+              func, callGraph, directiveOnly, outputPath, csvPath)))
+        return signalPassFailure();
+    }
+
+    LLVM_DEBUG(llvm::dbgs() << "QoR cache hits: " << qorCache.getNumHits()
+                            << ", misses: " << qorCache.getNumMisses()
+                            << ".\n");
+    if (!qorCachePath.empty() && !qorCache.save(qorCachePath)) {
+      llvm::errs() << "failed to save the QoR cache file\n";
+      return signalPassFailure();
     }
   }
 };
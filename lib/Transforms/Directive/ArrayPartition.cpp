@@ -4,6 +4,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "mlir/IR/Threading.h"
 #include "scalehls/Transforms/Passes.h"
 #include "scalehls/Transforms/Utils.h"
 #include "llvm/Support/Debug.h"
@@ -16,8 +17,14 @@ using namespace hls;
 
 static void updateSubFuncs(func::FuncOp func, Builder builder) {
   func.walk([&](func::CallOp op) {
-    auto callee = SymbolTable::lookupNearestSymbolFrom(op, op.getCalleeAttr());
-    auto subFunc = dyn_cast<func::FuncOp>(callee);
+    // The sub-function of a no_touch call is fixed to its selected design
+    // point, thus is never updated.
+    if (op->hasAttr("no_touch"))
+      return;
+    auto subFunc = SymbolTable::lookupNearestSymbolFrom<func::FuncOp>(
+        op, op.getCalleeAttr());
+    if (!subFunc)
+      return;
 
     // Set sub-function type.
     auto subResultTypes = op.getResultTypes();
@@ -207,38 +214,23 @@ SmallVector<int64_t> createPermutationMap(ArrayRef<Value> vec1,
   return permutation_map;
 }
 
-/// Find the suitable array partition factors and kinds for all arrays in the
-/// targeted function.
-bool scalehls::applyAutoArrayPartition(func::FuncOp func, unsigned threshold) {
-  // Check whether the input function is pipelined.
-  bool funcPipeline = false;
-  if (auto attr = getFuncDirective(func))
-    funcPipeline = attr.getPipeline();
-
-  // Collect target basic blocks to be considered.
-  SmallVector<Block *, 4> targetBlocks;
-  if (funcPipeline)
-    targetBlocks.push_back(&func.front());
-  else {
-    // Collect all target loop bands.
-    AffineLoopBands targetBands;
-    getLoopBands(func.front(), targetBands);
-    for (auto &band : targetBands)
-      targetBlocks.push_back(band.back().getBody());
-  }
-
-  // Storing the partition information of each memref. The rationale is there
-  // may exist multiple blocks/functions accessing the same memref and in
-  // different blocks/functions the best partition fashions and factors are
-  // different. To eventually determine a "best" array partition strategy,
-  // tentatively we always pick the one with the largest partition factor as the
-  // final partition strategy. This "partitionsMap" is used to hold the current
-  // partition strategy of each memref.
-  using Partition = std::pair<PartitionKind, int64_t>;
-  DenseMap<Value, SmallVector<Partition, 4>> partitionsMap;
-
+/// Storing the partition information of each memref. The rationale is there
+/// may exist multiple blocks/functions accessing the same memref and in
+/// different blocks/functions the best partition fashions and factors are
+/// different. To eventually determine a "best" array partition strategy,
+/// tentatively we always pick the one with the largest partition factor as the
+/// final partition strategy. The "PartitionsMap" is used to hold the current
+/// partition strategy of each memref.
+using Partition = std::pair<PartitionKind, int64_t>;
+using PartitionsMap = DenseMap<Value, SmallVector<Partition, 4>>;
+
+/// Infer the partition strategy of all memrefs accessed in the target blocks
+/// and update the "partitionsMap" accordingly.
+static void inferBlockPartitions(ArrayRef<Block *> targetBlocks,
+                                 PartitionsMap &partitionsMap) {
   // Traverse all blocks that requires to be considered.
   for (auto block : targetBlocks) {
+    auto context = block->getParentOp()->getContext();
     MemAccessesMap accessesMap;
     getMemAccessesMap(*block, accessesMap, /*includeVectorTransfer=*/true);
 
@@ -317,11 +309,10 @@ bool scalehls::applyAutoArrayPartition(func::FuncOp func, unsigned threshold) {
                 SmallVector<AffineExpr, 4> symReplacements;
                 for (auto i : possiblePermutation) {
                   if (i < rhsIndex.getNumDims())
-                    dimReplacements.push_back(
-                        getAffineDimExpr(i, func.getContext()));
+                    dimReplacements.push_back(getAffineDimExpr(i, context));
                   else
                     symReplacements.push_back(getAffineSymbolExpr(
-                        i - rhsIndex.getNumDims(), func.getContext()));
+                        i - rhsIndex.getNumDims(), context));
                 }
                 rhsExpr = rhsExpr.replaceDimsAndSymbols(dimReplacements,
                                                         symReplacements);
@@ -405,46 +396,100 @@ bool scalehls::applyAutoArrayPartition(func::FuncOp func, unsigned threshold) {
         LLVM_DEBUG(llvm::dbgs() << "\n" << *op;);
     }
   }
+}
+
+/// Merge the partitions of the arguments of the already partitioned
+/// sub-function, whose argument types are "argTypes", into the partitions of
+/// the operands of the call.
+static void mergeCalleePartitions(func::CallOp op, TypeRange argTypes,
+                                  PartitionsMap &partitionsMap) {
+  for (auto [type, operand] : llvm::zip(argTypes, op.getOperands())) {
+    if (auto memrefType = type.dyn_cast<MemRefType>()) {
+      auto &partitions = partitionsMap[operand];
+
+      // If the current partitionsMap is empty, initialize it with no
+      // partition.
+      if (partitions.empty())
+        partitions = SmallVector<Partition, 4>(
+            memrefType.getRank(), Partition(PartitionKind::NONE, 1));
+
+      // Traverse all dimension of the memref.
+      if (auto attr = memrefType.getLayout().dyn_cast<PartitionLayoutAttr>())
+        for (int64_t dim = 0; dim < memrefType.getRank(); ++dim) {
+          auto kind = attr.getKinds()[dim];
+          auto factor = attr.getFactors()[dim];
+
+          // If the factor from the sub-function is larger than the current
+          // factor, replace it.
+          if (factor > partitions[dim].second)
+            partitions[dim] = Partition(kind, factor);
+        }
+    } else
+      operand.setType(type);
+  }
+}
 
-  // Apply partition to all sub-functions and traverse all function to update
-  // the "partitionsMap".
-  func.walk([&](func::CallOp op) {
-    auto callee = SymbolTable::lookupNearestSymbolFrom(op, op.getCalleeAttr());
-    auto subFunc = dyn_cast<func::FuncOp>(callee);
-    assert(subFunc && "callable is not a function operation");
+/// Unify the partitions of the two memrefs, which must share the same type, by
+/// picking the larger partition of each dimension. Return whether the
+/// partitions of any memref are changed.
+static bool unifyPartitions(Value lhs, Value rhs,
+                            PartitionsMap &partitionsMap) {
+  auto memrefType = lhs.getType().dyn_cast<MemRefType>();
+  if (!memrefType)
+    return false;
 
-    // Apply array partition to the sub-function.
-    applyAutoArrayPartition(subFunc, threshold);
+  // If the current partitionsMap is empty, initialize it with no partition.
+  for (auto memref : {lhs, rhs})
+    if (partitionsMap[memref].empty())
+      partitionsMap[memref] = SmallVector<Partition, 4>(
+          memrefType.getRank(), Partition(PartitionKind::NONE, 1));
+
+  bool changed = false;
+  for (auto [lhsPartition, rhsPartition] :
+       llvm::zip(partitionsMap[lhs], partitionsMap[rhs])) {
+    // Factors are compared first and kinds are compared to break ties, such
+    // that the partition of each dimension only grows.
+    auto lhsKey = std::make_pair(lhsPartition.second, lhsPartition.first);
+    auto rhsKey = std::make_pair(rhsPartition.second, rhsPartition.first);
+    if (lhsKey > rhsKey)
+      rhsPartition = lhsPartition;
+    else if (rhsKey > lhsKey)
+      lhsPartition = rhsPartition;
+    changed |= lhsKey != rhsKey;
+  }
+  return changed;
+}
 
-    for (auto [type, operand] :
-         llvm::zip(subFunc.getArgumentTypes(), op.getOperands())) {
-      if (auto memrefType = type.dyn_cast<MemRefType>()) {
-        auto &partitions = partitionsMap[operand];
-
-        // If the current partitionsMap is empty, initialize it with no
-        // partition.
-        if (partitions.empty())
-          partitions = SmallVector<Partition, 4>(
-              memrefType.getRank(), Partition(PartitionKind::NONE, 1));
-
-        // Traverse all dimension of the memref.
-        if (auto attr = memrefType.getLayout().dyn_cast<PartitionLayoutAttr>())
-          for (int64_t dim = 0; dim < memrefType.getRank(); ++dim) {
-            auto kind = attr.getKinds()[dim];
-            auto factor = attr.getFactors()[dim];
-
-            // If the factor from the sub-function is larger than the current
-            // factor, replace it.
-            if (factor > partitions[dim].second)
-              partitions[dim] = Partition(kind, factor);
-          }
-      } else
-        operand.setType(type);
+/// Apply partition to all sub-functions called in "root" and update the
+/// "partitionsMap" accordingly.
+static void inferCalleePartitions(Operation *root, PartitionsMap &partitionsMap,
+                                  unsigned threshold) {
+  root->walk([&](func::CallOp op) {
+    // The sub-function of a no_touch call has been explored and is fixed to
+    // its selected design point, whose argument types are annotated to the
+    // call. Therefore, the sub-function is neither looked up nor partitioned.
+    if (op->hasAttr("no_touch")) {
+      auto argTypes = getCalleeArgTypes(op);
+      if (argTypes.size() == op.getNumOperands())
+        mergeCalleePartitions(op, argTypes, partitionsMap);
+      return;
     }
+
+    // The sub-function cannot be found if "root" is located in a detached
+    // function clone, in which case the call is not considered.
+    auto subFunc = SymbolTable::lookupNearestSymbolFrom<func::FuncOp>(
+        op, op.getCalleeAttr());
+    if (!subFunc)
+      return;
+
+    // Apply array partition to the sub-function.
+    applyAutoArrayPartition(subFunc, threshold);
+    mergeCalleePartitions(op, subFunc.getArgumentTypes(), partitionsMap);
   });
+}
 
-  // Constuct and set new type to each partitioned MemRefType.
-  auto builder = Builder(func);
+/// Construct and set new type to each memref in the "partitionsMap".
+static void applyPartitions(PartitionsMap &partitionsMap, unsigned threshold) {
   for (auto [memref, partitions] : partitionsMap) {
     SmallVector<hls::PartitionKind, 4> kinds;
     SmallVector<unsigned, 4> factors;
@@ -466,17 +511,110 @@ bool scalehls::applyAutoArrayPartition(func::FuncOp func, unsigned threshold) {
       LLVM_DEBUG(llvm::dbgs() << "Updated op: " << *axiPort << "\n";);
     }
   }
+}
 
-  // Align function type with entry block argument types.
+/// Align the type of the function with its entry block argument types, and
+/// update the types of all sub-functions. The sub-functions are not updated if
+/// the function is a detached clone, as they cannot be looked up.
+static void alignFuncType(func::FuncOp func) {
+  auto builder = Builder(func);
   auto resultTypes = func.front().getTerminator()->getOperandTypes();
   auto inputTypes = func.front().getArgumentTypes();
   func.setType(builder.getFunctionType(inputTypes, resultTypes));
+  if (func->getParentOp())
+    updateSubFuncs(func, builder);
+}
+
+/// Infer the partition strategy of all arrays accessed in the given function,
+/// where the sub-functions called in the function are not considered. This
+/// doesn't mutate the IR and is safe to be applied to functions in parallel.
+static PartitionsMap inferFuncPartitions(func::FuncOp func) {
+  // Check whether the input function is pipelined.
+  bool funcPipeline = false;
+  if (auto attr = getFuncDirective(func))
+    funcPipeline = attr.getPipeline();
+
+  // Collect target basic blocks to be considered.
+  SmallVector<Block *, 4> targetBlocks;
+  if (funcPipeline)
+    targetBlocks.push_back(&func.front());
+  else {
+    // Collect all target loop bands.
+    AffineLoopBands targetBands;
+    getLoopBands(func.front(), targetBands);
+    for (auto &band : targetBands)
+      targetBlocks.push_back(band.back().getBody());
+  }
 
-  // Update the types of all sub-functions.
-  updateSubFuncs(func, builder);
+  PartitionsMap partitionsMap;
+  inferBlockPartitions(targetBlocks, partitionsMap);
+  return partitionsMap;
+}
+
+/// Find the suitable array partition factors and kinds for all arrays in the
+/// targeted function.
+bool scalehls::applyAutoArrayPartition(func::FuncOp func, unsigned threshold) {
+  auto partitionsMap = inferFuncPartitions(func);
+  inferCalleePartitions(func, partitionsMap, threshold);
+  applyPartitions(partitionsMap, threshold);
+  alignFuncType(func);
+  return true;
+}
+
+/// Find the suitable array partition factors and kinds for all arrays accessed
+/// by the input loop band. Only the operations under the loop band are
+/// analyzed, and the partition already applied to each array is considered as
+/// the lower bound of the new partition, such that the requirements of other
+/// loop bands accessing the same array are preserved. Sub-functions and the
+/// function type are left untouched, such that the partition can be reverted
+/// by restoring the types of the accessed arrays.
+bool scalehls::applyAutoArrayPartition(AffineLoopBand &band,
+                                       unsigned threshold) {
+  // The innermost loop of the band may have been changed by the optimizations,
+  // so we re-collect the band from the outermost loop.
+  AffineLoopBand targetBand;
+  getLoopBandFromOutermost(band.front(), targetBand);
+
+  // Initialize the "partitionsMap" with the current partition layouts.
+  MemAccessesMap accessesMap;
+  getMemAccessesMap(*targetBand.back().getBody(), accessesMap,
+                    /*includeVectorTransfer=*/true);
+
+  PartitionsMap partitionsMap;
+  for (auto &pair : accessesMap) {
+    auto memrefType = pair.first.getType().cast<MemRefType>();
+    auto &partitions = partitionsMap[pair.first];
+    partitions = SmallVector<Partition, 4>(memrefType.getRank(),
+                                           Partition(PartitionKind::NONE, 1));
+
+    if (auto attr = memrefType.getLayout().dyn_cast<PartitionLayoutAttr>()) {
+      auto factors = attr.getActualFactors(memrefType.getShape());
+      for (int64_t dim = 0; dim < memrefType.getRank(); ++dim)
+        if (attr.getKinds()[dim] != PartitionKind::NONE)
+          partitions[dim] = Partition(attr.getKinds()[dim], factors[dim]);
+    }
+  }
+
+  inferBlockPartitions({targetBand.back().getBody()}, partitionsMap);
+  applyPartitions(partitionsMap, threshold);
   return true;
 }
 
+/// Collect all functions called by the given function in a post-order, such
+/// that each callee is always collected before its callers.
+static void collectFuncsInPostOrder(func::FuncOp func, SymbolTable &symbolTable,
+                                    llvm::SetVector<func::FuncOp> &funcs,
+                                    llvm::SmallDenseSet<Operation *> &visited) {
+  if (!visited.insert(func).second)
+    return;
+  func.walk([&](func::CallOp op) {
+    auto subFunc = symbolTable.lookup<func::FuncOp>(op.getCallee());
+    assert(subFunc && "callable is not a function operation");
+    collectFuncsInPostOrder(subFunc, symbolTable, funcs, visited);
+  });
+  funcs.insert(func);
+}
+
 namespace {
 struct ArrayPartition : public ArrayPartitionBase<ArrayPartition> {
   ArrayPartition() = default;
@@ -500,7 +638,70 @@ struct ArrayPartition : public ArrayPartitionBase<ArrayPartition> {
       emitError(module.getLoc(), "fail to find the top function");
       return signalPassFailure();
     }
-    applyAutoArrayPartition(topFunc, threshold);
+
+    SymbolTable symbolTable(module);
+    llvm::SetVector<func::FuncOp> funcs;
+    llvm::SmallDenseSet<Operation *> visited;
+    collectFuncsInPostOrder(topFunc, symbolTable, funcs, visited);
+
+    // Infer the partitions of each function in parallel. The analysis only
+    // reads the IR, thus functions are independent of each other.
+    SmallVector<PartitionsMap> funcPartitionsMaps(funcs.size());
+    parallelFor(module.getContext(), 0, funcs.size(), [&](size_t i) {
+      funcPartitionsMaps[i] = inferFuncPartitions(funcs[i]);
+    });
+
+    // Values are unique across functions, thus the partitions of all
+    // functions can be held by one map without conflicts.
+    PartitionsMap partitionsMap;
+    for (auto &funcPartitionsMap : funcPartitionsMaps)
+      partitionsMap.insert(funcPartitionsMap.begin(), funcPartitionsMap.end());
+
+    // The sub-function of a no_touch call is fixed to its selected design
+    // point, thus its partitions are only merged into the call operands.
+    for (auto func : funcs)
+      func.walk([&](func::CallOp op) {
+        if (!op->hasAttr("no_touch"))
+          return;
+        auto argTypes = getCalleeArgTypes(op);
+        if (argTypes.size() == op.getNumOperands())
+          mergeCalleePartitions(op, argTypes, partitionsMap);
+      });
+
+    // A function has only one signature, thus each call operand must share
+    // the partitions of the corresponding callee argument, even if the callee
+    // is shared by callers requiring different partitions. Serially unify the
+    // partitions of call operands and callee arguments, and of call results
+    // and returned values, until nothing changes. As callees are visited
+    // before their callers, this mostly converges in a few iterations.
+    bool changed = true;
+    while (changed) {
+      changed = false;
+      for (auto func : funcs)
+        func.walk([&](func::CallOp op) {
+          if (op->hasAttr("no_touch"))
+            return;
+          auto subFunc = symbolTable.lookup<func::FuncOp>(op.getCallee());
+          auto returnOp = subFunc.front().getTerminator();
+          for (auto [operand, arg] :
+               llvm::zip(op.getOperands(), subFunc.getArguments()))
+            changed |= unifyPartitions(operand, arg, partitionsMap);
+          for (auto [result, returnValue] :
+               llvm::zip(op.getResults(), returnOp->getOperands()))
+            changed |= unifyPartitions(result, returnValue, partitionsMap);
+        });
+    }
+    applyPartitions(partitionsMap, threshold);
+
+    auto builder = Builder(module);
+    for (auto func : funcs) {
+      auto resultTypes = func.front().getTerminator()->getOperandTypes();
+      auto inputTypes = func.front().getArgumentTypes();
+      func.setType(builder.getFunctionType(inputTypes, resultTypes));
+    }
+
+    // Finally, propagate the partitions of callers to all sub-functions.
+    updateSubFuncs(topFunc, builder);
   }
 };
 } // namespace
@@ -5,9 +5,13 @@
 //===----------------------------------------------------------------------===//
 
 #include "mlir/Dialect/Affine/Analysis/Utils.h"
+#include "mlir/IR/Matchers.h"
 #include "mlir/Support/FileUtilities.h"
 #include "scalehls/Transforms/Estimator.h"
 #include "scalehls/Transforms/Passes.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/MD5.h"
 #include "llvm/Support/MemoryBuffer.h"
 
 using namespace std;
@@ -15,6 +19,128 @@ using namespace mlir;
 using namespace scalehls;
 using namespace hls;
 
+//===----------------------------------------------------------------------===//
+// Side Table Related Methods
+//===----------------------------------------------------------------------===//
+
+static bool isNoTouch(Operation *op) {
+  if (auto noTouch = op->getAttrOfType<BoolAttr>("no_touch"))
+    if (noTouch.getValue())
+      return true;
+
+  return false;
+}
+
+EstimationResult::Timing ScaleHLSEstimator::getTiming(Operation *op) {
+  auto it = results.find(op);
+  if (it != results.end() && it->second.timing)
+    return it->second.timing;
+
+  // The timing of no_touch operations are the input of the estimation.
+  EstimationResult::Timing timing;
+  if (isNoTouch(op))
+    if (auto attr = hls::getTiming(op))
+      timing = {attr.getBegin(), attr.getEnd(), attr.getLatency(),
+                attr.getInterval(), /*isValid=*/true};
+  return timing;
+}
+
+EstimationResult::Resource ScaleHLSEstimator::getResource(Operation *op) {
+  auto it = results.find(op);
+  if (it != results.end() && it->second.resource)
+    return it->second.resource;
+
+  // The resource of no_touch operations are the input of the estimation.
+  EstimationResult::Resource resource;
+  if (isNoTouch(op))
+    if (auto attr = hls::getResource(op))
+      resource = {attr.getLut(), attr.getDsp(), attr.getBram(),
+                  /*isValid=*/true};
+  return resource;
+}
+
+EstimationResult::LoopInfo ScaleHLSEstimator::getLoopInfo(Operation *op) {
+  auto it = results.find(op);
+  if (it != results.end() && it->second.loopInfo)
+    return it->second.loopInfo;
+
+  EstimationResult::LoopInfo loopInfo;
+  if (isNoTouch(op))
+    if (auto attr = hls::getLoopInfo(op))
+      loopInfo = {attr.getFlattenTripCount(), attr.getIterLatency(),
+                  attr.getMinII(), /*isValid=*/true};
+  return loopInfo;
+}
+
+void ScaleHLSEstimator::setTiming(Operation *op, int64_t begin, int64_t end,
+                                  int64_t latency, int64_t interval) {
+  assert(begin <= end && "invalid timing");
+  results[op].timing = {begin, end, latency, interval, /*isValid=*/true};
+}
+
+void ScaleHLSEstimator::setResource(Operation *op,
+                                    EstimationResult::Resource resource) {
+  results[op].resource = resource;
+}
+
+void ScaleHLSEstimator::setResource(Operation *op, int64_t lut, int64_t dsp,
+                                    int64_t bram) {
+  results[op].resource = {lut, dsp, bram, /*isValid=*/true};
+}
+
+void ScaleHLSEstimator::setLoopInfo(Operation *op,
+                                    EstimationResult::LoopInfo loopInfo) {
+  results[op].loopInfo = loopInfo;
+}
+
+void ScaleHLSEstimator::setLoopInfo(Operation *op, int64_t flattenTripCount,
+                                    int64_t iterLatency, int64_t minII) {
+  results[op].loopInfo = {flattenTripCount, iterLatency, minII,
+                          /*isValid=*/true};
+}
+
+int64_t ScaleHLSEstimator::getMaxMuxSize(Operation *op) {
+  auto it = results.find(op);
+  if (it != results.end())
+    return it->second.maxMuxSize;
+  return 1;
+}
+
+/// Materialize the estimation results held in the side table as attributes.
+/// Similar to the initialization of the estimator, the stale results of
+/// operations that are not no_touch are removed.
+void ScaleHLSEstimator::materializeResults(Operation *root) {
+  auto builder = Builder(root->getContext());
+  root->walk([&](Operation *op) {
+    auto it = results.find(op);
+    auto result = it != results.end() ? it->second : EstimationResult();
+
+    if (!isNoTouch(op)) {
+      op->removeAttr("timing");
+      op->removeAttr("resource");
+      op->removeAttr("loop_info");
+    }
+
+    if (auto &timing = result.timing)
+      hls::setTiming(op, timing.getBegin(), timing.getEnd(),
+                     timing.getLatency(), timing.getInterval());
+    if (auto &resource = result.resource)
+      hls::setResource(op, resource.getLut(), resource.getDsp(),
+                       resource.getBram());
+    if (auto &loopInfo = result.loopInfo)
+      hls::setLoopInfo(op, loopInfo.getFlattenTripCount(),
+                       loopInfo.getIterLatency(), loopInfo.getMinII());
+
+    if (!result.partitionIndices.empty()) {
+      op->setAttr("partition_indices",
+                  builder.getI64ArrayAttr(result.partitionIndices));
+      if (llvm::is_contained(result.partitionIndices, -1))
+        op->setAttr("max_mux_size",
+                    builder.getI64IntegerAttr(result.maxMuxSize));
+    }
+  });
+}
+
 //===----------------------------------------------------------------------===//
 // LoadOp and StoreOp Related Methods
 //===----------------------------------------------------------------------===//
@@ -28,8 +154,9 @@ void ScaleHLSEstimator::getPartitionIndices(Operation *op) {
   // If the layout map does not exist, it means the memory is not partitioned.
   auto layoutMap = memrefType.getLayout().getAffineMap();
   if (layoutMap.isIdentity()) {
-    auto partitionIndices = SmallVector<int64_t, 8>(memrefType.getRank(), 0);
-    op->setAttr("partition_indices", builder.getI64ArrayAttr(partitionIndices));
+    auto &result = results[op];
+    result.partitionIndices.assign(memrefType.getRank(), 0);
+    result.maxMuxSize = 1;
     return;
   }
 
@@ -71,7 +198,6 @@ void ScaleHLSEstimator::getPartitionIndices(Operation *op) {
   // partition strategy applied.
   SmallVector<int64_t, 8> partitionIndices;
   int64_t maxMuxSize = 1;
-  bool hasUncertainIdx = false;
 
   for (int64_t dim = 0; dim < memrefType.getRank(); ++dim) {
     auto idxExpr = composeMap.getResult(dim);
@@ -81,13 +207,151 @@ void ScaleHLSEstimator::getPartitionIndices(Operation *op) {
     else {
       partitionIndices.push_back(-1);
       maxMuxSize = max(maxMuxSize, factors[dim]);
-      hasUncertainIdx = true;
     }
   }
 
-  op->setAttr("partition_indices", builder.getI64ArrayAttr(partitionIndices));
-  if (hasUncertainIdx)
-    op->setAttr("max_mux_size", builder.getI64IntegerAttr(maxMuxSize));
+  auto &result = results[op];
+  result.partitionIndices.assign(partitionIndices.begin(),
+                                 partitionIndices.end());
+  result.maxMuxSize = maxMuxSize;
+}
+
+ScaleHLSEstimator::MemPortTable::MemPortTable(MemRefType memrefType)
+    : numPartitions(getPartitionFactors(memrefType)) {
+  // All partitions are initialized according to the storage type, where the
+  // default case is BRAM_S2P.
+  if (isRam1P(memrefType))
+    rdwrPort = 1;
+  else if (isRam2P(memrefType))
+    rdwrPort = 1, rdPort = 1;
+  else if (isRamT2P(memrefType))
+    rdwrPort = 2;
+  else if (isRamS2P(memrefType))
+    rdPort = 1, wrPort = 1;
+  else if (isDram(memrefType))
+    rdPort = UINT_MAX, wrPort = UINT_MAX;
+  else
+    rdwrPort = 2;
+}
+
+/// Get the row of the schedule level. If the level has not been occupied, a new
+/// row with all ports available is created.
+unsigned ScaleHLSEstimator::MemPortTable::getRow(int64_t level) {
+  auto result = rows.insert({level, (unsigned)rows.size()});
+  if (result.second) {
+    rdPorts.insert(rdPorts.end(), numPartitions, rdPort);
+    wrPorts.insert(wrPorts.end(), numPartitions, wrPort);
+    rdwrPorts.insert(rdwrPorts.end(), numPartitions, rdwrPort);
+    rdFulls.emplace_back(numPartitions, !rdPort && !rdwrPort);
+    wrFulls.emplace_back(numPartitions, !wrPort && !rdwrPort);
+    rdAccesses.emplace_back();
+  }
+  return result.first->second;
+}
+
+int64_t ScaleHLSEstimator::MemPortTable::reserve(
+    Operation *op, const llvm::BitVector &partitions, int64_t begin) {
+  auto access = MemRefAccess(op);
+  bool isRead = isa<AffineReadOpInterface>(op);
+
+  auto reserveRow = [&](unsigned row, const llvm::BitVector &targets) {
+    for (auto partition : targets.set_bits()) {
+      auto idx = row * numPartitions + partition;
+      if (isRead) {
+        if (rdPorts[idx] > 0)
+          rdPorts[idx]--;
+        else
+          rdwrPorts[idx]--;
+      } else {
+        if (wrPorts[idx] > 0)
+          wrPorts[idx]--;
+        else
+          rdwrPorts[idx]--;
+      }
+      rdFulls[row][partition] = !rdPorts[idx] && !rdwrPorts[idx];
+      wrFulls[row][partition] = !wrPorts[idx] && !rdwrPorts[idx];
+    }
+    if (isRead && targets.any())
+      rdAccesses[row].push_back({access, targets});
+  };
+
+  // Find the earliest level where none of the target partitions is exhausted.
+  // As only occupied levels have rows, we can directly jump to the first
+  // unoccupied level once all occupied levels in between are failed.
+  auto level = begin;
+  for (auto it = rows.lower_bound(begin);
+       it != rows.end() && it->first == level; ++it, ++level) {
+    auto row = it->second;
+    auto targets = partitions;
+
+    // The rationale is as long as the current read operation has identical
+    // memory access information with any scheduled read operation, the
+    // schedule will success on the partitions reserved by the scheduled one.
+    if (isRead)
+      for (auto &rdAccess : rdAccesses[row])
+        if (access == rdAccess.first &&
+            op->getBlock() == rdAccess.first.opInst->getBlock())
+          targets.reset(rdAccess.second);
+
+    auto conflicts = targets;
+    conflicts &= isRead ? rdFulls[row] : wrFulls[row];
+    if (conflicts.none()) {
+      reserveRow(row, targets);
+      return level;
+    }
+  }
+
+  reserveRow(getRow(level), partitions);
+  return level;
+}
+
+void ScaleHLSEstimator::MemPortTable::copyRows(const MemPortTable &table,
+                                               int64_t fromLevel,
+                                               int64_t shift) {
+  numPartitions = table.numPartitions;
+  rdPort = table.rdPort;
+  wrPort = table.wrPort;
+  rdwrPort = table.rdwrPort;
+
+  for (auto it = table.rows.lower_bound(fromLevel), e = table.rows.end();
+       it != e; ++it) {
+    auto srcRow = it->second;
+    auto row = getRow(it->first + shift);
+
+    auto srcBegin = srcRow * numPartitions;
+    auto begin = row * numPartitions;
+    std::copy_n(table.rdPorts.begin() + srcBegin, numPartitions,
+                rdPorts.begin() + begin);
+    std::copy_n(table.wrPorts.begin() + srcBegin, numPartitions,
+                wrPorts.begin() + begin);
+    std::copy_n(table.rdwrPorts.begin() + srcBegin, numPartitions,
+                rdwrPorts.begin() + begin);
+    rdFulls[row] = table.rdFulls[srcRow];
+    wrFulls[row] = table.wrFulls[srcRow];
+    rdAccesses[row] = table.rdAccesses[srcRow];
+  }
+}
+
+void ScaleHLSEstimator::MemPortTable::mergeRows(const MemPortTable &table,
+                                                int64_t shift) {
+  assert(numPartitions == table.numPartitions && "unmatched port tables");
+  for (auto &pair : table.rows) {
+    auto srcRow = pair.second;
+    auto row = getRow(pair.first + shift);
+
+    for (unsigned partition = 0; partition < numPartitions; ++partition) {
+      auto srcIdx = srcRow * numPartitions + partition;
+      auto idx = row * numPartitions + partition;
+      rdPorts[idx] -= min(rdPorts[idx], rdPort - table.rdPorts[srcIdx]);
+      wrPorts[idx] -= min(wrPorts[idx], wrPort - table.wrPorts[srcIdx]);
+      rdwrPorts[idx] -=
+          min(rdwrPorts[idx], rdwrPort - table.rdwrPorts[srcIdx]);
+      rdFulls[row][partition] = !rdPorts[idx] && !rdwrPorts[idx];
+      wrFulls[row][partition] = !wrPorts[idx] && !rdwrPorts[idx];
+    }
+    rdAccesses[row].append(table.rdAccesses[srcRow].begin(),
+                           table.rdAccesses[srcRow].end());
+  }
 }
 
 /// Timing load/store operation honoring the memory ports number limitation.
@@ -105,105 +369,33 @@ void ScaleHLSEstimator::estimateLoadStoreTiming(Operation *op, int64_t begin) {
 
   SmallVector<int64_t, 8> factors;
   auto partitionNum = getPartitionFactors(memrefType, &factors);
-  auto partitionIndices = getIntArrayAttrValue(op, "partition_indices");
-
-  // Try to avoid memory port violation until a legal schedule is found. Since
-  // an infinite length schedule cannot be generated, this while loop can be
-  // proofed to have an end.
-  int64_t resMinII = 1;
-  for (;; ++begin) {
-    auto &memPortInfos = memPortInfosMap[begin][memref];
-
-    // If the memory has not been occupied by the current schedule level, it
-    // should be initialized according to its storage type. Note that each
-    // partition should have one PortInfo structure, where the default case is
-    // BRAM_S2P.
-    if (memPortInfos.empty())
-      for (unsigned p = 0; p < partitionNum; ++p) {
-        MemPortInfo info;
-
-        if (isRam1P(memrefType))
-          info.rdwrPort = 1;
-        else if (isRam2P(memrefType))
-          info.rdwrPort = 1, info.rdPort = 1;
-        else if (isRamT2P(memrefType))
-          info.rdwrPort = 2;
-        else if (isRamS2P(memrefType))
-          info.rdPort = 1, info.wrPort = 1;
-        else if (isDram(memrefType))
-          info.rdPort = UINT_MAX, info.wrPort = UINT_MAX;
-        else
-          info.rdwrPort = 2;
-
-        memPortInfos.push_back(info);
-      }
-
-    // Indicate whether the memory access operation is successfully scheduled in
-    // the current schedule level.
-    bool successFlag = true;
-
-    // Walk through all partitions to check whether the current partition is
-    // occupied and whether available memory ports are enough to schedule the
-    // current memory access operation.
-    for (int64_t idx = 0; idx < partitionNum; ++idx) {
-      bool isOccupied = true;
-      int64_t accumFactor = 1;
-
-      for (int64_t dim = 0; dim < memrefType.getRank(); ++dim) {
-        // If the index is -1, all ports in the current partition will be
-        // occupied and a multiplexer will be generated in HLS.
-        if (partitionIndices[dim] != -1 &&
-            idx / accumFactor % factors[dim] != partitionIndices[dim]) {
-          isOccupied = false;
-          break;
-        }
-        accumFactor *= factors[dim];
-      }
-
-      if (isOccupied) {
-        auto &info = memPortInfos[idx];
-        if (isa<AffineReadOpInterface>(op)) {
-          bool hasIdenticalAccess = false;
-          // The rationale is as long as the current read operation has
-          // identical memory access information with any scheduled read
-          // operation, the schedule will success.
-          for (auto rdAccess : info.rdAccesses) {
-            if (access == rdAccess &&
-                op->getBlock() == rdAccess.opInst->getBlock())
-              hasIdenticalAccess = true;
-          }
-
-          if (hasIdenticalAccess)
-            continue;
-
-          if (info.rdPort > 0) {
-            info.rdPort--;
-            info.rdAccesses.push_back(access);
-          } else if (info.rdwrPort > 0) {
-            info.rdwrPort--;
-            info.rdAccesses.push_back(access);
-          } else {
-            successFlag = false;
-            break;
-          }
-        } else if (isa<AffineWriteOpInterface>(op)) {
-          if (info.wrPort > 0)
-            info.wrPort--;
-          else if (info.rdwrPort > 0)
-            info.rdwrPort--;
-          else {
-            successFlag = false;
-            break;
-          }
-        }
+  auto partitionIndices = results[op].partitionIndices;
+
+  // Collect all partitions occupied by the memory access operation. If the
+  // index is -1, all ports in the current partition will be occupied and a
+  // multiplexer will be generated in HLS.
+  llvm::BitVector partitions(partitionNum);
+  for (int64_t idx = 0; idx < partitionNum; ++idx) {
+    bool isOccupied = true;
+    int64_t accumFactor = 1;
+
+    for (int64_t dim = 0; dim < memrefType.getRank(); ++dim) {
+      if (partitionIndices[dim] != -1 &&
+          idx / accumFactor % factors[dim] != partitionIndices[dim]) {
+        isOccupied = false;
+        break;
       }
+      accumFactor *= factors[dim];
     }
-
-    if (successFlag)
-      break;
-    ++resMinII;
+    if (isOccupied)
+      partitions.set(idx);
   }
 
+  // Reserve memory ports at the earliest level where the ports of all occupied
+  // partitions are available.
+  auto &table = memPortTables.try_emplace(memref, memrefType).first->second;
+  begin = table.reserve(op, partitions, begin);
+
   if (isa<AffineReadOpInterface>(op))
     setTiming(op, begin, begin + 2, 2, 1);
   else
@@ -214,21 +406,6 @@ void ScaleHLSEstimator::estimateLoadStoreTiming(Operation *op, int64_t begin) {
 // AffineForOp Related Methods
 //===----------------------------------------------------------------------===//
 
-static int64_t getMaxMuxSize(Operation *op) {
-  if (auto maxMuxSize = op->getAttrOfType<IntegerAttr>("max_mux_size"))
-    return maxMuxSize.getInt();
-  else
-    return 1;
-}
-
-static bool isNoTouch(Operation *op) {
-  if (auto noTouch = op->getAttrOfType<BoolAttr>("no_touch"))
-    if (noTouch.getValue())
-      return true;
-
-  return false;
-}
-
 int64_t ScaleHLSEstimator::getResMinII(int64_t begin, int64_t end,
                                        MemAccessesMap &map) {
   int64_t II = 1;
@@ -246,23 +423,27 @@ int64_t ScaleHLSEstimator::getResMinII(int64_t begin, int64_t end,
     auto writeNum = SmallVector<int64_t, 16>(partitionNum, 0);
 
     // TODO: fine-tune for BRAM_T2P.
-    for (int64_t level = begin; level < end; ++level)
-      if (memPortInfosMap.count(level))
-        if (memPortInfosMap[level].count(memref)) {
-          auto &memPortInfos = memPortInfosMap[level][memref];
-
-          for (int64_t idx = 0; idx < partitionNum; ++idx) {
-            auto &info = memPortInfos[idx];
-            if (isRam1P(memrefType) && info.rdwrPort < 1)
-              ++accessNum[idx];
-            else if (isRamT2P(memrefType) && info.rdwrPort < 2)
-              ++accessNum[idx];
-            else if (info.rdPort < 1)
-              ++accessNum[idx];
-            else if (info.wrPort < 1)
-              ++writeNum[idx];
-          }
+    auto tableIt = memPortTables.find(memref);
+    if (tableIt != memPortTables.end()) {
+      auto &table = tableIt->second;
+      for (auto it = table.rows.lower_bound(begin),
+                e = table.rows.lower_bound(end);
+           it != e; ++it) {
+        auto row = it->second;
+
+        for (int64_t idx = 0; idx < partitionNum; ++idx) {
+          auto portIdx = row * partitionNum + idx;
+          if (isRam1P(memrefType) && table.rdwrPorts[portIdx] < 1)
+            ++accessNum[idx];
+          else if (isRamT2P(memrefType) && table.rdwrPorts[portIdx] < 2)
+            ++accessNum[idx];
+          else if (table.rdPorts[portIdx] < 1)
+            ++accessNum[idx];
+          else if (table.wrPorts[portIdx] < 1)
+            ++writeNum[idx];
         }
+      }
+    }
 
     II = max({II, *std::max_element(writeNum.begin(), writeNum.end()),
               *std::max_element(accessNum.begin(), accessNum.end())});
@@ -304,6 +485,83 @@ int64_t ScaleHLSEstimator::getDepMinII(int64_t II, func::FuncOp func,
   return II;
 }
 
+/// Print the canonical form of the memory access and its iteration domain,
+/// which determine the result of the polyhedral dependence analysis. Induction
+/// variables are identified by their loop depths, constants are printed with
+/// their values, and all other values are numbered with "valueIds".
+static void printAccessDomain(Operation *op, raw_ostream &os,
+                              DenseMap<Value, unsigned> &valueIds) {
+  DenseMap<Value, unsigned> ivDepths;
+  auto printOperands = [&](ValueRange operands) {
+    for (auto operand : operands) {
+      APInt constValue;
+      if (ivDepths.count(operand))
+        os << "i" << ivDepths[operand];
+      else if (matchPattern(operand, m_ConstantInt(&constValue)))
+        os << "c" << constValue.getSExtValue();
+      else
+        os << "s"
+           << valueIds.try_emplace(operand, valueIds.size()).first->second;
+      os << ",";
+    }
+  };
+
+  // Collect all surrounding operations from the outermost to the innermost.
+  SmallVector<Operation *, 8> parentOps;
+  for (auto parentOp = op->getParentOp();
+       parentOp && !isa<func::FuncOp>(parentOp);
+       parentOp = parentOp->getParentOp())
+    parentOps.push_back(parentOp);
+
+  for (auto parentOp : llvm::reverse(parentOps)) {
+    if (auto loop = dyn_cast<AffineForOp>(parentOp)) {
+      os << "for(" << loop.getLowerBoundMap() << ":";
+      printOperands(loop.getLowerBoundOperands());
+      os << ";" << loop.getUpperBoundMap() << ":";
+      printOperands(loop.getUpperBoundOperands());
+      os << ";" << loop.getStep() << ";"
+         << getAverageTripCount(loop).value_or(0) << ")";
+      auto depth = ivDepths.size();
+      ivDepths[loop.getInductionVar()] = depth;
+
+    } else if (auto ifOp = dyn_cast<AffineIfOp>(parentOp)) {
+      auto isThen = ifOp.getThenBlock()->findAncestorOpInBlock(*op);
+      os << "if(" << ifOp.getIntegerSet() << ":";
+      printOperands(ifOp.getOperands());
+      os << ";" << (isThen ? "then" : "else") << ")";
+    } else
+      os << parentOp->getName() << ";";
+  }
+
+  auto access = MemRefAccess(op);
+  AffineValueMap accessMap;
+  access.getAccessMap(&accessMap);
+  os << (isa<AffineReadOpInterface>(op) ? "read(" : "write(")
+     << access.memref.getType() << ";" << accessMap.getAffineMap() << ":";
+  printOperands(accessMap.getOperands());
+  os << ")";
+}
+
+/// Return whether the two memory accesses always access different partitions,
+/// in which case no dependency can exist between them.
+bool ScaleHLSEstimator::hasDisjointPartitions(Operation *srcOp,
+                                              Operation *dstOp) {
+  auto srcResult = results.find(srcOp);
+  auto dstResult = results.find(dstOp);
+  if (srcResult == results.end() || dstResult == results.end())
+    return false;
+
+  auto &srcIndices = srcResult->second.partitionIndices;
+  auto &dstIndices = dstResult->second.partitionIndices;
+  if (srcIndices.empty() || srcIndices.size() != dstIndices.size())
+    return false;
+
+  for (auto [srcIndex, dstIndex] : llvm::zip(srcIndices, dstIndices))
+    if (srcIndex != -1 && dstIndex != -1 && srcIndex != dstIndex)
+      return true;
+  return false;
+}
+
 /// Calculate the minimum dependency II of loop.
 int64_t ScaleHLSEstimator::getDepMinII(int64_t II, AffineForOp forOp,
                                        MemAccessesMap &map) {
@@ -323,6 +581,15 @@ int64_t ScaleHLSEstimator::getDepMinII(int64_t II, AffineForOp forOp,
   for (auto &pair : map) {
     auto loadStores = pair.second;
 
+    // Print the canonical form of all memory accesses, which are used to build
+    // the keys of the dependence cache.
+    DenseMap<Value, unsigned> valueIds;
+    DenseMap<Operation *, std::string> accessDomains;
+    for (auto op : loadStores) {
+      llvm::raw_string_ostream os(accessDomains[op]);
+      printAccessDomain(op, os, valueIds);
+    }
+
     // Walk through each pair of source and destination.
     unsigned dstIndex = 1;
     for (auto dstOp : loadStores) {
@@ -345,6 +612,11 @@ int64_t ScaleHLSEstimator::getDepMinII(int64_t II, AffineForOp forOp,
             isa<AffineReadOpInterface>(dstOp) && dstMuxSize <= 3)
           continue;
 
+        // If the two memory accesses always access different partitions, there
+        // is no need to run the polyhedral dependence analysis.
+        if (hasDisjointPartitions(srcOp, dstOp))
+          continue;
+
         // Now we must check whether carried dependency exists and calculate the
         // dependency distance if required.
         MemRefAccess dstAccess(dstOp);
@@ -355,22 +627,28 @@ int64_t ScaleHLSEstimator::getDepMinII(int64_t II, AffineForOp forOp,
         if (!depAnalysis && dstAccess != srcAccess)
           continue;
 
-        for (auto depth : loopDepths) {
-          FlatAffineValueConstraints depConstrs;
-          SmallVector<DependenceComponent, 2> depComps;
+        // The cache key is composed of the canonical forms of the two memory
+        // accesses, their number of common surrounding loops, and the depth.
+        std::string pairKey;
+        llvm::raw_string_ostream os(pairKey);
+        os << accessDomains[srcOp] << "|" << accessDomains[dstOp] << "|"
+           << getNumCommonSurroundingLoops(*srcOp, *dstOp) << "|";
+        os.flush();
 
-          DependenceResult result = checkMemrefAccessDependence(
-              srcAccess, dstAccess, depth, &depConstrs, &depComps,
-              /*allowRAR=*/true);
+        for (auto depth : loopDepths) {
+          // Look up the dependence cache before the polyhedral analysis.
+          Optional<int64_t> depDistance;
+          auto key = pairKey + std::to_string(depth);
+          if (!depDistances->lookup(key, depDistance)) {
+            FlatAffineValueConstraints depConstrs;
+            SmallVector<DependenceComponent, 2> depComps;
 
-          if (hasDependence(result)) {
-            int64_t distance = 0;
+            DependenceResult result = checkMemrefAccessDependence(
+                srcAccess, dstAccess, depth, &depConstrs, &depComps,
+                /*allowRAR=*/true);
 
-            if (dstMuxSize > 3 || srcMuxSize > 3) {
-              // If the two memory accesses are identical or one of them is
-              // implemented as separate function call, the dependency exists.
-              distance = 1;
-            } else {
+            if (hasDependence(result)) {
+              int64_t distance = 0;
               SmallVector<int64_t, 8> accumTrips;
               accumTrips.push_back(1);
 
@@ -379,6 +657,12 @@ int64_t ScaleHLSEstimator::getDepMinII(int64_t II, AffineForOp forOp,
                 auto dep = *i;
                 auto loop = cast<AffineForOp>(dep.op);
 
+                // If the distance is unbounded, conservatively assume the
+                // minimum distance.
+                if (!dep.lb || !dep.ub) {
+                  distance = 1;
+                  break;
+                }
                 auto ub = dep.ub.value();
                 auto lb = dep.lb.value();
 
@@ -394,7 +678,17 @@ int64_t ScaleHLSEstimator::getDepMinII(int64_t II, AffineForOp forOp,
                 accumTrips.push_back(accumTrips.back() *
                                      getAverageTripCount(loop).value());
               }
+              depDistance = distance;
             }
+            depDistances->insert(key, depDistance);
+          }
+
+          if (depDistance) {
+            // If the two memory accesses are identical or one of them is
+            // implemented as separate function call, the dependency exists.
+            auto distance = depDistance.value();
+            if (dstMuxSize > 3 || srcMuxSize > 3)
+              distance = 1;
 
             // We will only consider intra-dependencies with positive distance.
             if (distance > 0) {
@@ -409,20 +703,65 @@ int64_t ScaleHLSEstimator::getDepMinII(int64_t II, AffineForOp forOp,
   return II;
 }
 
+/// Return whether the schedule of the no_touch operation can be directly
+/// inferred from its existing annotations.
+static bool isAnnotatedNoTouch(Operation *op) {
+  return isNoTouch(op) && getTiming(op) && getResource(op);
+}
+
+/// Get the latency and resource annotations of the no_touch operation, which
+/// are used for detecting the changes of no_touch operations.
+static std::pair<int64_t, ResourceAttr> getNoTouchAnnotation(Operation *op) {
+  if (!isAnnotatedNoTouch(op))
+    return {-1, ResourceAttr()};
+  return {getTiming(op).getLatency(), getResource(op)};
+}
+
+/// Return whether the operation is nested in any if operation in the function.
+static bool hasIfAncestor(Operation *op) {
+  for (auto parentOp = op->getParentOp();
+       parentOp && !isa<func::FuncOp>(parentOp);
+       parentOp = parentOp->getParentOp())
+    if (isa<AffineIfOp, scf::IfOp>(parentOp))
+      return true;
+  return false;
+}
+
 bool ScaleHLSEstimator::visitOp(AffineForOp op, int64_t begin) {
+  if (recordSchedules && isNoTouch(op))
+    noTouchAnnotations[op] = getNoTouchAnnotation(op);
+
   // If a loop is marked as no_touch, then directly infer the schedule_end with
   // the exist latency.
-  if (isNoTouch(op)) {
-    auto timing = getTiming(op);
-    auto resource = getResource(op);
+  if (isAnnotatedNoTouch(op)) {
+    auto latency = getTiming(op).getLatency();
+    setTiming(op, begin, begin + latency, latency, latency);
+    skippedOps.insert(op);
+    return true;
+  }
 
-    if (timing && resource) {
-      auto latency = timing.getLatency();
-      setTiming(op, begin, begin + latency, latency, latency);
-      return true;
-    }
+  // The operators of the loop are counted separately and accumulated to the
+  // enclosing block after the loop is scheduled, such that a reused schedule
+  // only contributes the operators of the loop itself.
+  auto blockNumOperatorMap = std::move(totalNumOperatorMap);
+  totalNumOperatorMap.clear();
+
+  // Reuse the schedule of the loop if it has not been changed since the last
+  // estimation.
+  if (!reuseLoopSchedule(op, begin)) {
+    if (!scheduleLoop(op, begin))
+      return false;
+    recordLoopSchedule(op, begin);
   }
 
+  for (auto &pair : totalNumOperatorMap)
+    blockNumOperatorMap[pair.first()] += pair.second;
+  totalNumOperatorMap = std::move(blockNumOperatorMap);
+  return true;
+}
+
+/// Schedule the loop from the "begin" level.
+bool ScaleHLSEstimator::scheduleLoop(AffineForOp op, int64_t begin) {
   // Set an attribute indicating the trip count. For now, we assume all loops
   // have static loop bound.
   auto optionalTripCount = getAverageTripCount(op);
@@ -508,17 +847,69 @@ bool ScaleHLSEstimator::visitOp(AffineForOp op, int64_t begin) {
   return true;
 }
 
+/// Reuse the recorded schedule of the loop if the loop is not dirty. The
+/// rationale is a loop is never overlapped with the operations scheduled before
+/// it, thus its schedule is independent to the "begin" level and can be
+/// replayed by shifting all levels. The recorded port reservations and
+/// operators of the loop are merged into the current tables rather than
+/// overwriting them.
+bool ScaleHLSEstimator::reuseLoopSchedule(AffineForOp op, int64_t begin) {
+  if (!isIncremental || !isReusableLoop(op))
+    return false;
+
+  auto &schedule = loopSchedules[op];
+  for (auto &pair : schedule.memPortTables) {
+    auto memrefType = pair.first.getType().cast<MemRefType>();
+    memPortTables.try_emplace(pair.first, memrefType)
+        .first->second.mergeRows(pair.second, begin);
+  }
+  for (auto &level : schedule.numOperatorMap)
+    for (auto &pair : level.second)
+      numOperatorMap[begin + level.first][pair.first()] += pair.second;
+  totalNumOperatorMap = schedule.totalNumOperatorMap;
+
+  setLoopInfo(op, schedule.loopInfo);
+  setTiming(op, begin, begin + schedule.latency, schedule.latency,
+            schedule.interval);
+  skippedOps.insert(op);
+  return true;
+}
+
+/// Record the schedule of the loop with levels relative to "begin". Loops
+/// nested in if operations are not recorded, because they can be overlapped
+/// with other operations scheduled before them.
+void ScaleHLSEstimator::recordLoopSchedule(AffineForOp op, int64_t begin) {
+  if (!recordSchedules || hasIfAncestor(op))
+    return;
+
+  LoopSchedule schedule;
+  auto timing = getTiming(op);
+  schedule.latency = timing.getLatency();
+  schedule.interval = timing.getInterval();
+  schedule.loopInfo = getLoopInfo(op);
+
+  for (auto &pair : memPortTables)
+    schedule.memPortTables[pair.first].copyRows(pair.second, begin, -begin);
+  for (auto &level : numOperatorMap)
+    if (level.first >= begin)
+      schedule.numOperatorMap[level.first - begin] = level.second;
+  schedule.totalNumOperatorMap = totalNumOperatorMap;
+
+  loopSchedules[op] = std::move(schedule);
+}
+
 //===----------------------------------------------------------------------===//
 // Other Operation Handlers
 //===----------------------------------------------------------------------===//
 
 bool ScaleHLSEstimator::visitOp(AffineIfOp op, int64_t begin) {
-  auto end = begin;
+  auto thenEnd = begin;
+  auto elseEnd = begin;
   auto thenBlock = op.getThenBlock();
 
   // Estimate then block.
   if (auto timing = estimateBlock(*thenBlock, begin))
-    end = max(end, timing.getEnd());
+    thenEnd = max(thenEnd, timing.getEnd());
   else
     return false;
 
@@ -527,10 +918,23 @@ bool ScaleHLSEstimator::visitOp(AffineIfOp op, int64_t begin) {
     auto elseBlock = op.getElseBlock();
 
     if (auto timing = estimateBlock(*elseBlock, begin))
-      end = max(end, timing.getEnd());
+      elseEnd = max(elseEnd, timing.getEnd());
     else
       return false;
   }
+  auto end = max(thenEnd, elseEnd);
+
+  // If any branch contains loops, the branches are executed by a state machine
+  // with a latency decided at runtime. In this case, the expected latency is
+  // estimated with the profiled branch probability if available.
+  auto hasLoop = [](Block *block) {
+    return block->walk([](AffineForOp) { return WalkResult::interrupt(); })
+        .wasInterrupted();
+  };
+  if (auto thenProb = getProfiledThenProbability(op))
+    if (hasLoop(thenBlock) || (op.hasElse() && hasLoop(op.getElseBlock())))
+      end = begin + std::lround(thenProb.value() * (thenEnd - begin) +
+                                (1 - thenProb.value()) * (elseEnd - begin));
 
   // In our assumption, AffineIfOp is completely transparent. Therefore, we
   // set a dummy schedule begin here.
@@ -563,23 +967,305 @@ bool ScaleHLSEstimator::visitOp(scf::IfOp op, int64_t begin) {
 }
 
 bool ScaleHLSEstimator::visitOp(func::CallOp op, int64_t begin) {
-  auto callee = SymbolTable::lookupNearestSymbolFrom(op, op.getCalleeAttr());
-  auto subFunc = dyn_cast<func::FuncOp>(callee);
-  assert(subFunc && "callable is not a function operation");
+  if (recordSchedules && isNoTouch(op))
+    noTouchAnnotations[op] = getNoTouchAnnotation(op);
 
-  ScaleHLSEstimator estimator(latencyMap, dspUsageMap, depAnalysis);
+  // If a call is marked as no_touch, the sub-function has been explored and
+  // one of its design points is composed at the call site through the exist
+  // latency and interval.
+  if (isAnnotatedNoTouch(op)) {
+    auto timing = getTiming(op);
+    auto latency = timing.getLatency();
+    setTiming(op, begin, begin + latency, latency, timing.getInterval());
+    return true;
+  }
+
+  // The sub-function cannot be found if the call is located in a detached
+  // function clone, where the call should have been annotated.
+  auto subFunc = SymbolTable::lookupNearestSymbolFrom<func::FuncOp>(
+      op, op.getCalleeAttr());
+  if (!subFunc)
+    return false;
+
+  auto estimator = fork();
   estimator.estimateFunc(subFunc);
 
   // We assume enter and leave the subfunction require extra 2 clock cycles.
-  if (auto timing = getTiming(subFunc)) {
+  if (auto timing = estimator.getTiming(subFunc)) {
     auto latency = timing.getLatency();
     setTiming(op, begin, begin + latency, latency, timing.getInterval());
-    setResource(op, getResource(subFunc));
+    setResource(op, estimator.getResource(subFunc));
     return true;
   } else
     return false;
 }
 
+bool ScaleHLSEstimator::visitOp(ScheduleOp op, int64_t begin) {
+  // The schedule is isolated from above, thus it is estimated by a separate
+  // estimator without interfering with the scheduling state of the current
+  // block. The results of the schedule and its nested operations are merged
+  // into the side table, such that they are materialized with the parent.
+  auto estimator = fork();
+  estimator.setAlwaysMaterialize(false);
+  if (!estimator.scheduleDataflow(op))
+    return false;
+  for (auto &pair : estimator.results)
+    results[pair.first] = pair.second;
+
+  // The nested operations have been scheduled relative to their nodes, thus
+  // should not be reversed again.
+  auto timing = getTiming(op);
+  auto latency = timing.getLatency();
+  setTiming(op, begin, begin + latency, latency, timing.getInterval());
+  skippedOps.insert(op);
+  return true;
+}
+
+//===----------------------------------------------------------------------===//
+// QoR Cache Related Methods
+//===----------------------------------------------------------------------===//
+
+bool DepDistanceCache::lookup(StringRef key, Optional<int64_t> &distance) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = entries.find(key);
+  if (it == entries.end())
+    return false;
+  distance = it->second;
+  return true;
+}
+
+void DepDistanceCache::insert(StringRef key, Optional<int64_t> distance) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (entries.size() >= capacity)
+    entries.clear();
+  entries[key] = distance;
+}
+
+Optional<QoRCacheEntry> QoRCache::lookup(uint64_t key) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = entries.find(key);
+  if (it == entries.end()) {
+    ++numMisses;
+    return Optional<QoRCacheEntry>();
+  }
+  ++numHits;
+  return it->second;
+}
+
+void QoRCache::insert(uint64_t key, const QoRCacheEntry &entry) {
+  std::lock_guard<std::mutex> lock(mutex);
+  entries[key] = entry;
+}
+
+/// Load entries from a JSON file, which is an array of entry objects.
+bool QoRCache::load(StringRef filePath) {
+  std::string errorMessage;
+  auto file = mlir::openInputFile(filePath, &errorMessage);
+  if (!file)
+    return false;
+
+  auto json = llvm::json::parse(file->getBuffer());
+  if (!json) {
+    llvm::consumeError(json.takeError());
+    return false;
+  }
+  auto array = json.get().getAsArray();
+  if (!array)
+    return false;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto &value : *array) {
+    auto obj = value.getAsObject();
+    if (!obj)
+      continue;
+
+    uint64_t key;
+    auto keyStr = obj->getString("key");
+    if (!keyStr || keyStr.value().getAsInteger(16, key))
+      continue;
+
+    QoRCacheEntry entry;
+    entry.latency = obj->getInteger("latency").value_or(0);
+    entry.interval = obj->getInteger("interval").value_or(0);
+    entry.lut = obj->getInteger("lut").value_or(0);
+    entry.dsp = obj->getInteger("dsp").value_or(0);
+    entry.bram = obj->getInteger("bram").value_or(0);
+
+    bool isValid = true;
+    if (auto loopInfos = obj->getArray("loop_infos"))
+      for (auto &loopInfo : *loopInfos) {
+        auto info = loopInfo.getAsArray();
+        if (!info || info->size() != 3) {
+          isValid = false;
+          break;
+        }
+        entry.loopInfos.push_back({(*info)[0].getAsInteger().value_or(0),
+                                   (*info)[1].getAsInteger().value_or(0),
+                                   (*info)[2].getAsInteger().value_or(0)});
+      }
+
+    if (isValid)
+      entries[key] = entry;
+  }
+  return true;
+}
+
+/// Save entries to a JSON file. Entries are sorted by their keys, such that the
+/// output file is deterministic.
+bool QoRCache::save(StringRef filePath) {
+  llvm::json::Array array;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    SmallVector<uint64_t, 64> keys;
+    for (auto &pair : entries)
+      keys.push_back(pair.first);
+    llvm::sort(keys);
+
+    for (auto key : keys) {
+      auto &entry = entries[key];
+      llvm::json::Array loopInfos;
+      for (auto &info : entry.loopInfos)
+        loopInfos.push_back(llvm::json::Array({info[0], info[1], info[2]}));
+
+      array.push_back(
+          llvm::json::Object({{"key", llvm::utohexstr(key)},
+                              {"latency", entry.latency},
+                              {"interval", entry.interval},
+                              {"lut", entry.lut},
+                              {"dsp", entry.dsp},
+                              {"bram", entry.bram},
+                              {"loop_infos", std::move(loopInfos)}}));
+    }
+  }
+
+  std::string errorMessage;
+  auto file = mlir::openOutputFile(filePath, &errorMessage);
+  if (!file)
+    return false;
+
+  file->os() << llvm::formatv("{0:2}", llvm::json::Value(std::move(array)));
+  file->keep();
+  return true;
+}
+
+/// Return whether the attribute is generated by the estimator. The timing and
+/// resource attributes of no_touch operations are the input of the estimation,
+/// thus are not considered as generated attributes.
+static bool isEstimationAttr(Operation *op, StringRef name) {
+  if (name == "partition_indices" || name == "max_mux_size" ||
+      name == "opt_flag")
+    return true;
+  if (name == "timing" || name == "resource" || name == "loop_info")
+    return !isNoTouch(op);
+  return false;
+}
+
+namespace {
+/// Build a structural hash from the textual form of operations, which is stable
+/// across runs. Values are numbered in the order of their first appearance,
+/// such that structurally identical clones share the same hash.
+class QoRCacheKeyBuilder {
+public:
+  QoRCacheKeyBuilder() : os(buffer) {}
+
+  raw_ostream &getStream() { return os; }
+
+  void hashOperation(Operation *root) {
+    root->walk<WalkOrder::PreOrder>([&](Operation *op) {
+      os << op->getName() << "(";
+      for (auto operand : op->getOperands())
+        hashValue(operand);
+      os << ")->(";
+      for (auto result : op->getResults())
+        hashValue(result);
+      os << "){";
+      for (auto attr : op->getAttrs())
+        if (!isEstimationAttr(op, attr.getName()))
+          os << attr.getName() << "=" << attr.getValue() << ",";
+      os << "}";
+
+      for (auto &region : op->getRegions()) {
+        os << "[";
+        for (auto &block : region) {
+          os << block.getOperations().size() << "^(";
+          for (auto arg : block.getArguments())
+            hashValue(arg);
+          os << ")";
+        }
+        os << "]";
+      }
+      os << "\n";
+      flush();
+
+      // The estimation of a function call depends on the callee, which is
+      // hashed only once at its first appearance.
+      if (auto call = dyn_cast<func::CallOp>(op)) {
+        auto callee =
+            SymbolTable::lookupNearestSymbolFrom(call, call.getCalleeAttr());
+        if (callee && visitedCallees.insert(callee).second)
+          hashOperation(callee);
+      }
+    });
+  }
+
+  uint64_t getKey() {
+    flush();
+    llvm::MD5::MD5Result result;
+    hasher.final(result);
+    return result.low();
+  }
+
+private:
+  /// Hash the value with its id and type. A constant value may be defined
+  /// outside of the hashed operation, thus its value is hashed at its first
+  /// appearance as well.
+  void hashValue(Value value) {
+    auto result = valueIds.try_emplace(value, valueIds.size());
+    os << result.first->second << ":" << value.getType();
+    Attribute constValue;
+    if (result.second && matchPattern(value, m_Constant(&constValue)))
+      os << "=" << constValue;
+    os << ",";
+  }
+
+  void flush() {
+    hasher.update(buffer);
+    buffer.clear();
+  }
+
+  llvm::MD5 hasher;
+  SmallString<256> buffer;
+  llvm::raw_svector_ostream os;
+
+  DenseMap<Value, unsigned> valueIds;
+  SmallPtrSet<Operation *, 4> visitedCallees;
+};
+} // namespace
+
+/// Get the key of the QoR cache, which covers the structure, directives, and
+/// partition layouts of the function or loop, and the estimator configurations.
+uint64_t ScaleHLSEstimator::getQoRCacheKey(Operation *funcOrLoop) {
+  QoRCacheKeyBuilder builder;
+  auto &os = builder.getStream();
+
+  auto printMap = [&](llvm::StringMap<int64_t> &map) {
+    SmallVector<StringRef, 8> names;
+    for (auto &pair : map)
+      names.push_back(pair.first());
+    llvm::sort(names);
+    for (auto name : names)
+      os << name << "=" << map[name] << ",";
+    os << ";";
+  };
+  printMap(latencyMap);
+  printMap(dspUsageMap);
+  printMap(lutUsageMap);
+  os << depAnalysis << ";";
+
+  builder.hashOperation(funcOrLoop);
+  return builder.getKey();
+}
+
 //===----------------------------------------------------------------------===//
 // Block Scheduler and Estimator
 //===----------------------------------------------------------------------===//
@@ -625,8 +1311,9 @@ static Operation *getSameLevelDstOp(Operation *srcOp, Operation *dstOp) {
 }
 
 /// Estimate the latency of a block with ALAP scheduling strategy, return the
-/// estimated timing attribute.
-TimingAttr ScaleHLSEstimator::estimateBlock(Block &block, int64_t begin) {
+/// estimated timing.
+EstimationResult::Timing ScaleHLSEstimator::estimateBlock(Block &block,
+                                                          int64_t begin) {
   if (!isa<AffineIfOp, scf::IfOp>(block.getParentOp()))
     totalNumOperatorMap.clear();
 
@@ -693,6 +1380,11 @@ TimingAttr ScaleHLSEstimator::estimateBlock(Block &block, int64_t begin) {
               isa<AffineReadOpInterface>(depOp) && depOpMuxSize <= 3)
             continue;
 
+          // No dependency exists if the two operations always access different
+          // partitions.
+          if (hasDisjointPartitions(op, depOp))
+            continue;
+
           // Now we must check whether any dependency exists between the two
           // operations. If so, update the scheduling level.
           auto opAccess = MemRefAccess(op);
@@ -730,7 +1422,7 @@ TimingAttr ScaleHLSEstimator::estimateBlock(Block &block, int64_t begin) {
       opEnd = max(opEnd, getTiming(op).getEnd());
     else {
       op->emitError("Failed to estimate op");
-      return TimingAttr();
+      return EstimationResult::Timing();
     }
 
     // Update the block schedule end and begin.
@@ -742,20 +1434,20 @@ TimingAttr ScaleHLSEstimator::estimateBlock(Block &block, int64_t begin) {
     blockEnd = max(blockEnd, opEnd);
   }
 
-  return TimingAttr::get(block.getParentOp()->getContext(), blockBegin,
-                         blockEnd, blockEnd - blockBegin,
-                         blockEnd - blockBegin);
+  return {blockBegin, blockEnd, blockEnd - blockBegin, blockEnd - blockBegin,
+          /*isValid=*/true};
 }
 
-/// Get the innermost surrounding operation, either an AffineForOp or a
-/// func::FuncOp. In this method, AffineIfOp is transparent as well.
+/// Get the innermost surrounding operation, either an AffineForOp, a
+/// func::FuncOp, or a NodeOp. In this method, AffineIfOp is transparent as
+/// well.
 static Operation *getSurroundingOp(Operation *op) {
   auto currentOp = op;
   while (true) {
     auto parentOp = currentOp->getParentOp();
     if (isa<AffineIfOp, scf::IfOp>(parentOp))
       currentOp = parentOp;
-    else if (isa<AffineForOp, func::FuncOp>(parentOp))
+    else if (isa<AffineForOp, func::FuncOp, NodeOp>(parentOp))
       return parentOp;
     else
       return nullptr;
@@ -763,7 +1455,16 @@ static Operation *getSurroundingOp(Operation *op) {
 }
 
 void ScaleHLSEstimator::reverseTiming(Block &block) {
-  block.walk([&](Operation *op) {
+  for (auto &nestedOp : block) {
+    auto op = &nestedOp;
+
+    // The nested operations of skipped operations are not scheduled in the
+    // current estimation, thus should not be reversed.
+    if (!skippedOps.count(op))
+      for (auto &region : op->getRegions())
+        for (auto &nestedBlock : region)
+          reverseTiming(nestedBlock);
+
     // Get schedule level.
     if (auto timing = getTiming(op)) {
       auto begin = timing.getBegin();
@@ -786,7 +1487,7 @@ void ScaleHLSEstimator::reverseTiming(Block &block) {
             if (srdDirect.getFlatten())
               setTiming(op, srdBegin, srdBegin + latency, latency, interval);
           }
-        } else if (isa<func::FuncOp>(srd)) {
+        } else if (isa<func::FuncOp, NodeOp>(srd)) {
           auto srdLatency = getTiming(srd).getLatency() - 2;
           setTiming(op, srdLatency - end, srdLatency - begin, latency,
                     interval);
@@ -794,51 +1495,79 @@ void ScaleHLSEstimator::reverseTiming(Block &block) {
           op->emitError("unexpected surrounding operation");
       }
     }
-  });
+  }
 }
 
 void ScaleHLSEstimator::initEstimator(Block &block) {
   // Clear global maps and scheduling information.
-  memPortInfosMap.clear();
+  memPortTables.clear();
   numOperatorMap.clear();
-
-  block.walk([&](Operation *op) {
-    if (!isNoTouch(op)) {
-      op->removeAttr("resource");
-      op->removeAttr("timing");
-      op->removeAttr("loop_info");
-    }
+  skippedOps.clear();
+
+  // In the incremental estimation, the nested operations of annotated no_touch
+  // operations and reusable loops are kept untouched.
+  block.walk<WalkOrder::PreOrder>([&](Operation *op) {
+    results.erase(op);
+    if (isIncremental && (isAnnotatedNoTouch(op) || isReusableLoop(op)))
+      return WalkResult::skip();
+    return WalkResult::advance();
   });
 }
 
-ResourceAttr ScaleHLSEstimator::calculateResource(Operation *funcOrLoop) {
-  // Calculate the static DSP and BRAM utilization.
+/// Calculate the number of BRAMs occupied by the given on-chip buffer.
+int64_t scalehls::getBramNum(MemRefType memrefType) {
+  if (memrefType.getNumElements() <= 1)
+    return 0;
+
+  // TODO: Support URAM and interface BRAMs?
+  if (isDram(memrefType))
+    return 0;
+
+  // Multiply bit width of type.
+  // TODO: handle index types.
+  auto partitionNum = getPartitionFactors(memrefType);
+  int64_t memrefSize = memrefType.getElementTypeBitWidth() *
+                       memrefType.getNumElements() / partitionNum;
+  return ((memrefSize + 18000 - 1) / 18000) * partitionNum;
+}
+
+EstimationResult::Resource
+ScaleHLSEstimator::calculateResource(Operation *funcOrLoop) {
+  // Calculate the static resource utilization of sub-functions, no_touch loops,
+  // and buffers. The LUT and DSP utilization of operators are added below.
+  int64_t lutNum = 0;
   int64_t dspNum = 0;
   int64_t bramNum = 0;
-  funcOrLoop->walk([&](Operation *op) {
-    if (isa<func::CallOp>(op) || isNoTouch(op)) {
+  funcOrLoop->walk<WalkOrder::PreOrder>([&](Operation *op) {
+    if (isa<ScheduleOp>(op)) {
+      // Nodes of a dataflow schedule are executed concurrently, thus the
+      // resource of the schedule is fully composed and the nested operations
+      // are not visited again.
+      if (auto resource = getResource(op)) {
+        lutNum += max(resource.getLut(), (int64_t)0);
+        dspNum += resource.getDsp();
+        bramNum += max(resource.getBram(), (int64_t)0);
+      }
+      return WalkResult::skip();
+
+    } else if (isa<func::CallOp>(op) || isNoTouch(op)) {
       // TODO: For now, we consider the resource utilization of sub-fuctions are
       // static and not shareable. But actually this is not the truth. The
       // resource can be shared between different sub-functions to some extent,
       // whose shareing scheme has not been characterized by the estimator.
-      if (auto resource = getResource(op))
+      // The BRAM utilization of a no_touch loop is held by the arrays
+      // partitioned for the loop.
+      if (auto resource = getResource(op)) {
+        lutNum += max(resource.getLut(), (int64_t)0);
         dspNum += resource.getDsp();
-
-    } else if (isa<BufferOp>(op)) {
-      auto memrefType = op->getResult(0).getType().cast<MemRefType>();
-      if (memrefType.getNumElements() > 1) {
-        auto partitionNum = getPartitionFactors(memrefType);
-
-        // TODO: Support URAM and interface BRAMs?
-        if (!isDram(memrefType)) {
-          // Multiply bit width of type.
-          // TODO: handle index types.
-          int64_t memrefSize = memrefType.getElementTypeBitWidth() *
-                               memrefType.getNumElements() / partitionNum;
-          bramNum += ((memrefSize + 18000 - 1) / 18000) * partitionNum;
-        }
+        bramNum += max(resource.getBram(), (int64_t)0);
       }
+
+    } else if (auto buffer = dyn_cast<BufferOp>(op)) {
+      auto memrefType = buffer.getMemref().getType().cast<MemRefType>();
+      bramNum += getBramNum(memrefType);
     }
+    return WalkResult::advance();
   });
 
   auto timing = getTiming(funcOrLoop);
@@ -854,24 +1583,24 @@ ResourceAttr ScaleHLSEstimator::calculateResource(Operation *funcOrLoop) {
       num = max(num, nameAndNum.second);
     }
   }
-  for (auto &nameAndNum : operatorNums)
+  for (auto &nameAndNum : operatorNums) {
+    lutNum += lutUsageMap[nameAndNum.first()] * nameAndNum.second;
     dspNum += dspUsageMap[nameAndNum.first()] * nameAndNum.second;
+  }
 
-  return ResourceAttr::get(funcOrLoop->getContext(), 0, dspNum, bramNum);
+  return {lutNum, dspNum, bramNum, /*isValid=*/true};
 }
 
-void ScaleHLSEstimator::estimateFunc(func::FuncOp func) {
+/// Schedule all operations in the function and annotate the estimation results
+/// to the function.
+bool ScaleHLSEstimator::scheduleFunc(func::FuncOp func) {
   initEstimator(func.front());
   DT = DominanceInfo(func);
 
-  // Collect all memory access operations for later use.
-  MemAccessesMap map;
-  getMemAccessesMap(func.front(), map);
-
   // Recursively estimate blocks in the function.
   auto timing = estimateBlock(func.front());
   if (!timing)
-    return;
+    return false;
 
   auto latency = timing.getEnd() + 2;
   auto interval = latency;
@@ -887,6 +1616,11 @@ void ScaleHLSEstimator::estimateFunc(func::FuncOp func) {
       }
 
     } else if (funcDirect.getPipeline()) {
+      // Collect all memory access operations for solving possible carried
+      // dependencies.
+      MemAccessesMap map;
+      getMemAccessesMap(func.front(), map);
+
       // TODO: support CallOp inside of the function.
       auto targetInterval = funcDirect.getTargetInterval();
       auto resInterval = getResMinII(0, timing.getEnd(), map);
@@ -906,13 +1640,303 @@ void ScaleHLSEstimator::estimateFunc(func::FuncOp func) {
   // the reverse, the annotated scheduling level of each operation is a
   // relative level of the nearest surrounding AffineForOp or func::FuncOp.
   reverseTiming(func.front());
+  return true;
+}
+
+void ScaleHLSEstimator::estimateFunc(func::FuncOp func, bool useCache) {
+  // A full estimation invalidates all existing estimation results and the
+  // incremental estimation state.
+  resetIncrementalState();
+  results.clear();
+
+  // Look up the QoR cache. The key must be calculated before the estimator is
+  // initialized.
+  useCache &= cache != nullptr;
+  uint64_t key = 0;
+  if (useCache) {
+    key = getQoRCacheKey(func);
+    if (auto entry = cache->lookup(key)) {
+      setTiming(func, 0, entry->latency, entry->latency, entry->interval);
+      setResource(func, entry->lut, entry->dsp, entry->bram);
+      if (alwaysMaterialize)
+        materializeResults(func);
+      return;
+    }
+  }
+
+  auto isScheduled = scheduleFunc(func);
+  if (alwaysMaterialize)
+    materializeResults(func);
+
+  if (isScheduled && useCache) {
+    QoRCacheEntry entry;
+    auto timing = getTiming(func);
+    entry.latency = timing.getLatency();
+    entry.interval = timing.getInterval();
+    auto resource = getResource(func);
+    entry.lut = resource.getLut();
+    entry.dsp = resource.getDsp();
+    entry.bram = resource.getBram();
+    cache->insert(key, entry);
+  }
+}
+
+/// Estimate the function incrementally. The first estimation of a function is
+/// always a full estimation, where the schedules of all loops are recorded.
+/// After that, only the ancestors of dirty operations are re-scheduled, while
+/// the recorded schedules of all other loops are reused.
+void ScaleHLSEstimator::estimateFuncIncrementally(func::FuncOp func) {
+  if (func.getOperation() != incrementalFunc) {
+    resetIncrementalState();
+    results.clear();
+    incrementalFunc = func;
+  } else {
+    // Mark the no_touch operations whose annotations have been changed since
+    // the last estimation as dirty.
+    for (auto &pair : noTouchAnnotations)
+      if (getNoTouchAnnotation(pair.first) != pair.second)
+        markDirty(pair.first);
+    isIncremental = true;
+  }
+
+  recordSchedules = true;
+  scheduleFunc(func);
+  isIncremental = false;
+  recordSchedules = false;
+  dirtyOps.clear();
+
+  if (alwaysMaterialize)
+    materializeResults(func);
+}
+
+/// Mark the operation and all its ancestors in the function as dirty, such
+/// that they are re-scheduled in the next incremental estimation.
+void ScaleHLSEstimator::markDirty(Operation *op) {
+  for (auto currentOp = op; currentOp && !isa<func::FuncOp>(currentOp);
+       currentOp = currentOp->getParentOp())
+    dirtyOps.insert(currentOp);
+}
+
+void ScaleHLSEstimator::resetIncrementalState() {
+  incrementalFunc = nullptr;
+  loopSchedules.clear();
+  noTouchAnnotations.clear();
+  dirtyOps.clear();
+}
+
+bool ScaleHLSEstimator::isReusableLoop(Operation *op) {
+  return isa<AffineForOp>(op) && !dirtyOps.count(op) &&
+         loopSchedules.count(op);
 }
 
 void ScaleHLSEstimator::estimateLoop(AffineForOp loop, func::FuncOp func) {
+  AffineLoopBand band;
+  getLoopBandFromOutermost(loop, band);
+
+  // A full estimation invalidates all existing estimation results and the
+  // incremental estimation state.
+  resetIncrementalState();
+  results.clear();
+
+  // Look up the QoR cache. The loop information of all loops in the loop band
+  // is restored once the cache is hit.
+  uint64_t key = 0;
+  if (cache) {
+    key = getQoRCacheKey(loop);
+    auto entry = cache->lookup(key);
+    if (entry && entry->loopInfos.size() == band.size()) {
+      setTiming(loop, 0, entry->latency, entry->latency, entry->interval);
+      setResource(loop, entry->lut, entry->dsp, entry->bram);
+      for (auto [bandLoop, info] : llvm::zip(band, entry->loopInfos))
+        setLoopInfo(bandLoop, info[0], info[1], info[2]);
+      if (alwaysMaterialize)
+        materializeResults(func);
+      return;
+    }
+  }
+
   initEstimator(func.getBody().front());
   DT = DominanceInfo(loop);
   visitOp(loop, 0);
   setResource(loop, calculateResource(loop));
+  if (alwaysMaterialize)
+    materializeResults(func);
+
+  if (cache) {
+    auto timing = getTiming(loop);
+    auto resource = getResource(loop);
+    if (!timing || !resource)
+      return;
+
+    QoRCacheEntry entry;
+    entry.latency = timing.getLatency();
+    entry.interval = timing.getInterval();
+    entry.lut = resource.getLut();
+    entry.dsp = resource.getDsp();
+    entry.bram = resource.getBram();
+    for (auto bandLoop : band) {
+      auto info = getLoopInfo(bandLoop);
+      if (!info)
+        return;
+      entry.loopInfos.push_back(
+          {info.getFlattenTripCount(), info.getIterLatency(), info.getMinII()});
+    }
+    cache->insert(key, entry);
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// Dataflow Schedule Related Methods
+//===----------------------------------------------------------------------===//
+
+/// Schedule all operations in the node in isolation and annotate the estimation
+/// results to the node. As a node is a sequential process, its interval is
+/// equal to its latency.
+bool ScaleHLSEstimator::scheduleNode(NodeOp node) {
+  auto &block = node.getBody().front();
+  initEstimator(block);
+  DT = DominanceInfo(node);
+
+  auto timing = estimateBlock(block);
+  if (!timing)
+    return false;
+
+  // Nodes are eventually converted to sub-functions, thus we assume enter and
+  // leave the node require extra 2 clock cycles as well.
+  auto latency = timing.getEnd() + 2;
+  setTiming(node, 0, latency, latency, latency);
+  setResource(node, calculateResource(node));
+  reverseTiming(block);
+  return true;
+}
+
+/// Estimate the dataflow schedule, where each frame of data flows through the
+/// nodes following their producer-consumer dependencies. The total latency is
+/// the critical path of one frame, and the steady-state interval is bounded by
+/// the slowest node and the capacity of channels between nodes. Note that the
+/// begin and end of each node are relative to the beginning of the schedule.
+bool ScaleHLSEstimator::scheduleDataflow(ScheduleOp schedule) {
+  SmallVector<NodeOp, 16> nodes(schedule.getOps<NodeOp>());
+  for (auto node : nodes)
+    if (!scheduleNode(node))
+      return false;
+
+  // If all nodes have been scheduled by ScheduleDataflowNode, producers always
+  // have higher levels than their consumers. Otherwise, we fall back to the
+  // program order.
+  auto hasLevels =
+      llvm::all_of(nodes, [](NodeOp node) { return node.getLevel(); });
+  auto isFrameBefore = [&](NodeOp a, NodeOp b) {
+    if (hasLevels)
+      return a.getLevel().value() > b.getLevel().value();
+    return a->isBeforeInBlock(b);
+  };
+  llvm::stable_sort(nodes, [&](NodeOp a, NodeOp b) {
+    return hasLevels && isFrameBefore(a, b);
+  });
+
+  // A helper to get the producers of a node input in the same frame. Inputs
+  // with non-zero taps are produced in previous frames, and producers not
+  // ahead of the node are back dependences across frames, both of which are
+  // handled by the capacity of channels instead.
+  auto getFrameProducers = [&](NodeOp node, unsigned idx) {
+    SmallVector<NodeOp, 4> producers;
+    if (node.getInputTap(idx))
+      return producers;
+    for (auto producer : getProducersExcept(node.getInputs()[idx], node))
+      if (producer->getBlock() == node->getBlock() &&
+          isFrameBefore(producer, node))
+        producers.push_back(producer);
+    return producers;
+  };
+
+  // Nodes are scheduled in a topological order of the dependences in the same
+  // frame. A consumer of a buffer can only start after the producer finishes,
+  // while a consumer of a stream can start one cycle after the producer starts,
+  // but can not finish earlier than it.
+  int64_t latency = 0;
+  for (auto node : nodes) {
+    auto nodeLatency = getTiming(node).getLatency();
+    int64_t begin = 0;
+    int64_t minEnd = 0;
+    for (auto input : llvm::enumerate(node.getInputs()))
+      for (auto producer : getFrameProducers(node, input.index())) {
+        auto producerTiming = getTiming(producer);
+        if (input.value().getType().isa<StreamType>()) {
+          begin = max(begin, producerTiming.getBegin() + 1);
+          minEnd = max(minEnd, producerTiming.getEnd() + 1);
+        } else
+          begin = max(begin, producerTiming.getEnd());
+      }
+
+    auto end = max(begin + nodeLatency, minEnd);
+    setTiming(node, begin, end, nodeLatency, nodeLatency);
+    latency = max(latency, end);
+  }
+
+  // The steady-state interval is bounded by the interval of each node and the
+  // occupancy of each channel. A buffer with depth "d" can hold "d + 1" frames
+  // in flight as ping-pong buffers, where each frame occupies the buffer from
+  // the beginning of the producer to the end of the consumer. For a stream, the
+  // producer is stalled once the FIFO is full, thus the producer is occupied
+  // until the consumer reads the last "depth" tokens.
+  int64_t interval = 1;
+  for (auto node : nodes) {
+    auto timing = getTiming(node);
+    interval = max(interval, timing.getInterval());
+
+    for (auto input : llvm::enumerate(node.getInputs()))
+      for (auto producer : getFrameProducers(node, input.index())) {
+        auto producerBegin = getTiming(producer).getBegin();
+        auto producerEnd = getTiming(producer).getEnd();
+
+        if (auto stream = input.value().getDefiningOp<StreamOp>()) {
+          auto stallEnd = timing.getEnd() - (int64_t)stream.getDepth();
+          interval = max(interval, max(producerEnd, stallEnd) - producerBegin);
+        } else if (!input.value().getType().isa<StreamType>()) {
+          int64_t depth = 1;
+          if (auto buffer = input.value().getDefiningOp<BufferOp>())
+            depth = buffer.getDepth();
+          auto occupancy = timing.getEnd() - producerBegin;
+          interval = max(interval, (occupancy + depth) / (depth + 1));
+        }
+      }
+  }
+
+  // Nodes hold their own local buffers and logics, while the buffers allocated
+  // in the schedule are shared between nodes.
+  int64_t lutNum = 0;
+  int64_t dspNum = 0;
+  int64_t bramNum = 0;
+  for (auto &op : schedule.getBody().front()) {
+    if (auto node = dyn_cast<NodeOp>(op)) {
+      auto resource = getResource(node);
+      lutNum += max(resource.getLut(), (int64_t)0);
+      dspNum += resource.getDsp();
+      bramNum += max(resource.getBram(), (int64_t)0);
+    } else if (auto buffer = dyn_cast<BufferOp>(op)) {
+      // Each bank of a buffer occupies its own BRAMs, where the number of
+      // banks is one more than the depth. A buffer with a depth of one is a
+      // ping-pong buffer of two banks.
+      auto memrefType = buffer.getMemref().getType().cast<MemRefType>();
+      bramNum += getBramNum(memrefType) * (buffer.getDepth() + 1);
+    }
+  }
+
+  setTiming(schedule, 0, latency, latency, interval);
+  setResource(schedule, lutNum, dspNum, bramNum);
+  return true;
+}
+
+void ScaleHLSEstimator::estimateSchedule(ScheduleOp schedule) {
+  // A full estimation invalidates all existing estimation results and the
+  // incremental estimation state.
+  resetIncrementalState();
+  results.clear();
+
+  scheduleDataflow(schedule);
+  if (alwaysMaterialize)
+    materializeResults(schedule);
 }
 
 //===----------------------------------------------------------------------===//
@@ -942,6 +1966,22 @@ void scalehls::getDspUsageMap(llvm::json::Object *config,
   dspUsageMap["fexp"] = dspUsage->getInteger("fexp").value_or(7);
 }
 
+void scalehls::getLutUsageMap(llvm::json::Object *config,
+                              llvm::StringMap<int64_t> &lutUsageMap) {
+  // The LUT usage is optional in the target spec, where default values are
+  // based on the Xilinx floating-point IPs with full DSP usage.
+  llvm::json::Object emptyLutUsage;
+  auto lutUsage = config->getObject("lut_usage");
+  if (!lutUsage)
+    lutUsage = &emptyLutUsage;
+
+  lutUsageMap["fadd"] = lutUsage->getInteger("fadd").value_or(205);
+  lutUsageMap["fmul"] = lutUsage->getInteger("fmul").value_or(143);
+  lutUsageMap["fdiv"] = lutUsage->getInteger("fdiv").value_or(761);
+  lutUsageMap["fcmp"] = lutUsage->getInteger("fcmp").value_or(66);
+  lutUsageMap["fexp"] = lutUsage->getInteger("fexp").value_or(1138);
+}
+
 namespace {
 struct QoREstimation : public scalehls::QoREstimationBase<QoREstimation> {
   QoREstimation() = default;
@@ -971,19 +2011,32 @@ struct QoREstimation : public scalehls::QoREstimationBase<QoREstimation> {
       return signalPassFailure();
     }
 
-    // Collect profiling latency and DSP usage data, where default values are
-    // based on Xilinx PYNQ-Z1 board.
+    // Collect profiling latency, DSP and LUT usage data, where default values
+    // are based on Xilinx PYNQ-Z1 board.
     llvm::StringMap<int64_t> latencyMap;
     getLatencyMap(configObj, latencyMap);
     llvm::StringMap<int64_t> dspUsageMap;
     getDspUsageMap(configObj, dspUsageMap);
+    llvm::StringMap<int64_t> lutUsageMap;
+    getLutUsageMap(configObj, lutUsageMap);
 
     // Estimate performance and resource utilization. If any other functions are
     // called by the top function, it will be estimated in the procedure of
     // estimating the top function.
-    for (auto func : module.getOps<func::FuncOp>())
-      if (hasTopFuncAttr(func))
-        ScaleHLSEstimator(latencyMap, dspUsageMap, true).estimateFunc(func);
+    for (auto func : module.getOps<func::FuncOp>()) {
+      if (!hasTopFuncAttr(func))
+        continue;
+      ScaleHLSEstimator estimator(latencyMap, dspUsageMap, lutUsageMap, true);
+      if (!incremental) {
+        estimator.estimateFunc(func);
+        continue;
+      }
+
+      // The first incremental estimation is a full estimation recording the
+      // schedules of all loops, which are reused by the second one.
+      estimator.estimateFuncIncrementally(func);
+      estimator.estimateFuncIncrementally(func);
+    }
   }
 };
 } // namespace
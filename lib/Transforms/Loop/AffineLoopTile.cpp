@@ -31,7 +31,9 @@ bool scalehls::applyLoopTiling(AffineLoopBand &band, FactorList tileList,
     return true;
   }
 
-  // Record the original band size and attributes to make use of later.
+  // Record the original band size and attributes to make use of later. Note
+  // that the tile and point loops are newly created, thus the profiled trip
+  // counts of the original loops are not carried over.
   auto originalBandSize = band.size();
   SmallVector<std::pair<bool, bool>, 6> flags;
   for (auto loop : band)
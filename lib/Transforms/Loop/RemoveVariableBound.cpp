@@ -4,6 +4,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "mlir/Dialect/Affine/Analysis/LoopAnalysis.h"
 #include "mlir/Dialect/Affine/LoopUtils.h"
 #include "mlir/IR/IntegerSet.h"
 #include "scalehls/Transforms/Passes.h"
@@ -11,6 +12,7 @@
 
 using namespace mlir;
 using namespace scalehls;
+using namespace hls;
 
 /// Apply remove variable bound to all inner loops of the input loop.
 bool scalehls::applyRemoveVariableBound(AffineLoopBand &band) {
@@ -21,6 +23,9 @@ bool scalehls::applyRemoveVariableBound(AffineLoopBand &band) {
 
   // Remove all vairable loop bound if possible.
   for (auto loop : band) {
+    auto profiledTripCount = getProfiledTripCount(loop);
+    SmallVector<AffineIfOp, 2> ifOps;
+
     if (!loop.hasConstantUpperBound()) {
       // TODO: support variable upper bound with more than one result in the
       // getBoundOfAffineValueMap() method.
@@ -40,6 +45,7 @@ bool scalehls::applyRemoveVariableBound(AffineLoopBand &band) {
         auto ifOp =
             builder.create<AffineIfOp>(loop.getLoc(), ifCondition, ifOperands,
                                        /*withElseRegion=*/false);
+        ifOps.push_back(ifOp);
 
         // Move all operations in the innermost perfect loop into the new
         // created AffineIf region.
@@ -74,6 +80,7 @@ bool scalehls::applyRemoveVariableBound(AffineLoopBand &band) {
         auto ifOp =
             builder.create<AffineIfOp>(loop.getLoc(), ifCondition, ifOperands,
                                        /*withElseRegion=*/false);
+        ifOps.push_back(ifOp);
 
         // Move all operations in the innermost perfect loop into the new
         // created AffineIf region.
@@ -88,6 +95,19 @@ bool scalehls::applyRemoveVariableBound(AffineLoopBand &band) {
       } else
         return false;
     }
+
+    // The profiled trip count is stale once the loop is rectangularized. If
+    // only one bound was variable, it is rescaled to the probability of the
+    // created if operation being taken.
+    if (ifOps.empty())
+      continue;
+    removeProfiledTripCount(loop);
+    auto tripCount = getConstantTripCount(loop);
+    if (profiledTripCount && ifOps.size() == 1 && tripCount &&
+        tripCount.value() != 0)
+      setProfiledThenProbability(
+          ifOps.front(),
+          std::min(1.0, profiledTripCount.value() / tripCount.value()));
   }
   return true;
 }
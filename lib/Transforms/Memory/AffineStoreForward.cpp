@@ -10,6 +10,7 @@
 #include "mlir/IR/IntegerSet.h"
 #include "scalehls/Dialect/HLS/Utils.h"
 #include "scalehls/Transforms/Passes.h"
+#include "scalehls/Transforms/Utils.h"
 #include <algorithm>
 
 using namespace mlir;
@@ -317,9 +318,9 @@ static void loadCSE(mlir::AffineReadOpInterface loadA,
 // currently only eliminates the stores only if no other loads/uses (other
 // than dealloc) remain.
 //
-static bool applyAffineStoreForward(func::FuncOp func) {
-  DominanceInfo domInfo(func);
-  PostDominanceInfo postDomInfo(func);
+bool scalehls::applyAffineStoreForward(Operation *root) {
+  DominanceInfo domInfo(root);
+  PostDominanceInfo postDomInfo(root);
 
   // Load op's whose results were replaced by those forwarded from stores.
   SmallVector<Operation *, 8> opsToErase;
@@ -328,7 +329,7 @@ static bool applyAffineStoreForward(func::FuncOp func) {
   SmallPtrSet<Value, 4> memrefsToErase;
 
   // Walk all load's and perform store to load forwarding.
-  func.walk([&](mlir::AffineReadOpInterface loadOp) {
+  root->walk([&](mlir::AffineReadOpInterface loadOp) {
     auto currentLoadOp = loadOp;
     auto newLoadOp = mlir::AffineReadOpInterface();
     while (1) {
@@ -349,7 +350,7 @@ static bool applyAffineStoreForward(func::FuncOp func) {
   opsToErase.clear();
 
   // Walk all store's and perform unused store elimination
-  func.walk([&](mlir::AffineWriteOpInterface storeOp) {
+  root->walk([&](mlir::AffineWriteOpInterface storeOp) {
     findUnusedStore(storeOp, opsToErase, memrefsToErase, postDomInfo);
   });
   // Erase all store op's which don't impact the program
@@ -9,6 +9,7 @@
 #include "mlir/Transforms/GreedyPatternRewriteDriver.h"
 #include "scalehls/Dialect/HLS/Utils.h"
 #include "scalehls/Transforms/Passes.h"
+#include "scalehls/Transforms/Utils.h"
 #include "llvm/Support/Debug.h"
 
 #define DEBUG_TYPE "scalehls-reduce-initial-interval"
@@ -170,13 +171,18 @@ struct ReduceInitialIntervalPattern : public OpRewritePattern<AffineForOp> {
 };
 } //  namespace
 
+void scalehls::populateReduceInitialIntervalPatterns(
+    RewritePatternSet &patterns) {
+  patterns.add<ReduceInitialIntervalPattern>(patterns.getContext());
+}
+
 namespace {
 struct ReduceInitialInterval
     : public ReduceInitialIntervalBase<ReduceInitialInterval> {
   void runOnOperation() override {
     auto func = getOperation();
     mlir::RewritePatternSet patterns(func.getContext());
-    patterns.add<ReduceInitialIntervalPattern>(func.getContext());
+    populateReduceInitialIntervalPatterns(patterns);
     (void)applyPatternsAndFoldGreedily(func, std::move(patterns),
                                        {false, true, 1});
   }
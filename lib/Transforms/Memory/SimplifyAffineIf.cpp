@@ -8,6 +8,7 @@
 #include "mlir/Transforms/GreedyPatternRewriteDriver.h"
 #include "scalehls/Dialect/HLS/Utils.h"
 #include "scalehls/Transforms/Passes.h"
+#include "scalehls/Transforms/Utils.h"
 
 using namespace mlir;
 using namespace scalehls;
@@ -115,12 +116,15 @@ struct MergeSameIf : public OpRewritePattern<func::FuncOp> {
 };
 } // namespace
 
-static bool applySimplifyAffineIf(func::FuncOp func) {
-  auto context = func.getContext();
-
-  mlir::RewritePatternSet patterns(context);
+void scalehls::populateSimplifyAffineIfPatterns(RewritePatternSet &patterns) {
+  auto context = patterns.getContext();
   patterns.add<RemoveRedundantIf>(context);
   patterns.add<MergeSameIf>(context);
+}
+
+static bool applySimplifyAffineIf(func::FuncOp func) {
+  mlir::RewritePatternSet patterns(func.getContext());
+  populateSimplifyAffineIfPatterns(patterns);
   (void)applyPatternsAndFoldGreedily(func, std::move(patterns));
   return true;
 }
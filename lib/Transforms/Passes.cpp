@@ -106,6 +106,15 @@ struct HIDAPyTorchPipelineOptions
       *this, "correlation-aware", llvm::cl::init(true),
       llvm::cl::desc("Whether to consider node correlation in the transform")};
 
+  Option<bool> throughputAware{
+      *this, "throughput-aware", llvm::cl::init(false),
+      llvm::cl::desc("Explore the unroll factor of each dataflow node to "
+                     "minimize the maximum node II (default is false)")};
+
+  Option<unsigned> maxDspNum{
+      *this, "max-dsp-num", llvm::cl::init(220),
+      llvm::cl::desc("The DSP budget of the throughput aware exploration")};
+
   Option<unsigned> externalBufferThreshold{
       *this, "external-buffer-threshold", llvm::cl::init(1024),
       llvm::cl::desc("The threshold of placing external buffers")};
@@ -114,10 +123,29 @@ struct HIDAPyTorchPipelineOptions
       *this, "place-external-buffer", llvm::cl::init(true),
       llvm::cl::desc("Place buffers in external memories")};
 
+  Option<std::string> placementTargetSpec{
+      *this, "placement-target-spec", llvm::cl::init(""),
+      llvm::cl::desc("Place buffers under the memory budgets of the given "
+                     "target spec (set empty to disable)")};
+
   Option<bool> balanceDataflow{
       *this, "balance-dataflow", llvm::cl::init(true),
       llvm::cl::desc("Whether to balance the dataflow")};
 
+  Option<bool> multiBankBuffer{
+      *this, "multi-bank-buffer", llvm::cl::init(false),
+      llvm::cl::desc("Balance on-chip buffers with multi-bank buffers instead "
+                     "of copy nodes")};
+
+  Option<bool> sizeStream{
+      *this, "size-stream", llvm::cl::init(false),
+      llvm::cl::desc("Size the depth of stream channels through simulation")};
+
+  Option<std::string> streamTargetSpec{
+      *this, "stream-target-spec", llvm::cl::init(""),
+      llvm::cl::desc("Time the simulation of stream sizing with the given "
+                     "target spec (set empty to use the default latencies)")};
+
   Option<bool> axiInterface{*this, "axi-interface", llvm::cl::init(true),
                             llvm::cl::desc("Create AXI interface")};
 
@@ -210,7 +238,8 @@ void scalehls::registerHIDAPyTorchPipeline() {
 
         // Place dataflow buffers.
         pm.addPass(scalehls::createPlaceDataflowBufferPass(
-            opts.externalBufferThreshold, opts.placeExternalBuffer));
+            opts.externalBufferThreshold, opts.placeExternalBuffer,
+            !opts.placementTargetSpec.empty(), opts.placementTargetSpec));
 
         // if (opts.vectorize) {
         //   pm.addPass(mlir::createSuperVectorizePass({2}));
@@ -260,7 +289,8 @@ void scalehls::registerHIDAPyTorchPipeline() {
         pm.addPass(scalehls::createEliminateMultiConsumerPass());
         pm.addPass(scalehls::createScheduleDataflowNodePass());
         if (opts.balanceDataflow.getValue())
-          pm.addPass(scalehls::createBalanceDataflowNodePass());
+          pm.addPass(
+              scalehls::createBalanceDataflowNodePass(opts.multiBankBuffer));
         pm.addPass(scalehls::createLowerCopyToAffinePass());
         pm.addPass(scalehls::createAffineStoreForwardPass());
         pm.addPass(mlir::createCanonicalizerPass());
@@ -271,7 +301,8 @@ void scalehls::registerHIDAPyTorchPipeline() {
         // Parallelize dataflow.
         pm.addPass(scalehls::createParallelizeDataflowNodePass(
             opts.loopUnrollFactor, /*unrollPointLoopOnly=*/true,
-            opts.complexityAware, opts.correlationAware));
+            opts.complexityAware, opts.correlationAware, opts.throughputAware,
+            opts.maxDspNum));
         pm.addPass(mlir::createSimplifyAffineStructuresPass());
         pm.addPass(scalehls::createLegalizeDataflowPass());
         pm.addPass(mlir::createCanonicalizerPass());
@@ -291,6 +322,9 @@ void scalehls::registerHIDAPyTorchPipeline() {
 
         // Convert dataflow to func.
         pm.addPass(scalehls::createCreateTokenStreamPass());
+        if (opts.sizeStream)
+          pm.addPass(
+              scalehls::createSizeDataflowStreamPass(opts.streamTargetSpec));
         pm.addPass(scalehls::createConvertDataflowToFuncPass());
         pm.addPass(mlir::createCanonicalizerPass());
 
@@ -337,6 +371,9 @@ void scalehls::registerHIDAPyTorchPipelinePost() {
 
         // Convert dataflow to func.
         pm.addPass(scalehls::createCreateTokenStreamPass());
+        if (opts.sizeStream)
+          pm.addPass(
+              scalehls::createSizeDataflowStreamPass(opts.streamTargetSpec));
         pm.addPass(scalehls::createConvertDataflowToFuncPass());
         pm.addPass(mlir::createCanonicalizerPass());
 
@@ -381,7 +418,8 @@ void scalehls::registerHIDACppPipeline() {
 
         // Place dataflow buffers.
         pm.addPass(scalehls::createPlaceDataflowBufferPass(
-            opts.externalBufferThreshold, opts.placeExternalBuffer));
+            opts.externalBufferThreshold, opts.placeExternalBuffer,
+            !opts.placementTargetSpec.empty(), opts.placementTargetSpec));
 
         // if (opts.vectorize) {
         //   pm.addPass(mlir::createSuperVectorizePass({2}));
@@ -430,7 +468,8 @@ void scalehls::registerHIDACppPipeline() {
         pm.addPass(scalehls::createEliminateMultiProducerPass());
         pm.addPass(scalehls::createEliminateMultiConsumerPass());
         pm.addPass(scalehls::createScheduleDataflowNodePass());
-        pm.addPass(scalehls::createBalanceDataflowNodePass());
+        pm.addPass(
+            scalehls::createBalanceDataflowNodePass(opts.multiBankBuffer));
         pm.addPass(scalehls::createLowerCopyToAffinePass());
         pm.addPass(scalehls::createAffineStoreForwardPass());
         pm.addPass(mlir::createCanonicalizerPass());
@@ -439,10 +478,11 @@ void scalehls::registerHIDACppPipeline() {
           return;
 
         // Parallelize dataflow.
-        if (opts.loopUnrollFactor) {
+        if (opts.loopUnrollFactor || opts.throughputAware) {
           pm.addPass(scalehls::createParallelizeDataflowNodePass(
               opts.loopUnrollFactor, /*unrollPointLoopOnly=*/true,
-              opts.complexityAware, opts.correlationAware));
+              opts.complexityAware, opts.correlationAware,
+              opts.throughputAware, opts.maxDspNum));
           pm.addPass(mlir::createSimplifyAffineStructuresPass());
           pm.addPass(mlir::createCanonicalizerPass());
         }
@@ -461,6 +501,9 @@ void scalehls::registerHIDACppPipeline() {
 
         // Convert dataflow to func.
         pm.addPass(scalehls::createCreateTokenStreamPass());
+        if (opts.sizeStream)
+          pm.addPass(
+              scalehls::createSizeDataflowStreamPass(opts.streamTargetSpec));
         pm.addPass(scalehls::createConvertDataflowToFuncPass());
         pm.addPass(mlir::createCanonicalizerPass());
 
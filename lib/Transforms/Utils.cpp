@@ -7,12 +7,16 @@
 #include "scalehls/Transforms/Utils.h"
 #include "mlir/Dialect/Affine/LoopUtils.h"
 #include "mlir/Dialect/Affine/Passes.h"
+#include "mlir/Dialect/Affine/Utils.h"
 #include "mlir/Dialect/MemRef/IR/MemRef.h"
 #include "mlir/Dialect/Tosa/IR/TosaOps.h"
 #include "mlir/IR/Dominance.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
 #include "mlir/Pass/PassManager.h"
+#include "mlir/Transforms/GreedyPatternRewriteDriver.h"
 #include "mlir/Transforms/Passes.h"
 #include "scalehls/Transforms/Passes.h"
+#include "llvm/ADT/ScopedHashTable.h"
 
 using namespace mlir;
 using namespace scalehls;
@@ -34,6 +38,113 @@ static void addMemoryOptsPipeline(PassManager &pm) {
   pm.addPass(createReduceInitialIntervalPass());
 }
 
+MemoryOptsPipeline::MemoryOptsPipeline(MLIRContext *context)
+    : pm(context, "func.func") {
+  addMemoryOptsPipeline(pm);
+
+  // Collect canonicalization patterns in the same way as the canonicalizer.
+  RewritePatternSet patterns(context);
+  for (auto *dialect : context->getLoadedDialects())
+    dialect->getCanonicalizationPatterns(patterns);
+  for (auto op : context->getRegisteredOperations())
+    op.getCanonicalizationPatterns(patterns, context);
+  populateSimplifyAffineIfPatterns(patterns);
+  canonicalizePatterns = FrozenRewritePatternSet(std::move(patterns));
+
+  RewritePatternSet reduceII(context);
+  populateReduceInitialIntervalPatterns(reduceII);
+  reduceIIPatterns = FrozenRewritePatternSet(std::move(reduceII));
+}
+
+/// Apply memory optimizations to the whole function.
+bool MemoryOptsPipeline::apply(func::FuncOp func) {
+  if (failed(pm.run(func)))
+    return false;
+  return true;
+}
+
+namespace {
+/// Hash and compare side effect free operations in the same way as the CSE
+/// pass, where the locations are ignored.
+struct SimpleOperationInfo : public llvm::DenseMapInfo<Operation *> {
+  static unsigned getHashValue(const Operation *opC) {
+    return OperationEquivalence::computeHash(
+        const_cast<Operation *>(opC),
+        /*hashOperands=*/OperationEquivalence::directHashValue,
+        /*hashResults=*/OperationEquivalence::ignoreHashValue,
+        OperationEquivalence::IgnoreLocations);
+  }
+  static bool isEqual(const Operation *lhsC, const Operation *rhsC) {
+    auto lhs = const_cast<Operation *>(lhsC);
+    auto rhs = const_cast<Operation *>(rhsC);
+    if (lhs == rhs)
+      return true;
+    if (lhs == getTombstoneKey() || lhs == getEmptyKey() ||
+        rhs == getTombstoneKey() || rhs == getEmptyKey())
+      return false;
+    return OperationEquivalence::isEquivalentTo(
+        lhs, rhs, OperationEquivalence::IgnoreLocations);
+  }
+};
+} // namespace
+
+using KnownOpsMap =
+    llvm::ScopedHashTable<Operation *, Operation *, SimpleOperationInfo>;
+
+/// Eliminate the common sub-expressions in the block and all its nested blocks.
+/// As only structured control flow is expected, an operation dominates all
+/// following operations in the same block and their nested blocks.
+static void eliminateCommonSubExprs(Block &block, KnownOpsMap &knownOps) {
+  KnownOpsMap::ScopeTy scope(knownOps);
+  for (auto &op : llvm::make_early_inc_range(block)) {
+    if (op.getNumResults() && !op.getNumRegions() && isMemoryEffectFree(&op)) {
+      if (auto existingOp = knownOps.lookup(&op)) {
+        op.replaceAllUsesWith(existingOp);
+        op.erase();
+        continue;
+      }
+      knownOps.insert(&op, &op);
+    }
+
+    for (auto &region : op.getRegions())
+      for (auto &nestedBlock : region)
+        eliminateCommonSubExprs(nestedBlock, knownOps);
+  }
+}
+
+/// Apply memory optimizations only to the operations under the loop band. The
+/// outermost loop of the band is never erased, such that it can still be used
+/// as the handle of the loop band.
+bool MemoryOptsPipeline::apply(AffineLoopBand &band) {
+  auto root = band.front();
+
+  // To factor out the redundant affine operations.
+  SmallVector<AffineForOp, 16> loops;
+  root.walk([&](AffineForOp loop) { loops.push_back(loop); });
+  for (auto loop : loops)
+    (void)normalizeAffineFor(loop);
+  (void)applyPatternsAndFoldGreedily(root, canonicalizePatterns);
+
+  // To simplify the memory accessing.
+  applyAffineStoreForward(root);
+
+  // Generic common sub expression elimination, which is limited to the
+  // operations under the loop band as well.
+  KnownOpsMap knownOps;
+  for (auto &block : root.getLoopBody())
+    eliminateCommonSubExprs(block, knownOps);
+
+  // The outermost loop itself may be the pipelined loop, thus is also taken
+  // into consideration when reducing the initial interval.
+  (void)applyPatternsAndFoldGreedily(root, reduceIIPatterns, {false, true, 1});
+  (void)applyOpPatternsAndFold(root, reduceIIPatterns);
+
+  // The loop band may have been changed by the optimizations, e.g., some loops
+  // are promoted due to single iteration.
+  getLoopBandFromOutermost(root, band);
+  return true;
+}
+
 /// Apply memory optimizations.
 bool scalehls::applyMemoryOpts(func::FuncOp func) {
   PassManager optPM(func.getContext(), "func.func");
@@ -47,7 +158,8 @@ bool scalehls::applyMemoryOpts(func::FuncOp func) {
 /// passed in because the post-tiling optimizations have to take function as
 /// target, e.g. canonicalizer and array partition.
 bool scalehls::applyOptStrategy(AffineLoopBand &band, func::FuncOp func,
-                                FactorList tileList, unsigned targetII) {
+                                FactorList tileList, unsigned targetII,
+                                MemoryOptsPipeline &pipeline) {
   // By design the input function must be the ancestor of the input loop band.
   if (!func->isProperAncestor(band.front()))
     return false;
@@ -62,15 +174,41 @@ bool scalehls::applyOptStrategy(AffineLoopBand &band, func::FuncOp func,
 
   // Apply memory access optimizations and the best suitable array partition
   // strategy to the function.
-  applyMemoryOpts(func);
+  pipeline.apply(func);
   applyAutoArrayPartition(func);
   return true;
 }
 
+/// Apply optimization strategy to a loop band with a pre-built memory
+/// optimization pipeline, where the post-tiling optimizations are only applied
+/// to the operations under the loop band.
+bool scalehls::applyBandOptStrategy(AffineLoopBand &band, func::FuncOp func,
+                                    FactorList tileList, unsigned targetII,
+                                    MemoryOptsPipeline &pipeline) {
+  // By design the input function must be the ancestor of the input loop band.
+  if (!func->isProperAncestor(band.front()))
+    return false;
+
+  // Apply loop tiling.
+  if (!applyLoopTiling(band, tileList))
+    return false;
+
+  // Apply loop pipelining.
+  if (!applyLoopPipelining(band, band.size() - 1, targetII))
+    return false;
+
+  // Apply memory access optimizations and the best suitable array partition
+  // strategy to the loop band.
+  pipeline.apply(band);
+  applyAutoArrayPartition(band);
+  return true;
+}
+
 /// Apply optimization strategy to a function.
 bool scalehls::applyOptStrategy(func::FuncOp func,
                                 ArrayRef<FactorList> tileLists,
-                                ArrayRef<unsigned> targetIIs) {
+                                ArrayRef<unsigned> targetIIs,
+                                MemoryOptsPipeline &pipeline) {
   AffineLoopBands bands;
   getLoopBands(func.front(), bands);
   assert(bands.size() == tileLists.size() && bands.size() == targetIIs.size() &&
@@ -87,7 +225,7 @@ bool scalehls::applyOptStrategy(func::FuncOp func,
 
   // Apply memory access optimizations and the best suitable array partition
   // strategy to the function.
-  applyMemoryOpts(func);
+  pipeline.apply(func);
   applyAutoArrayPartition(func);
   return true;
 }
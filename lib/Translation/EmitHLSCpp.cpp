@@ -8,10 +8,14 @@
 #include "mlir/Analysis/CallGraph.h"
 #include "mlir/IR/AffineExprVisitor.h"
 #include "mlir/IR/IntegerSet.h"
+#include "mlir/IR/Threading.h"
 #include "mlir/Tools/mlir-translate/Translation.h"
 #include "scalehls/Dialect/HLS/Utils.h"
 #include "scalehls/Dialect/HLS/Visitor.h"
 #include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
 
 using namespace mlir;
@@ -23,6 +27,16 @@ static llvm::cl::opt<bool> enforceFalseDependency("enforce-false-dependency",
                                                   llvm::cl::init(false));
 static llvm::cl::opt<int64_t> limitDspNumber("limit-dsp-number",
                                              llvm::cl::init(240));
+static llvm::cl::opt<std::string>
+    emitConstBufferDir("emit-const-buffer-dir", llvm::cl::init(""));
+static llvm::cl::opt<std::string> splitOutputDir("split-output-dir",
+                                                 llvm::cl::init(""));
+static llvm::cl::opt<bool> emitEmulationMain("emit-emulation-main",
+                                             llvm::cl::init(false));
+static llvm::cl::opt<bool> emitTestbench("emit-testbench",
+                                         llvm::cl::init(false));
+static llvm::cl::opt<double> testbenchTolerance("testbench-tolerance",
+                                                llvm::cl::init(1e-3));
 
 //===----------------------------------------------------------------------===//
 // Utils
@@ -237,15 +251,15 @@ static SmallString<8> getConstantString(Type type, Attribute attr) {
     if (floatType.getWidth() == 32) {
       string.append("(float)");
       auto value = attr.cast<FloatAttr>().getValue().convertToFloat();
-      string.append(std::isfinite(value)
-                        ? std::to_string(value)
-                        : (value > 0 ? "INFINITY" : "-INFINITY"));
+      string.append(std::isfinite(value) ? std::to_string(value)
+                    : std::isnan(value)  ? "NAN"
+                    : (value > 0 ? "INFINITY" : "-INFINITY"));
     } else if (floatType.getWidth() == 64) {
       string.append("(double)");
       auto value = attr.cast<FloatAttr>().getValue().convertToDouble();
-      string.append(std::isfinite(value)
-                        ? std::to_string(value)
-                        : (value > 0 ? "INFINITY" : "-INFINITY"));
+      string.append(std::isfinite(value) ? std::to_string(value)
+                    : std::isnan(value)  ? "NAN"
+                    : (value > 0 ? "INFINITY" : "-INFINITY"));
     }
   } else if (auto intType = type.dyn_cast<IntegerType>()) {
     std::string signedness = "";
@@ -270,6 +284,64 @@ static SmallString<8> getConstantString(Type type, Attribute attr) {
   return string;
 }
 
+/// Write the elements of a dense constant as a comma-separated list, which can
+/// be directly included into the initializer of an array. Each innermost row of
+/// the constant is written in one line. Floating-point values are written with
+/// enough digits to be exactly reconstructed.
+static LogicalResult writeConstantData(raw_ostream &os, Type type,
+                                       DenseElementsAttr attr) {
+  auto shape = attr.getType().getShape();
+  int64_t rowSize = shape.empty() ? 1 : std::max(shape.back(), (int64_t)1);
+  int64_t numElements = attr.getNumElements();
+
+  auto writeSeparator = [&](int64_t elementIdx) {
+    if (elementIdx == numElements - 1)
+      os << "\n";
+    else if ((elementIdx + 1) % rowSize == 0)
+      os << ",\n";
+    else
+      os << ", ";
+  };
+  auto writeFloat = [&](double value, const char *fmt) {
+    if (std::isfinite(value))
+      os << llvm::format(fmt, value);
+    else if (std::isnan(value))
+      os << "NAN";
+    else
+      os << (value > 0 ? "INFINITY" : "-INFINITY");
+  };
+
+  int64_t elementIdx = 0;
+  if (type.isInteger(1)) {
+    for (auto value : attr.getValues<bool>()) {
+      os << (value ? "true" : "false");
+      writeSeparator(elementIdx++);
+    }
+  } else if (type.isF32()) {
+    for (auto value : attr.getValues<float>()) {
+      writeFloat(value, "%.9g");
+      writeSeparator(elementIdx++);
+    }
+  } else if (type.isF64()) {
+    for (auto value : attr.getValues<double>()) {
+      writeFloat(value, "%.17g");
+      writeSeparator(elementIdx++);
+    }
+  } else if (type.isIndex() ||
+             (type.isInteger() && type.getIntOrFloatBitWidth() <= 64)) {
+    // Index values are held as 64-bit integers.
+    for (auto value : attr.getValues<APInt>()) {
+      if (type.isUnsignedInteger())
+        os << value.getZExtValue();
+      else
+        os << value.getSExtValue();
+      writeSeparator(elementIdx++);
+    }
+  } else
+    return failure();
+  return success();
+}
+
 SmallString<8> ScaleHLSEmitterBase::getName(Value val) {
   // For constant scalar operations, the constant number will be returned rather
   // than the value name.
@@ -291,12 +363,15 @@ namespace {
 class ModuleEmitter : public ScaleHLSEmitterBase {
 public:
   using operand_range = Operation::operand_range;
-  explicit ModuleEmitter(ScaleHLSEmitterState &state)
-      : ScaleHLSEmitterBase(state) {}
+  explicit ModuleEmitter(ScaleHLSEmitterState &state, unsigned numDSPs = 0)
+      : ScaleHLSEmitterBase(state), numDSPs(numDSPs) {}
 
   /// HLS dialect operation emitters.
   void emitConstBuffer(ConstBufferOp op);
+  void emitConstBufferData(ConstBufferOp op, DenseElementsAttr attr);
   void emitStreamChannel(StreamOp op);
+  void emitMultiBankBuffer(BufferOp op);
+  SmallString<16> getBankName(Value memref);
   void emitStreamRead(StreamReadOp op);
   void emitStreamWrite(StreamWriteOp op);
   void emitAxiPort(AxiPortOp op);
@@ -350,6 +425,9 @@ public:
 
   /// Top-level MLIR module emitter.
   void emitModule(ModuleOp module);
+  void emitModuleHeader(ModuleOp module, ArrayRef<func::FuncOp> funcs);
+  void emitFunctionFile(func::FuncOp func, StringRef headerName);
+  void emitMain(func::FuncOp func);
 
 private:
   /// Helper to get the string indices of TransferRead/Write operations.
@@ -367,9 +445,19 @@ private:
   /// MLIR component and HLS C++ pragma emitters.
   void emitBlock(Block &block);
   void emitLoopDirectives(Operation *op);
-  void emitArrayDirectives(Value memref, bool isInterface = false);
+  void emitArrayDirectives(Value memref, bool isInterface = false,
+                           unsigned dimOffset = 0);
   void emitFunctionDirectives(func::FuncOp func, ArrayRef<Value> portList);
+  void emitFunctionSignature(func::FuncOp func,
+                             SmallVectorImpl<Value> &portList);
   void emitFunction(func::FuncOp func);
+  void emitPreamble(ModuleOp module, bool isHeader = false);
+
+  /// Main function emitters.
+  void emitMainPorts(func::FuncOp func, SmallVectorImpl<Value> &portList);
+  void emitMainCall(func::FuncOp func, ArrayRef<Value> portList);
+  void emitEmulationMain(func::FuncOp func);
+  void emitTestbenchMain(func::FuncOp func);
 
   unsigned numDSPs = 0;
 };
@@ -472,7 +560,9 @@ public:
   bool visitOp(BufferOp op) {
     if (op.getDepth() == 1)
       return emitter.emitAlloc(op), true;
-    return op.emitOpError("only support depth of 1"), false;
+    if (!isExtBuffer(op.getMemref()))
+      return emitter.emitMultiBankBuffer(op), true;
+    return op.emitOpError("only support depth of 1 for external buffer"), false;
   }
   bool visitOp(ConstBufferOp op) { return emitter.emitConstBuffer(op), true; }
   bool visitOp(StreamOp op) { return emitter.emitStreamChannel(op), true; }
@@ -699,15 +789,109 @@ bool ExprVisitor::visitOp(arith::CmpIOp op) {
 
 /// HLS dialect operation emitters.
 void ModuleEmitter::emitConstBuffer(ConstBufferOp op) {
-  emitConstant(op);
+  auto denseAttr = op.getValue().dyn_cast<DenseElementsAttr>();
+  if (!emitConstBufferDir.empty() && denseAttr)
+    emitConstBufferData(op, denseAttr);
+  else
+    emitConstant(op);
   emitArrayDirectives(op.getResult());
 }
 
+/// Write the data of a constant buffer to a side file under the directory
+/// specified by "emit-const-buffer-dir", which is then included into the array
+/// initializer. In this way, large weights are kept out of the generated C++
+/// while still being initialized at compile time, such that the buffer can be
+/// implemented as a ROM by the HLS tool.
+void ModuleEmitter::emitConstBufferData(ConstBufferOp op,
+                                        DenseElementsAttr attr) {
+  if (isDeclared(op.getResult()))
+    return;
+
+  indent();
+  emitArrayDecl(op.getResult());
+
+  // The data file is included with an absolute path, such that the generated
+  // C++ can be compiled from any working directory.
+  auto func = op->getParentOfType<func::FuncOp>();
+  SmallString<64> path(emitConstBufferDir);
+  llvm::sys::fs::make_absolute(path);
+  llvm::sys::path::append(path, Twine(func.getName()) + "_" +
+                                    getName(op.getResult()) + ".dat");
+
+  std::error_code ec = llvm::sys::fs::create_directories(emitConstBufferDir);
+  llvm::raw_fd_ostream dataOs(path, ec);
+  if (ec) {
+    emitError(op, "failed to open " + path + ": " + ec.message());
+    return;
+  }
+
+  auto type = op.getType().getElementType();
+  if (failed(writeConstantData(dataOs, type, attr))) {
+    emitError(op, "constant has invalid value");
+    return;
+  }
+
+  os << " = {\n#include \"" << path << "\"\n";
+  indent() << "};";
+  emitInfoAndNewLine(op);
+}
+
 void ModuleEmitter::emitStreamChannel(StreamOp op) {
   indent();
   emitValue(op.getChannel());
   os << ";";
   emitInfoAndNewLine(op);
+
+  indent() << "#pragma HLS stream variable=";
+  emitValue(op.getChannel());
+  os << " depth=" << op.getDepth() << "\n";
+}
+
+/// Return the on-chip multi-bank buffer defining the given value, if any.
+static BufferOp getMultiBankBuffer(Value val) {
+  auto buffer = val.getDefiningOp<BufferOp>();
+  if (buffer && buffer.getDepth() > 1 && !isExtBuffer(val))
+    return buffer;
+  return BufferOp();
+}
+
+/// Return the name of the rotating bank index of a multi-bank buffer.
+SmallString<16> ModuleEmitter::getBankName(Value memref) {
+  SmallString<16> bank(getName(memref));
+  bank += "_bank";
+  return bank;
+}
+
+/// A multi-bank buffer is emitted as a static array of banks, where the number
+/// of banks is one more than the depth, as a depth of one already indicates a
+/// ping-pong buffer. The bank index is rotated at each invocation, such that
+/// the producer always writes the current bank, while a consumer with input tap
+/// "t" reads the bank written "t" invocations earlier.
+void ModuleEmitter::emitMultiBankBuffer(BufferOp op) {
+  if (isDeclared(op.getMemref()))
+    return;
+
+  auto type = op.getMemref().getType().cast<MemRefType>();
+  if (!type.hasStaticShape())
+    emitError(op, "is unranked or has dynamic shape.");
+
+  auto numBanks = op.getDepth() + 1;
+  indent() << "static ";
+  emitValue(op.getMemref());
+  os << "[" << numBanks << "]";
+  for (auto &shape : type.getShape())
+    os << "[" << shape << "]";
+  os << ";";
+  emitInfoAndNewLine(op);
+
+  indent() << "#pragma HLS array_partition variable=";
+  emitValue(op.getMemref());
+  os << " complete dim=1\n";
+  emitArrayDirectives(op.getMemref(), /*isInterface=*/false, /*dimOffset=*/1);
+
+  auto bank = getBankName(op.getMemref());
+  indent() << "static int " << bank << " = 0;\n";
+  indent() << bank << " = (" << bank << " + 1) % " << numBanks << ";\n";
 }
 
 void ModuleEmitter::emitStreamRead(StreamReadOp op) {
@@ -878,10 +1062,24 @@ void ModuleEmitter::emitCall(func::CallOp op) {
   // Emit the function call.
   indent() << op.getCallee() << "(";
 
-  // Handle input arguments.
+  // Handle input arguments. The bank of a multi-bank buffer is selected by
+  // the input tap of the call, where outputs are always written to the current
+  // bank.
+  auto inputTaps = op->getAttrOfType<ArrayAttr>("inputTaps");
   unsigned argIdx = 0;
   for (auto arg : op.getOperands()) {
     emitValue(arg);
+    if (auto buffer = getMultiBankBuffer(arg)) {
+      auto bank = getBankName(arg);
+      int64_t tap = 0;
+      if (inputTaps && argIdx < inputTaps.size())
+        tap = inputTaps[argIdx].cast<IntegerAttr>().getInt();
+      if (tap)
+        os << "[(" << bank << " + " << buffer.getDepth() + 1 - tap << ") % "
+           << buffer.getDepth() + 1 << "]";
+      else
+        os << "[" << bank << "]";
+    }
 
     if (argIdx++ != op.getNumOperands() - 1)
       os << ", ";
@@ -1796,7 +1994,8 @@ void ModuleEmitter::emitLoopDirectives(Operation *loop) {
     indent() << "#pragma HLS dataflow\n";
 }
 
-void ModuleEmitter::emitArrayDirectives(Value memref, bool isInterface) {
+void ModuleEmitter::emitArrayDirectives(Value memref, bool isInterface,
+                                        unsigned dimOffset) {
   bool emitPragmaFlag = false;
   auto type = memref.getType().cast<MemRefType>();
 
@@ -1819,9 +2018,9 @@ void ModuleEmitter::emitArrayDirectives(Value memref, bool isInterface) {
 
         // Vitis HLS has a wierd feature/bug that will automatically collapse
         // the first dimension if its size is equal to one.
-        auto directiveDim = dim + 1;
+        auto directiveDim = dim + dimOffset + 1;
         if (emitVitisDirectives.getValue())
-          if (type.getShape().front() == 1)
+          if (!dimOffset && type.getShape().front() == 1)
             directiveDim = dim;
         os << " dim=" << directiveDim << "\n";
       }
@@ -1934,12 +2133,27 @@ void ModuleEmitter::emitFunction(func::FuncOp func) {
     os << "\n";
   }
 
-  // Emit function signature.
-  os << "void " << func.getName() << "(\n";
-  addIndent();
-
   // This vector is to record all ports of the function.
   SmallVector<Value, 8> portList;
+  emitFunctionSignature(func, portList);
+  os << " {";
+  emitInfoAndNewLine(func);
+
+  // Emit function body.
+  addIndent();
+
+  emitFunctionDirectives(func, portList);
+  emitBlock(func.front());
+  reduceIndent();
+  os << "}\n";
+  // An empty line.
+  os << "\n";
+}
+
+void ModuleEmitter::emitFunctionSignature(func::FuncOp func,
+                                          SmallVectorImpl<Value> &portList) {
+  os << "void " << func.getName() << "(\n";
+  addIndent();
 
   // Emit input arguments.
   unsigned argIdx = 0;
@@ -1976,22 +2190,33 @@ void ModuleEmitter::emitFunction(func::FuncOp func) {
   }
 
   reduceIndent();
-  os << "\n) {";
-  emitInfoAndNewLine(func);
+  os << "\n)";
+}
 
-  // Emit function body.
-  addIndent();
+/// Top-level MLIR module emitter.
+/// Collect all functions to be emitted, where each callee is ordered before its
+/// callers by walking the call graph in a post order.
+static SmallVector<func::FuncOp> getFuncsToEmit(ModuleOp module) {
+  SmallVector<func::FuncOp> funcs;
+  llvm::SmallDenseSet<func::FuncOp> emittedFuncs;
 
-  emitFunctionDirectives(func, portList);
-  emitBlock(func.front());
-  reduceIndent();
-  os << "}\n";
-  // An empty line.
-  os << "\n";
+  CallGraph graph(module);
+  for (auto node : llvm::post_order<const CallGraph *>(&graph)) {
+    if (node->isExternal())
+      continue;
+    if (auto func = node->getCallableRegion()->getParentOfType<func::FuncOp>();
+        !hasRuntimeAttr(func) && emittedFuncs.insert(func).second)
+      funcs.push_back(func);
+  }
+
+  // Collect remained functions accordingly.
+  for (auto func : module.getOps<func::FuncOp>())
+    if (!emittedFuncs.count(func) && !hasRuntimeAttr(func))
+      funcs.push_back(func);
+  return funcs;
 }
 
-/// Top-level MLIR module emitter.
-void ModuleEmitter::emitModule(ModuleOp module) {
+void ModuleEmitter::emitPreamble(ModuleOp module, bool isHeader) {
   os << R"XXX(
 //===------------------------------------------------------------*- C++ -*-===//
 //
@@ -1999,7 +2224,12 @@ void ModuleEmitter::emitModule(ModuleOp module) {
 //
 //===----------------------------------------------------------------------===//
 
-#include <algorithm>
+)XXX";
+
+  if (isHeader)
+    os << "#pragma once\n\n";
+
+  os << R"XXX(#include <algorithm>
 #include <ap_axi_sdata.h>
 #include <ap_fixed.h>
 #include <ap_int.h>
@@ -2014,12 +2244,14 @@ using namespace std;
 
 )XXX";
 
-  // Emit the multiplication primitive if required.
+  // Emit the multiplication primitive if required. When emitted into a header,
+  // the primitive is inlined to avoid multiple definitions across files.
   if (module.walk([](PrimMulOp op) {
         return op.isPackMul() ? WalkResult::interrupt() : WalkResult::advance();
-      }) == WalkResult::interrupt())
+      }) == WalkResult::interrupt()) {
+    os << (isHeader ? "\ninline " : "\n");
+    os << "void pack_mul(int8_t A[2], int8_t B, int16_t C[2]) {";
     os << R"XXX(
-void pack_mul(int8_t A[2], int8_t B, int16_t C[2]) {
   #pragma HLS inline
   ap_int<27> packA = (ap_int<27>)A[0] + (ap_int<27>)A[1] << 18;
   ap_int<45> packC = packA * (ap_int<18>)B;
@@ -2028,35 +2260,360 @@ void pack_mul(int8_t A[2], int8_t B, int16_t C[2]) {
 }
 
 )XXX";
+  }
+}
+
+/// Return the top function to be driven by the main function. If no function is
+/// marked as top, the last emitted function is returned.
+static func::FuncOp getMainTopFunc(ArrayRef<func::FuncOp> funcs) {
+  for (auto func : funcs)
+    if (hasTopFuncAttr(func))
+      return func;
+  return funcs.empty() ? func::FuncOp() : funcs.back();
+}
+
+void ModuleEmitter::emitModule(ModuleOp module) {
+  emitPreamble(module);
 
   // Emit all functions in the call graph in a post order.
-  CallGraph graph(module);
-  llvm::SmallDenseSet<func::FuncOp> emittedFuncs;
-  for (auto node : llvm::post_order<const CallGraph *>(&graph)) {
-    if (node->isExternal())
+  auto funcs = getFuncsToEmit(module);
+  for (auto func : funcs)
+    emitFunction(func);
+
+  for (auto &op : *module.getBody())
+    if (!isa<func::FuncOp, ml_program::GlobalOp>(op))
+      emitError(&op, "is unsupported operation");
+
+  // The main function is emitted with a separate name table, as the ports of
+  // the top function have been declared in its signature.
+  if (emitEmulationMain || emitTestbench) {
+    if (auto topFunc = getMainTopFunc(funcs)) {
+      ScaleHLSEmitterState mainState(os);
+      ModuleEmitter(mainState).emitMain(topFunc);
+      state.encounteredError |= mainState.encounteredError;
+    } else
+      emitError(module, "has no function to drive");
+  }
+}
+
+void ModuleEmitter::emitMain(func::FuncOp func) {
+  if (emitTestbench)
+    emitTestbenchMain(func);
+  else
+    emitEmulationMain(func);
+}
+
+/// Collect the ports of the top function, including its arguments and results,
+/// and declare them as static variables to avoid overflowing the stack.
+void ModuleEmitter::emitMainPorts(func::FuncOp func,
+                                  SmallVectorImpl<Value> &portList) {
+  portList.append(func.args_begin(), func.args_end());
+  auto funcReturn = cast<func::ReturnOp>(func.front().getTerminator());
+  portList.append(funcReturn.operand_begin(), funcReturn.operand_end());
+
+  for (auto port : portList) {
+    if (isDeclared(port))
+      continue;
+    indent() << "static ";
+    if (peelAxiType(port.getType()).isa<MemRefType>())
+      emitArrayDecl(port);
+    else
+      emitValue(port);
+    os << ";\n";
+  }
+  os << "\n";
+}
+
+void ModuleEmitter::emitMainCall(func::FuncOp func, ArrayRef<Value> portList) {
+  indent() << func.getName() << "(";
+  for (auto port : llvm::enumerate(portList)) {
+    if (port.index())
+      os << ", ";
+    // Scalar results are passed as pointers.
+    if (port.index() >= func.getNumArguments() &&
+        !port.value().getType().isa<MemRefType>())
+      os << "&";
+    emitValue(port.value());
+  }
+  os << ");\n";
+}
+
+/// Emit the main function for the software emulation of the top function on
+/// the host. Each port is initialized from the file given by the corresponding
+/// command line argument, or with random values if the argument is missing or
+/// "-". The elapsed time of the top function and the checksum of each port are
+/// printed after the execution.
+void ModuleEmitter::emitEmulationMain(func::FuncOp func) {
+  os << "#include \"scalehls_emu.h\"\n\n";
+  os << "int main(int argc, char **argv) {\n";
+  addIndent();
+
+  SmallVector<Value, 8> portList;
+  emitMainPorts(func, portList);
+
+  unsigned portIdx = 0;
+  for (auto port : portList) {
+    indent() << "scalehls_emu::init_port(";
+    emitValue(port);
+    os << ", argc, argv, " << portIdx++ << ");\n";
+  }
+  os << "\n";
+
+  indent() << "scalehls_emu::timer timer;\n";
+  emitMainCall(func, portList);
+  indent() << "printf(\"" << func.getName()
+           << ": %.3f ms\\n\", timer.elapsed_ms());\n";
+
+  portIdx = 0;
+  for (auto port : portList) {
+    indent() << "printf(\"port " << portIdx++
+             << " checksum: %f\\n\", scalehls_emu::checksum(";
+    emitValue(port);
+    os << "));\n";
+  }
+
+  indent() << "return 0;\n";
+  reduceIndent();
+  os << "}\n";
+}
+
+/// Return the native C++ type holding an element of the given type in the data
+/// files of the golden reference, where each element is stored in the fewest
+/// bytes covering its bit width.
+static std::string getNativeTypeName(Type type) {
+  auto valType = peelAxiType(type);
+  if (auto arrayType = valType.dyn_cast<MemRefType>())
+    return getNativeTypeName(arrayType.getElementType());
+
+  if (valType.isa<Float32Type>())
+    return "float";
+  else if (valType.isa<Float64Type>())
+    return "double";
+  else if (valType.isa<IndexType>())
+    return "int64_t";
+  else if (auto intType = valType.dyn_cast<IntegerType>()) {
+    auto width = intType.getWidth();
+    if (width > 64)
+      return "";
+    unsigned nativeWidth = 8;
+    while (nativeWidth < width)
+      nativeWidth *= 2;
+    auto isUnsigned = intType.isUnsigned() || width == 1;
+    return (isUnsigned ? "uint" : "int") + std::to_string(nativeWidth) + "_t";
+  }
+  return "";
+}
+
+/// Emit a C-simulation testbench of the top function, which loads each port
+/// from "input<N>.bin" under the directory given by the first command line
+/// argument, runs the top function, and compares each port against the golden
+/// reference in "golden<N>.bin" with a relative tolerance. The data files hold
+/// raw elements in their native types, as dumped by scalehls-golden. Only the
+/// standard library is used by the testbench, such that it can be compiled
+/// against either the vendor HLS headers or the host emulation headers.
+void ModuleEmitter::emitTestbenchMain(func::FuncOp func) {
+  os << R"XXX(#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <type_traits>
+
+template <typename T, typename F> void tb_for_each(T &value, F &&f) {
+  if constexpr (std::is_array<T>::value) {
+    for (auto &element : value)
+      tb_for_each(element, f);
+  } else
+    f(value);
+}
+
+template <typename NativeT, typename T>
+bool tb_load(T &value, const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  bool success = (bool)file;
+  tb_for_each(value, [&](auto &element) {
+    NativeT native = 0;
+    success = success && file.read((char *)&native, sizeof(NativeT));
+    element = native;
+  });
+  if (!success)
+    printf("error: failed to load %s\n", path.c_str());
+  return success;
+}
+
+template <typename NativeT, typename T>
+unsigned tb_compare(T &value, const std::string &path, double tolerance) {
+  std::ifstream file(path, std::ios::binary);
+  unsigned index = 0, errors = 0;
+  tb_for_each(value, [&](auto &element) {
+    NativeT native = 0;
+    file.read((char *)&native, sizeof(NativeT));
+    double actual = (double)element, expected = (double)native;
+    if (!file || std::fabs(actual - expected) >
+                     tolerance * (1.0 + std::fabs(expected)))
+      if (errors++ < 10)
+        printf("mismatch at %s[%u]: %f vs %f\n", path.c_str(), index, actual,
+               expected);
+    ++index;
+  });
+  return errors;
+}
+
+int main(int argc, char **argv) {
+  std::string dir = argc > 1 ? argv[1] : ".";
+)XXX";
+  addIndent();
+
+  SmallVector<Value, 8> portList;
+  emitMainPorts(func, portList);
+
+  for (auto port : llvm::enumerate(portList)) {
+    auto nativeType = getNativeTypeName(port.value().getType());
+    if (nativeType.empty()) {
+      emitError(func, "has port with unsupported type for testbench");
       continue;
-    if (auto func = node->getCallableRegion()->getParentOfType<func::FuncOp>();
-        !hasRuntimeAttr(func)) {
-      emitFunction(func);
-      emittedFuncs.insert(func);
     }
+    indent() << "if (!tb_load<" << nativeType << ">(";
+    emitValue(port.value());
+    os << ", dir + \"/input" << port.index() << ".bin\"))\n";
+    indent() << "  return 1;\n";
   }
+  os << "\n";
 
-  // Emit remained functions accordingly.
-  for (auto &op : *module.getBody()) {
-    if (auto func = dyn_cast<func::FuncOp>(op)) {
-      if (!emittedFuncs.count(func) && !hasRuntimeAttr(func))
-        emitFunction(func);
-    } else if (!isa<ml_program::GlobalOp>(op))
-      emitError(&op, "is unsupported operation");
+  emitMainCall(func, portList);
+  os << "\n";
+
+  indent() << "unsigned errors = 0;\n";
+  for (auto port : llvm::enumerate(portList)) {
+    auto nativeType = getNativeTypeName(port.value().getType());
+    if (nativeType.empty())
+      continue;
+    indent() << "errors += tb_compare<" << nativeType << ">(";
+    emitValue(port.value());
+    os << ", dir + \"/golden" << port.index()
+       << ".bin\", " << testbenchTolerance << ");\n";
   }
+
+  indent() << "if (errors) {\n";
+  indent() << "  printf(\"FAIL: %u mismatches\\n\", errors);\n";
+  indent() << "  return 1;\n";
+  indent() << "}\n";
+  indent() << "printf(\"PASS\\n\");\n";
+  indent() << "return 0;\n";
+  reduceIndent();
+  os << "}\n";
+}
+
+/// Emit the shared header of a split output, which contains the declarations
+/// of all emitted functions.
+void ModuleEmitter::emitModuleHeader(ModuleOp module,
+                                     ArrayRef<func::FuncOp> funcs) {
+  emitPreamble(module, /*isHeader=*/true);
+
+  for (auto func : funcs) {
+    SmallVector<Value, 8> portList;
+    emitFunctionSignature(func, portList);
+    os << ";\n\n";
+  }
+
+  for (auto &op : *module.getBody())
+    if (!isa<func::FuncOp, ml_program::GlobalOp>(op))
+      emitError(&op, "is unsupported operation");
+}
+
+/// Emit a standalone file of the given function, which only depends on the
+/// shared header of the split output.
+void ModuleEmitter::emitFunctionFile(func::FuncOp func, StringRef headerName) {
+  os << R"XXX(
+//===------------------------------------------------------------*- C++ -*-===//
+//
+// Automatically generated file for High-level Synthesis (HLS).
+//
+//===----------------------------------------------------------------------===//
+
+)XXX";
+  os << "#include \"" << headerName << "\"\n\n";
+  emitFunction(func);
 }
 
 //===----------------------------------------------------------------------===//
 // Entry of scalehls-translate
 //===----------------------------------------------------------------------===//
 
+/// Emit each function into its own file under "dir" in parallel, together with
+/// a shared header declaring all functions. Each function is emitted with its
+/// own emitter state. To keep the output deterministic, the DSP budget consumed
+/// by the preceding functions is counted ahead in the order of emission.
+static LogicalResult emitSplitHLSCpp(ModuleOp module, StringRef dir) {
+  auto funcs = getFuncsToEmit(module);
+
+  llvm::SmallDenseMap<func::FuncOp, unsigned> numDSPsMap;
+  unsigned numDSPs = 0;
+  for (auto func : funcs) {
+    numDSPsMap[func] = numDSPs;
+    func.walk([&](PrimMulOp op) {
+      if (!op.isPackMul())
+        ++numDSPs;
+    });
+  }
+
+  if (auto ec = llvm::sys::fs::create_directories(dir))
+    return module.emitError("failed to create " + dir + ": " + ec.message());
+
+  auto headerName = module.getName().value_or("kernel").str() + ".h";
+  SmallString<64> headerPath(dir);
+  llvm::sys::path::append(headerPath, headerName);
+
+  std::error_code ec;
+  llvm::raw_fd_ostream headerOs(headerPath, ec);
+  if (ec)
+    return module.emitError("failed to open " + headerPath + ": " +
+                            ec.message());
+  ScaleHLSEmitterState headerState(headerOs);
+  ModuleEmitter(headerState).emitModuleHeader(module, funcs);
+  if (headerState.encounteredError)
+    return failure();
+
+  if (emitEmulationMain || emitTestbench) {
+    auto topFunc = getMainTopFunc(funcs);
+    if (!topFunc)
+      return module.emitError("has no function to drive");
+
+    SmallString<64> mainPath(dir);
+    llvm::sys::path::append(mainPath, "main.cpp");
+    llvm::raw_fd_ostream mainOs(mainPath, ec);
+    if (ec)
+      return module.emitError("failed to open " + mainPath + ": " +
+                              ec.message());
+
+    ScaleHLSEmitterState mainState(mainOs);
+    mainOs << "#include \"" << headerName << "\"\n";
+    ModuleEmitter(mainState).emitMain(topFunc);
+    if (mainState.encounteredError)
+      return failure();
+  }
+
+  return failableParallelForEach(
+      module.getContext(), funcs, [&](func::FuncOp func) -> LogicalResult {
+        SmallString<64> path(dir);
+        llvm::sys::path::append(path, func.getName() + ".cpp");
+
+        std::error_code ec;
+        llvm::raw_fd_ostream os(path, ec);
+        if (ec)
+          return func.emitError("failed to open " + path + ": " +
+                                ec.message());
+
+        ScaleHLSEmitterState state(os);
+        ModuleEmitter(state, numDSPsMap.lookup(func))
+            .emitFunctionFile(func, headerName);
+        return failure(state.encounteredError);
+      });
+}
+
 LogicalResult scalehls::emitHLSCpp(ModuleOp module, llvm::raw_ostream &os) {
+  if (!splitOutputDir.empty())
+    return emitSplitHLSCpp(module, splitOutputDir);
+
   ScaleHLSEmitterState state(os);
   ModuleEmitter(state).emitModule(module);
   return failure(state.encounteredError);
@@ -0,0 +1,36 @@
+// RUN: rm -rf %t
+// RUN: scalehls-translate -scalehls-emit-hlscpp -emit-const-buffer-dir=%t %s | FileCheck %s
+// RUN: FileCheck %s --check-prefix=DATA < %t/test_const_buffer_v0.dat
+// RUN: FileCheck %s --check-prefix=FLOAT < %t/test_const_buffer_float_v0.dat
+// RUN: FileCheck %s --check-prefix=INDEX < %t/test_const_buffer_index_v0.dat
+
+// The data file is included with an absolute path.
+// CHECK-LABEL: void test_const_buffer(
+// CHECK:       ap_int<8> v0[2][3] = {
+// CHECK-NEXT:  #include "/{{.*}}test_const_buffer_v0.dat"
+// CHECK-NEXT:  };
+
+// DATA:        1, -2, 3,
+// DATA-NEXT:   4, 5, -6
+func.func @test_const_buffer() {
+  %c0 = arith.constant 0 : index
+  %0 = hls.dataflow.const_buffer {value = dense<[[1, -2, 3], [4, 5, -6]]> : tensor<2x3xi8>} : memref<2x3xi8>
+  %1 = affine.load %0[%c0, %c0] : memref<2x3xi8>
+  return
+}
+
+// FLOAT:       1.5, NAN, INFINITY, -INFINITY
+func.func @test_const_buffer_float() {
+  %c0 = arith.constant 0 : index
+  %0 = hls.dataflow.const_buffer {value = dense<[1.5, 0x7FC00000, 0x7F800000, 0xFF800000]> : tensor<4xf32>} : memref<4xf32>
+  %1 = affine.load %0[%c0] : memref<4xf32>
+  return
+}
+
+// INDEX:       0, -1, 4294967296
+func.func @test_const_buffer_index() {
+  %c0 = arith.constant 0 : index
+  %0 = hls.dataflow.const_buffer {value = dense<[0, -1, 4294967296]> : tensor<3xindex>} : memref<3xindex>
+  %1 = affine.load %0[%c0] : memref<3xindex>
+  return
+}
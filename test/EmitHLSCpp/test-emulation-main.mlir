@@ -0,0 +1,15 @@
+// RUN: scalehls-translate -scalehls-emit-hlscpp -emit-emulation-main %s | FileCheck %s
+
+// CHECK:       #include "scalehls_emu.h"
+// CHECK-LABEL: int main(int argc, char **argv) {
+// CHECK:         static ap_int<8> [[VAL_0:.*]][16];
+// CHECK:         static float [[VAL_1:.*]];
+// CHECK:         scalehls_emu::init_port([[VAL_0]], argc, argv, 0);
+// CHECK:         scalehls_emu::init_port([[VAL_1]], argc, argv, 1);
+// CHECK:         scalehls_emu::timer timer;
+// CHECK:         test_top([[VAL_0]], [[VAL_1]]);
+// CHECK:         printf("port 0 checksum: %f\n", scalehls_emu::checksum([[VAL_0]]));
+// CHECK:         return 0;
+func.func @test_top(%arg0: memref<16xi8>, %arg1: f32) attributes {top_func} {
+  return
+}
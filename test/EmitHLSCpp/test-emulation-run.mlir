@@ -0,0 +1,21 @@
+// REQUIRES: host-cxx
+// RUN: scalehls-translate -scalehls-emit-hlscpp -emit-emulation-main %s -o %t.cpp
+// RUN: %host_cxx -std=c++17 -Wno-unknown-pragmas -I %scalehls_emu_include %t.cpp -o %t.exe
+// RUN: %PYTHON -c "import struct; open('%t.in', 'wb').write(struct.pack('4i', 1, 2, 3, 4))"
+// RUN: %t.exe %t.in - | FileCheck %s
+
+// The emitted C++ is compiled against the host emulation headers and run with
+// the input port loaded from a file, where the output port holds the doubled
+// input values.
+// CHECK: test_emulation_run: {{.*}} ms
+// CHECK: port 0 checksum: 10.000000
+// CHECK: port 1 checksum: 20.000000
+func.func @test_emulation_run(%arg0: memref<4xi32>, %arg1: memref<4xi32>) attributes {top_func} {
+  %c2_i32 = arith.constant 2 : i32
+  affine.for %arg2 = 0 to 4 {
+    %0 = affine.load %arg0[%arg2] : memref<4xi32>
+    %1 = arith.muli %0, %c2_i32 : i32
+    affine.store %1, %arg1[%arg2] : memref<4xi32>
+  }
+  return
+}
@@ -0,0 +1,43 @@
+// RUN: scalehls-opt -scalehls-convert-dataflow-to-func %s | scalehls-translate -scalehls-emit-hlscpp | FileCheck %s
+
+// A multi-bank buffer is emitted as a static array with one more bank than its
+// depth. The bank index is rotated at each invocation, where the producer
+// writes the current bank and each consumer reads the bank selected by its
+// input tap.
+// CHECK-LABEL: void test_multi_bank_buffer(
+// CHECK:       static ap_int<8> [[BUF:v[0-9]+]][3][4];
+// CHECK:       #pragma HLS array_partition variable=[[BUF]] complete dim=1
+// CHECK:       static int [[BUF]]_bank = 0;
+// CHECK:       [[BUF]]_bank = ([[BUF]]_bank + 1) % 3;
+// CHECK:       ap_int<8> [[COPY:v[0-9]+]][4];
+// CHECK:       test_multi_bank_buffer_node{{[0-9]+}}([[BUF]]{{\[}}[[BUF]]_bank]);
+// CHECK:       test_multi_bank_buffer_node{{[0-9]+}}([[BUF]]{{\[}}[[BUF]]_bank], [[COPY]]);
+// CHECK:       test_multi_bank_buffer_node{{[0-9]+}}([[BUF]][([[BUF]]_bank + 2) % 3], [[COPY]]);
+func.func @test_multi_bank_buffer() {
+  hls.dataflow.schedule {
+    %0 = hls.dataflow.buffer {depth = 2 : i32} : memref<4xi8, #hls.mem<bram_t2p>>
+    %1 = hls.dataflow.buffer {depth = 1 : i32} : memref<4xi8, #hls.mem<bram_t2p>>
+    hls.dataflow.node() -> (%0) {inputTaps = [], level = 2 : i32} : () -> memref<4xi8, #hls.mem<bram_t2p>> {
+    ^bb0(%arg0: memref<4xi8, #hls.mem<bram_t2p>>):
+      %c0_i8 = arith.constant 0 : i8
+      affine.for %arg1 = 0 to 4 {
+        affine.store %c0_i8, %arg0[%arg1] : memref<4xi8, #hls.mem<bram_t2p>>
+      }
+    }
+    hls.dataflow.node(%0) -> (%1) {inputTaps = [0 : i32], level = 1 : i32} : (memref<4xi8, #hls.mem<bram_t2p>>) -> memref<4xi8, #hls.mem<bram_t2p>> {
+    ^bb0(%arg0: memref<4xi8, #hls.mem<bram_t2p>>, %arg1: memref<4xi8, #hls.mem<bram_t2p>>):
+      affine.for %arg2 = 0 to 4 {
+        %2 = affine.load %arg0[%arg2] : memref<4xi8, #hls.mem<bram_t2p>>
+        affine.store %2, %arg1[%arg2] : memref<4xi8, #hls.mem<bram_t2p>>
+      }
+    }
+    hls.dataflow.node(%0, %1) -> () {inputTaps = [1 : i32, 0 : i32], level = 0 : i32} : (memref<4xi8, #hls.mem<bram_t2p>>, memref<4xi8, #hls.mem<bram_t2p>>) -> () {
+    ^bb0(%arg0: memref<4xi8, #hls.mem<bram_t2p>>, %arg1: memref<4xi8, #hls.mem<bram_t2p>>):
+      affine.for %arg2 = 0 to 4 {
+        %2 = affine.load %arg0[%arg2] : memref<4xi8, #hls.mem<bram_t2p>>
+        %3 = affine.load %arg1[%arg2] : memref<4xi8, #hls.mem<bram_t2p>>
+      }
+    }
+  }
+  return
+}
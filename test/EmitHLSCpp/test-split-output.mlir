@@ -0,0 +1,27 @@
+// RUN: rm -rf %t
+// RUN: scalehls-translate -scalehls-emit-hlscpp -split-output-dir=%t %s
+// RUN: FileCheck %s --check-prefix=HEADER < %t/kernel.h
+// RUN: FileCheck %s --check-prefix=CALLEE < %t/test_callee.cpp
+// RUN: FileCheck %s --check-prefix=CALLER < %t/test_caller.cpp
+
+// HEADER:      #pragma once
+// HEADER:      void test_callee(
+// HEADER:      );
+// HEADER:      void test_caller(
+// HEADER:      );
+
+// CALLEE:      #include "kernel.h"
+// CALLEE:      void test_callee(
+// CALLEE-NOT:  void test_caller(
+
+// CALLER:      #include "kernel.h"
+// CALLER:      void test_caller(
+// CALLER:      test_callee(
+func.func @test_callee(%arg0: memref<16xi8>) {
+  return
+}
+
+func.func @test_caller(%arg0: memref<16xi8>) {
+  call @test_callee(%arg0) : (memref<16xi8>) -> ()
+  return
+}
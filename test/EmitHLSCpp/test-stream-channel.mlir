@@ -0,0 +1,29 @@
+// RUN: scalehls-translate -scalehls-emit-hlscpp %s | FileCheck %s
+
+// The FIFO depth of each stream channel is emitted as a stream pragma.
+// CHECK-LABEL: void test_stream_channel(
+// CHECK:       hls::stream<float> [[STREAM:v[0-9]+]];
+// CHECK-NEXT:  #pragma HLS stream variable=[[STREAM]] depth=8
+// CHECK:       test_producer([[STREAM]]);
+// CHECK:       test_consumer([[STREAM]]);
+func.func @test_producer(%arg0: !hls.stream<f32, 8>) {
+  %cst = arith.constant 0.000000e+00 : f32
+  affine.for %arg1 = 0 to 8 {
+    hls.dataflow.stream_write %arg0, %cst : <f32, 8>, f32
+  }
+  return
+}
+
+func.func @test_consumer(%arg0: !hls.stream<f32, 8>) {
+  affine.for %arg1 = 0 to 8 {
+    %0 = hls.dataflow.stream_read %arg0 : (!hls.stream<f32, 8>) -> f32
+  }
+  return
+}
+
+func.func @test_stream_channel() {
+  %0 = hls.dataflow.stream {depth = 8 : i32} : <f32, 8>
+  call @test_producer(%0) : (!hls.stream<f32, 8>) -> ()
+  call @test_consumer(%0) : (!hls.stream<f32, 8>) -> ()
+  return
+}
@@ -0,0 +1,14 @@
+// RUN: scalehls-translate -scalehls-emit-hlscpp -emit-testbench %s | FileCheck %s
+
+// CHECK-LABEL: int main(int argc, char **argv) {
+// CHECK:         static ap_int<8> [[VAL_0:.*]][16];
+// CHECK:         static float [[VAL_1:.*]][4];
+// CHECK:         if (!tb_load<int8_t>([[VAL_0]], dir + "/input0.bin"))
+// CHECK:         if (!tb_load<float>([[VAL_1]], dir + "/input1.bin"))
+// CHECK:         test_top([[VAL_0]], [[VAL_1]]);
+// CHECK:         errors += tb_compare<int8_t>([[VAL_0]], dir + "/golden0.bin", {{.*}});
+// CHECK:         errors += tb_compare<float>([[VAL_1]], dir + "/golden1.bin", {{.*}});
+// CHECK:         printf("PASS\n");
+func.func @test_top(%arg0: memref<16xi8>, %arg1: memref<4xf32>) attributes {top_func} {
+  return
+}
@@ -0,0 +1,25 @@
+// RUN: rm -rf %t
+// RUN: scalehls-golden %s -top-func=forward -output-dir=%t | FileCheck %s
+// RUN: ls %t | FileCheck %s --check-prefix=FILES
+// RUN: %PYTHON -c "import struct; load = lambda name: struct.unpack('4f', open('%t/' + name, 'rb').read()); x = load('input0.bin'); print(any(x), load('golden0.bin') == x, load('golden1.bin') == tuple(2 * v for v in x))" | FileCheck %s --check-prefix=VALUES
+
+// CHECK: port 0: memref<4xf32>
+// CHECK: port 1: memref<4xf32>
+
+// FILES: golden0.bin
+// FILES: golden1.bin
+// FILES: input0.bin
+// FILES: input1.bin
+
+// The random inputs are non-trivial and not changed by the execution, while the
+// output port holds the doubled input values.
+// VALUES: True True True
+func.func @forward(%arg0: tensor<4xf32>) -> tensor<4xf32> {
+  %0 = tensor.empty() : tensor<4xf32>
+  %1 = linalg.generic {indexing_maps = [affine_map<(d0) -> (d0)>, affine_map<(d0) -> (d0)>], iterator_types = ["parallel"]} ins(%arg0 : tensor<4xf32>) outs(%0 : tensor<4xf32>) {
+  ^bb0(%in: f32, %out: f32):
+    %2 = arith.addf %in, %in : f32
+    linalg.yield %2 : f32
+  } -> tensor<4xf32>
+  return %1 : tensor<4xf32>
+}
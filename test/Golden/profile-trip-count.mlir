@@ -0,0 +1,26 @@
+// RUN: scalehls-golden %s -top-func=forward -profile-output=- | FileCheck %s
+
+#map = affine_map<(d0) -> (d0)>
+#set = affine_set<(d0) : (d0 - 12 >= 0)>
+
+// CHECK-LABEL: func.func @forward
+// CHECK:         affine.for %{{.*}} = 0 to 16 {
+// CHECK:           affine.for %{{.*}} = 0 to #map(%{{.*}}) {
+// CHECK:           } {profile_max_trip_count = 15 : i64, profile_trip_count = 7.500000e+00 : f64, profile_trip_count_hist = array<i64: 1, 1, 2, 4, 8>}
+// CHECK:           affine.if #set(%{{.*}}) {
+// CHECK:           } {profile_then_prob = 2.500000e-01 : f64}
+// CHECK:         } {profile_max_trip_count = 16 : i64, profile_trip_count = 1.600000e+01 : f64, profile_trip_count_hist = array<i64: 0, 0, 0, 0, 0, 1>}
+func.func @forward(%arg0: memref<16xf32>) {
+  %cst = arith.constant 1.000000e+00 : f32
+  affine.for %i = 0 to 16 {
+    affine.for %j = 0 to #map(%i) {
+      %0 = affine.load %arg0[%j] : memref<16xf32>
+      %1 = arith.addf %0, %cst : f32
+      affine.store %1, %arg0[%j] : memref<16xf32>
+    }
+    affine.if #set(%i) {
+      affine.store %cst, %arg0[%i] : memref<16xf32>
+    }
+  }
+  return
+}
@@ -0,0 +1,76 @@
+// RUN: scalehls-opt -scalehls-balance-dataflow-node %s | FileCheck %s --check-prefix=COPY
+// RUN: scalehls-opt -scalehls-balance-dataflow-node="multi-bank-buffer=true" %s | FileCheck %s --check-prefix=BANK
+
+// On-chip buffers are balanced with copy nodes by default.
+// COPY-LABEL: func.func @single_consumer
+// COPY:       memref.copy
+// COPY-LABEL: func.func @multi_consumer
+// COPY:       memref.copy
+
+// On-chip buffers are turned into multi-bank buffers if multi-bank-buffer is
+// set, where each bypass consumer reads its bank through the input tap.
+// BANK-LABEL: func.func @single_consumer
+// BANK:       %[[BUF0:.*]] = hls.dataflow.buffer {depth = 2 : i32} : memref<4xi8, #hls.mem<bram_t2p>>
+// BANK-NOT:   memref.copy
+// BANK:       hls.dataflow.node(%[[BUF0]]) -> () {inputTaps = [1 : i32], level = 0 : i32}
+// BANK-LABEL: func.func @multi_consumer
+// BANK:       %[[BUF1:.*]] = hls.dataflow.buffer {depth = 2 : i32} : memref<4xi8, #hls.mem<bram_t2p>>
+// BANK-NOT:   memref.copy
+// BANK:       hls.dataflow.node(%[[BUF1]]) -> (%{{.*}}) {inputTaps = [0 : i32], level = 1 : i32}
+// BANK:       hls.dataflow.node(%[[BUF1]], %{{.*}}) -> () {inputTaps = [1 : i32, 0 : i32], level = 0 : i32}
+func.func @single_consumer() {
+  hls.dataflow.schedule {
+    %0 = hls.dataflow.buffer {depth = 1 : i32} : memref<4xi8, #hls.mem<bram_t2p>>
+    %1 = hls.dataflow.buffer {depth = 1 : i32} : memref<4xi8, #hls.mem<bram_t2p>>
+    hls.dataflow.node() -> (%0) {inputTaps = [], level = 2 : i32} : () -> memref<4xi8, #hls.mem<bram_t2p>> {
+    ^bb0(%arg0: memref<4xi8, #hls.mem<bram_t2p>>):
+      %c0_i8 = arith.constant 0 : i8
+      affine.for %arg1 = 0 to 4 {
+        affine.store %c0_i8, %arg0[%arg1] : memref<4xi8, #hls.mem<bram_t2p>>
+      }
+    }
+    hls.dataflow.node() -> (%1) {inputTaps = [], level = 1 : i32} : () -> memref<4xi8, #hls.mem<bram_t2p>> {
+    ^bb0(%arg0: memref<4xi8, #hls.mem<bram_t2p>>):
+      %c1_i8 = arith.constant 1 : i8
+      affine.for %arg1 = 0 to 4 {
+        affine.store %c1_i8, %arg0[%arg1] : memref<4xi8, #hls.mem<bram_t2p>>
+      }
+    }
+    hls.dataflow.node(%0) -> () {inputTaps = [0 : i32], level = 0 : i32} : (memref<4xi8, #hls.mem<bram_t2p>>) -> () {
+    ^bb0(%arg0: memref<4xi8, #hls.mem<bram_t2p>>):
+      affine.for %arg1 = 0 to 4 {
+        %2 = affine.load %arg0[%arg1] : memref<4xi8, #hls.mem<bram_t2p>>
+      }
+    }
+  }
+  return
+}
+
+func.func @multi_consumer() {
+  hls.dataflow.schedule {
+    %0 = hls.dataflow.buffer {depth = 1 : i32} : memref<4xi8, #hls.mem<bram_t2p>>
+    %1 = hls.dataflow.buffer {depth = 1 : i32} : memref<4xi8, #hls.mem<bram_t2p>>
+    hls.dataflow.node() -> (%0) {inputTaps = [], level = 2 : i32} : () -> memref<4xi8, #hls.mem<bram_t2p>> {
+    ^bb0(%arg0: memref<4xi8, #hls.mem<bram_t2p>>):
+      %c0_i8 = arith.constant 0 : i8
+      affine.for %arg1 = 0 to 4 {
+        affine.store %c0_i8, %arg0[%arg1] : memref<4xi8, #hls.mem<bram_t2p>>
+      }
+    }
+    hls.dataflow.node(%0) -> (%1) {inputTaps = [0 : i32], level = 1 : i32} : (memref<4xi8, #hls.mem<bram_t2p>>) -> memref<4xi8, #hls.mem<bram_t2p>> {
+    ^bb0(%arg0: memref<4xi8, #hls.mem<bram_t2p>>, %arg1: memref<4xi8, #hls.mem<bram_t2p>>):
+      affine.for %arg2 = 0 to 4 {
+        %2 = affine.load %arg0[%arg2] : memref<4xi8, #hls.mem<bram_t2p>>
+        affine.store %2, %arg1[%arg2] : memref<4xi8, #hls.mem<bram_t2p>>
+      }
+    }
+    hls.dataflow.node(%0, %1) -> () {inputTaps = [0 : i32, 0 : i32], level = 0 : i32} : (memref<4xi8, #hls.mem<bram_t2p>>, memref<4xi8, #hls.mem<bram_t2p>>) -> () {
+    ^bb0(%arg0: memref<4xi8, #hls.mem<bram_t2p>>, %arg1: memref<4xi8, #hls.mem<bram_t2p>>):
+      affine.for %arg2 = 0 to 4 {
+        %2 = affine.load %arg0[%arg2] : memref<4xi8, #hls.mem<bram_t2p>>
+        %3 = affine.load %arg1[%arg2] : memref<4xi8, #hls.mem<bram_t2p>>
+      }
+    }
+  }
+  return
+}
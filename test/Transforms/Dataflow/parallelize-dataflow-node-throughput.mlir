@@ -0,0 +1,74 @@
+// RUN: scalehls-opt -scalehls-parallelize-dataflow-node="throughput-aware=true correlation-aware=false max-dsp-num=12" %s | FileCheck %s --check-prefix=DSP12
+// RUN: scalehls-opt -scalehls-parallelize-dataflow-node="throughput-aware=true correlation-aware=false max-dsp-num=20" %s | FileCheck %s --check-prefix=DSP20
+
+// The fadd node (complexity 64, 2 DSPs per iteration) is the bottleneck over
+// the fmul node (complexity 16, 3 DSPs per iteration). Doubling its factor to 4
+// takes 11 DSPs, and to 8 takes 19 DSPs. The fmul node is only unrolled when
+// its II becomes the largest one.
+// DSP12-LABEL: func.func @test_throughput
+// DSP12:       affine.for %{{.*}} = 0 to 64 step 4 {
+// DSP12-COUNT-4: arith.addf
+// DSP12:       affine.for %{{.*}} = 0 to 16 {
+// DSP12:       arith.mulf
+// DSP12-NOT:   arith.mulf
+
+// DSP20-LABEL: func.func @test_throughput
+// DSP20:       affine.for %{{.*}} = 0 to 64 step 8 {
+// DSP20-COUNT-8: arith.addf
+// DSP20:       affine.for %{{.*}} = 0 to 16 {
+// DSP20:       arith.mulf
+// DSP20-NOT:   arith.mulf
+
+// The "increase" hint of the schedule is applied to the explored factors.
+// DSP12-LABEL: func.func @test_throughput_hint
+// DSP12:       affine.for %{{.*}} = 0 to 64 step 8 {
+// DSP12:       affine.for %{{.*}} = 0 to 16 step 2 {
+
+// DSP20-LABEL: func.func @test_throughput_hint
+// DSP20:       affine.for %{{.*}} = 0 to 64 step 16 {
+// DSP20:       affine.for %{{.*}} = 0 to 16 step 2 {
+func.func @test_throughput(%arg0: memref<64xf32, #hls.mem<dram>>, %arg1: memref<64xf32, #hls.mem<dram>>, %arg2: memref<16xf32, #hls.mem<dram>>, %arg3: memref<16xf32, #hls.mem<dram>>) {
+  hls.dataflow.schedule(%arg0, %arg1, %arg2, %arg3) : memref<64xf32, #hls.mem<dram>>, memref<64xf32, #hls.mem<dram>>, memref<16xf32, #hls.mem<dram>>, memref<16xf32, #hls.mem<dram>> {
+  ^bb0(%arg4: memref<64xf32, #hls.mem<dram>>, %arg5: memref<64xf32, #hls.mem<dram>>, %arg6: memref<16xf32, #hls.mem<dram>>, %arg7: memref<16xf32, #hls.mem<dram>>):
+    hls.dataflow.node(%arg4) -> (%arg5) {inputTaps = [0 : i32], level = 0 : i32} : (memref<64xf32, #hls.mem<dram>>) -> memref<64xf32, #hls.mem<dram>> {
+    ^bb0(%arg8: memref<64xf32, #hls.mem<dram>>, %arg9: memref<64xf32, #hls.mem<dram>>):
+      affine.for %arg10 = 0 to 64 {
+        %0 = affine.load %arg8[%arg10] : memref<64xf32, #hls.mem<dram>>
+        %1 = arith.addf %0, %0 : f32
+        affine.store %1, %arg9[%arg10] : memref<64xf32, #hls.mem<dram>>
+      }
+    }
+    hls.dataflow.node(%arg6) -> (%arg7) {inputTaps = [0 : i32], level = 0 : i32} : (memref<16xf32, #hls.mem<dram>>) -> memref<16xf32, #hls.mem<dram>> {
+    ^bb0(%arg8: memref<16xf32, #hls.mem<dram>>, %arg9: memref<16xf32, #hls.mem<dram>>):
+      affine.for %arg10 = 0 to 16 {
+        %0 = affine.load %arg8[%arg10] : memref<16xf32, #hls.mem<dram>>
+        %1 = arith.mulf %0, %0 : f32
+        affine.store %1, %arg9[%arg10] : memref<16xf32, #hls.mem<dram>>
+      }
+    }
+  }
+  return
+}
+
+func.func @test_throughput_hint(%arg0: memref<64xf32, #hls.mem<dram>>, %arg1: memref<64xf32, #hls.mem<dram>>, %arg2: memref<16xf32, #hls.mem<dram>>, %arg3: memref<16xf32, #hls.mem<dram>>) {
+  hls.dataflow.schedule(%arg0, %arg1, %arg2, %arg3) attributes {increase = 2 : i64} : memref<64xf32, #hls.mem<dram>>, memref<64xf32, #hls.mem<dram>>, memref<16xf32, #hls.mem<dram>>, memref<16xf32, #hls.mem<dram>> {
+  ^bb0(%arg4: memref<64xf32, #hls.mem<dram>>, %arg5: memref<64xf32, #hls.mem<dram>>, %arg6: memref<16xf32, #hls.mem<dram>>, %arg7: memref<16xf32, #hls.mem<dram>>):
+    hls.dataflow.node(%arg4) -> (%arg5) {inputTaps = [0 : i32], level = 0 : i32} : (memref<64xf32, #hls.mem<dram>>) -> memref<64xf32, #hls.mem<dram>> {
+    ^bb0(%arg8: memref<64xf32, #hls.mem<dram>>, %arg9: memref<64xf32, #hls.mem<dram>>):
+      affine.for %arg10 = 0 to 64 {
+        %0 = affine.load %arg8[%arg10] : memref<64xf32, #hls.mem<dram>>
+        %1 = arith.addf %0, %0 : f32
+        affine.store %1, %arg9[%arg10] : memref<64xf32, #hls.mem<dram>>
+      }
+    }
+    hls.dataflow.node(%arg6) -> (%arg7) {inputTaps = [0 : i32], level = 0 : i32} : (memref<16xf32, #hls.mem<dram>>) -> memref<16xf32, #hls.mem<dram>> {
+    ^bb0(%arg8: memref<16xf32, #hls.mem<dram>>, %arg9: memref<16xf32, #hls.mem<dram>>):
+      affine.for %arg10 = 0 to 16 {
+        %0 = affine.load %arg8[%arg10] : memref<16xf32, #hls.mem<dram>>
+        %1 = arith.mulf %0, %0 : f32
+        affine.store %1, %arg9[%arg10] : memref<16xf32, #hls.mem<dram>>
+      }
+    }
+  }
+  return
+}
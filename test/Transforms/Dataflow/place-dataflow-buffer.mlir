@@ -0,0 +1,20 @@
+// RUN: scalehls-opt -scalehls-place-dataflow-buffer="resource-aware=true" %s | FileCheck %s
+
+// CHECK-LABEL: func.func @forward
+// CHECK:       hls.dataflow.buffer {depth = 1 : i32} : memref<16xi8, #hls.mem<lutram_2p>>
+// CHECK:       hls.dataflow.buffer {depth = 1 : i32} : memref<1024xi8, #hls.mem<bram_t2p>>
+// CHECK:       hls.dataflow.buffer {depth = 1 : i32} : memref<1024x1024xi8, #hls.mem<dram>>
+func.func @forward() {
+  %c0_i8 = arith.constant 0 : i8
+  %0 = hls.dataflow.buffer {depth = 1 : i32} : memref<16xi8>
+  %1 = hls.dataflow.buffer {depth = 1 : i32} : memref<1024xi8>
+  %2 = hls.dataflow.buffer {depth = 1 : i32} : memref<1024x1024xi8>
+  affine.for %arg0 = 0 to 1024 {
+    affine.for %arg1 = 0 to 1024 {
+      %3 = affine.load %0[%arg1 mod 16] : memref<16xi8>
+      affine.store %3, %2[%arg0, %arg1] : memref<1024x1024xi8>
+    }
+    affine.store %c0_i8, %1[%arg0] : memref<1024xi8>
+  }
+  return
+}
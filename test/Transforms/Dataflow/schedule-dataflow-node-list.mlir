@@ -0,0 +1,34 @@
+// RUN: scalehls-opt -scalehls-schedule-dataflow-node="max-nodes-per-level=1" %s | FileCheck %s
+
+// CHECK-LABEL: func.func @forward
+// CHECK:       hls.dataflow.node() -> (%{{.*}}) {inputTaps = [], level = 1 : i32}
+// CHECK:       hls.dataflow.node() -> (%{{.*}}) {inputTaps = [], level = 2 : i32}
+// CHECK:       hls.dataflow.node(%{{.*}}, %{{.*}}) -> () {inputTaps = [0 : i32, 0 : i32], level = 0 : i32}
+func.func @forward() {
+  hls.dataflow.schedule {
+    %0 = hls.dataflow.buffer {depth = 1 : i32} : memref<4xi8, #hls.mem<bram_t2p>>
+    %1 = hls.dataflow.buffer {depth = 1 : i32} : memref<4xi8, #hls.mem<bram_t2p>>
+    hls.dataflow.node() -> (%0) {inputTaps = []} : () -> memref<4xi8, #hls.mem<bram_t2p>> {
+    ^bb0(%arg0: memref<4xi8, #hls.mem<bram_t2p>>):
+      %c0_i8 = arith.constant 0 : i8
+      affine.for %arg1 = 0 to 4 {
+        affine.store %c0_i8, %arg0[%arg1] : memref<4xi8, #hls.mem<bram_t2p>>
+      }
+    }
+    hls.dataflow.node() -> (%1) {inputTaps = []} : () -> memref<4xi8, #hls.mem<bram_t2p>> {
+    ^bb0(%arg0: memref<4xi8, #hls.mem<bram_t2p>>):
+      %c1_i8 = arith.constant 1 : i8
+      affine.for %arg1 = 0 to 4 {
+        affine.store %c1_i8, %arg0[%arg1] : memref<4xi8, #hls.mem<bram_t2p>>
+      }
+    }
+    hls.dataflow.node(%0, %1) -> () {inputTaps = [0 : i32, 0 : i32]} : (memref<4xi8, #hls.mem<bram_t2p>>, memref<4xi8, #hls.mem<bram_t2p>>) -> () {
+    ^bb0(%arg0: memref<4xi8, #hls.mem<bram_t2p>>, %arg1: memref<4xi8, #hls.mem<bram_t2p>>):
+      affine.for %arg2 = 0 to 4 {
+        %2 = affine.load %arg0[%arg2] : memref<4xi8, #hls.mem<bram_t2p>>
+        %3 = affine.load %arg1[%arg2] : memref<4xi8, #hls.mem<bram_t2p>>
+      }
+    }
+  }
+  return
+}
@@ -0,0 +1,33 @@
+// RUN: scalehls-opt -scalehls-size-dataflow-stream="num-frames=1" %s | FileCheck %s
+
+// CHECK-LABEL: func.func @forward
+// CHECK:       %[[STREAM:.*]] = hls.dataflow.stream {depth = 4 : i32} : <i1, 4>
+// CHECK:       hls.dataflow.node() -> (%{{.*}}, %[[STREAM]]) {inputTaps = [], level = 1 : i32} : () -> (memref<4xi8, #hls.mem<bram_t2p>>, !hls.stream<i1, 4>) {
+// CHECK:       ^bb0(%{{.*}}: memref<4xi8, #hls.mem<bram_t2p>>, %[[ARG0:.*]]: !hls.stream<i1, 4>):
+// CHECK:           hls.dataflow.stream_write %[[ARG0]], %{{.*}} : <i1, 4>, i1
+// CHECK:       hls.dataflow.node(%{{.*}}, %[[STREAM]]) {inputTaps = [0 : i32, 0 : i32], level = 0 : i32} : (memref<4xi8, #hls.mem<bram_t2p>>, !hls.stream<i1, 4>) -> () {
+// CHECK:       ^bb0(%{{.*}}: memref<4xi8, #hls.mem<bram_t2p>>, %[[ARG1:.*]]: !hls.stream<i1, 4>):
+// CHECK:           hls.dataflow.stream_read %[[ARG1]] : (!hls.stream<i1, 4>) -> i1
+func.func @forward() {
+  hls.dataflow.schedule {
+    %0 = hls.dataflow.buffer {depth = 1 : i32} : memref<4xi8, #hls.mem<bram_t2p>>
+    %1 = hls.dataflow.stream {depth = 1 : i32} : <i1, 1>
+    hls.dataflow.node() -> (%0, %1) {inputTaps = [], level = 1 : i32} : () -> (memref<4xi8, #hls.mem<bram_t2p>>, !hls.stream<i1, 1>) {
+    ^bb0(%arg0: memref<4xi8, #hls.mem<bram_t2p>>, %arg1: !hls.stream<i1, 1>):
+      %c0_i8 = arith.constant 0 : i8
+      %true = arith.constant true
+      affine.for %arg2 = 0 to 4 {
+        affine.store %c0_i8, %arg0[%arg2] : memref<4xi8, #hls.mem<bram_t2p>>
+        hls.dataflow.stream_write %arg1, %true : <i1, 1>, i1
+      }
+    }
+    hls.dataflow.node(%0, %1) -> () {inputTaps = [0 : i32, 0 : i32], level = 0 : i32} : (memref<4xi8, #hls.mem<bram_t2p>>, !hls.stream<i1, 1>) -> () {
+    ^bb0(%arg0: memref<4xi8, #hls.mem<bram_t2p>>, %arg1: !hls.stream<i1, 1>):
+      affine.for %arg2 = 0 to 4 {
+        %2 = hls.dataflow.stream_read %arg1 : (!hls.stream<i1, 1>) -> i1
+        %3 = affine.load %arg0[%arg2] : memref<4xi8, #hls.mem<bram_t2p>>
+      }
+    }
+  }
+  return
+}
@@ -0,0 +1,60 @@
+// RUN: scalehls-opt -scalehls-array-partition %s | FileCheck %s
+
+// @shared is called by @caller_a and @caller_b, which require cyclic partitions
+// of factor 2 and 4 on the buffer passed to @shared, respectively. As @shared
+// has only one signature, its argument and the buffers of both callers are
+// partitioned with the larger factor.
+
+// CHECK-LABEL: func.func @shared(
+// CHECK-SAME:    %arg0: memref<512xf32, #hls.mem<dram>>
+// CHECK-SAME:    %arg1: memref<512xf32, #hls.partition<[cyclic], [4]>>
+// CHECK-SAME:  ) {
+// CHECK:         affine.store %{{.*}}, %arg1[%{{.*}}] : memref<512xf32, #hls.partition<[cyclic], [4]>>
+func.func @shared(%arg0: memref<512xf32, #hls.mem<dram>>, %arg1: memref<512xf32>) {
+  affine.for %i = 0 to 512 {
+    %0 = affine.load %arg0[%i] : memref<512xf32, #hls.mem<dram>>
+    affine.store %0, %arg1[%i] : memref<512xf32>
+  }
+  return
+}
+
+// CHECK-LABEL: func.func @caller_a(
+// CHECK:         %[[BUF:.*]] = memref.alloc() : memref<512xf32, #hls.partition<[cyclic], [4]>>
+// CHECK:         call @shared(%arg0, %[[BUF]]) : (memref<512xf32, #hls.mem<dram>>, memref<512xf32, #hls.partition<[cyclic], [4]>>) -> ()
+func.func @caller_a(%arg0: memref<512xf32, #hls.mem<dram>>, %arg1: memref<256xf32, #hls.mem<dram>>) {
+  %0 = memref.alloc() : memref<512xf32>
+  call @shared(%arg0, %0) : (memref<512xf32, #hls.mem<dram>>, memref<512xf32>) -> ()
+  affine.for %i = 0 to 256 {
+    %1 = affine.load %0[%i * 2] : memref<512xf32>
+    %2 = affine.load %0[%i * 2 + 1] : memref<512xf32>
+    %3 = arith.addf %1, %2 : f32
+    affine.store %3, %arg1[%i] : memref<256xf32, #hls.mem<dram>>
+  }
+  return
+}
+
+// CHECK-LABEL: func.func @caller_b(
+// CHECK:         %[[BUF:.*]] = memref.alloc() : memref<512xf32, #hls.partition<[cyclic], [4]>>
+// CHECK:         call @shared(%arg0, %[[BUF]]) : (memref<512xf32, #hls.mem<dram>>, memref<512xf32, #hls.partition<[cyclic], [4]>>) -> ()
+func.func @caller_b(%arg0: memref<512xf32, #hls.mem<dram>>, %arg1: memref<128xf32, #hls.mem<dram>>) {
+  %0 = memref.alloc() : memref<512xf32>
+  call @shared(%arg0, %0) : (memref<512xf32, #hls.mem<dram>>, memref<512xf32>) -> ()
+  affine.for %i = 0 to 128 {
+    %1 = affine.load %0[%i * 4] : memref<512xf32>
+    %2 = affine.load %0[%i * 4 + 1] : memref<512xf32>
+    %3 = affine.load %0[%i * 4 + 2] : memref<512xf32>
+    %4 = affine.load %0[%i * 4 + 3] : memref<512xf32>
+    %5 = arith.addf %1, %2 : f32
+    %6 = arith.addf %3, %4 : f32
+    %7 = arith.addf %5, %6 : f32
+    affine.store %7, %arg1[%i] : memref<128xf32, #hls.mem<dram>>
+  }
+  return
+}
+
+// CHECK-LABEL: func.func @forward(
+func.func @forward(%arg0: memref<512xf32, #hls.mem<dram>>, %arg1: memref<256xf32, #hls.mem<dram>>, %arg2: memref<128xf32, #hls.mem<dram>>) attributes {top_func} {
+  call @caller_a(%arg0, %arg1) : (memref<512xf32, #hls.mem<dram>>, memref<256xf32, #hls.mem<dram>>) -> ()
+  call @caller_b(%arg0, %arg2) : (memref<512xf32, #hls.mem<dram>>, memref<128xf32, #hls.mem<dram>>) -> ()
+  return
+}
@@ -0,0 +1,39 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: scalehls-opt -scalehls-dse="target-spec=%S/dse-config.json output-path=%t/ csv-path=%t/" %s | FileCheck %s
+// RUN: ls %t | FileCheck %s --check-prefix=FILES
+
+// The callee is explored before the caller, and its design points are composed
+// at the call sites when exploring the caller.
+// FILES: callee_loop_0_space.csv
+// FILES: callee_space.csv
+// FILES: forward_loop_0_space.csv
+// FILES: forward_space.csv
+
+// CHECK-LABEL: func.func @callee(
+// CHECK:         affine.for
+// CHECK:         loop_directive = #hls.loop<pipeline = true
+func.func @callee(%arg0: memref<16xf32>, %arg1: memref<16xf32>) {
+  affine.for %i = 0 to 16 {
+    %0 = affine.load %arg0[%i] : memref<16xf32>
+    %1 = arith.mulf %0, %0 : f32
+    affine.store %1, %arg1[%i] : memref<16xf32>
+  }
+  return
+}
+
+// CHECK-LABEL: func.func @forward(
+// CHECK:         call @callee(
+// CHECK:         call @callee(
+// CHECK:         affine.for
+// CHECK:         loop_directive = #hls.loop<pipeline = true
+// CHECK-NOT:   func.func @callee_
+func.func @forward(%arg0: memref<16xf32>, %arg1: memref<16xf32>, %arg2: memref<16xf32>, %arg3: memref<16xf32>) attributes {top_func} {
+  call @callee(%arg0, %arg1) : (memref<16xf32>, memref<16xf32>) -> ()
+  call @callee(%arg1, %arg2) : (memref<16xf32>, memref<16xf32>) -> ()
+  affine.for %i = 0 to 16 {
+    %0 = affine.load %arg2[%i] : memref<16xf32>
+    %1 = arith.addf %0, %0 : f32
+    affine.store %1, %arg3[%i] : memref<16xf32>
+  }
+  return
+}
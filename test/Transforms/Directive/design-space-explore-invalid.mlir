@@ -0,0 +1,13 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: not scalehls-opt -scalehls-dse="target-spec=%S/dse-config.json output-path=%t/ csv-path=%t/" %s 2>&1 | FileCheck %s
+
+// A loop band with variable loop bound can't be explored, which fails the pass.
+// CHECK: error: has variable loop bound
+func.func @forward(%arg0: memref<16xf32>, %arg1: memref<16xf32>, %arg2: index) attributes {top_func} {
+  affine.for %i = 0 to %arg2 {
+    %0 = affine.load %arg0[%i] : memref<16xf32>
+    %1 = arith.mulf %0, %0 : f32
+    affine.store %1, %arg1[%i] : memref<16xf32>
+  }
+  return
+}
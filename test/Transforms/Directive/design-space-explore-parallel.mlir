@@ -0,0 +1,25 @@
+// RUN: rm -rf %t && mkdir -p %t/serial %t/parallel
+// RUN: sed 's/"num_threads": 1/"num_threads": 4/' %S/dse-config.json > %t/parallel.json
+// RUN: scalehls-opt -scalehls-dse="target-spec=%S/dse-config.json output-path=%t/serial/ csv-path=%t/serial/" %s > %t/serial.mlir
+// RUN: scalehls-opt -scalehls-dse="target-spec=%t/parallel.json output-path=%t/parallel/ csv-path=%t/parallel/" %s > %t/parallel.mlir
+
+// The parallel evaluation of tile configs must find the same pareto points and
+// apply the same design point as the serial evaluation.
+// RUN: diff %t/serial/forward_loop_0_space.csv %t/parallel/forward_loop_0_space.csv
+// RUN: diff %t/serial/forward_space.csv %t/parallel/forward_space.csv
+// RUN: diff %t/serial.mlir %t/parallel.mlir
+// RUN: FileCheck %s < %t/parallel.mlir
+
+// CHECK-LABEL: func.func @forward(
+// CHECK:         affine.for
+// CHECK:         loop_directive = #hls.loop<pipeline = true
+func.func @forward(%arg0: memref<16x16xf32>, %arg1: memref<16x16xf32>) attributes {top_func} {
+  affine.for %i = 0 to 16 {
+    affine.for %j = 0 to 16 {
+      %0 = affine.load %arg0[%i, %j] : memref<16x16xf32>
+      %1 = arith.mulf %0, %0 : f32
+      affine.store %1, %arg1[%i, %j] : memref<16x16xf32>
+    }
+  }
+  return
+}
@@ -0,0 +1,38 @@
+// RUN: rm -rf %t && mkdir -p %t/single %t/both
+// RUN: sed 's|"num_threads": 1,|"num_threads": 1, "qor_cache": "%t/single.json",|' %S/dse-config.json > %t/single-config.json
+// RUN: sed 's|"num_threads": 1,|"num_threads": 1, "qor_cache": "%t/both.json",|' %S/dse-config.json > %t/both-config.json
+// RUN: sed '/call @scale_b/d' %s > %t/single.mlir
+// RUN: scalehls-opt -scalehls-dse="target-spec=%t/single-config.json output-path=%t/single/ csv-path=%t/single/" %t/single.mlir > /dev/null
+// RUN: scalehls-opt -scalehls-dse="target-spec=%t/both-config.json output-path=%t/both/ csv-path=%t/both/" %s > /dev/null
+// RUN: %PYTHON -c "import json; count = lambda path: sum(1 for entry in json.load(open(path)) if entry['loop_infos']); print(count('%t/single.json') > 0, count('%t/both.json') == 2 * count('%t/single.json'))" | FileCheck %s
+
+// The loop bands of the two callees only differ in the constant defined outside
+// of them, thus the loop bands of @scale_b must not hit the cache entries of
+// @scale_a, and the number of loop entries is doubled.
+// CHECK: True True
+
+func.func @scale_a(%arg0: memref<16xf32>, %arg1: memref<16xf32>) {
+  %cst = arith.constant 2.000000e+00 : f32
+  affine.for %i = 0 to 16 {
+    %0 = affine.load %arg0[%i] : memref<16xf32>
+    %1 = arith.mulf %0, %cst : f32
+    affine.store %1, %arg1[%i] : memref<16xf32>
+  }
+  return
+}
+
+func.func @scale_b(%arg0: memref<16xf32>, %arg1: memref<16xf32>) {
+  %cst = arith.constant 3.000000e+00 : f32
+  affine.for %i = 0 to 16 {
+    %0 = affine.load %arg0[%i] : memref<16xf32>
+    %1 = arith.mulf %0, %cst : f32
+    affine.store %1, %arg1[%i] : memref<16xf32>
+  }
+  return
+}
+
+func.func @forward(%arg0: memref<16xf32>, %arg1: memref<16xf32>, %arg2: memref<16xf32>) attributes {top_func} {
+  call @scale_a(%arg0, %arg1) : (memref<16xf32>, memref<16xf32>) -> ()
+  call @scale_b(%arg1, %arg2) : (memref<16xf32>, memref<16xf32>) -> ()
+  return
+}
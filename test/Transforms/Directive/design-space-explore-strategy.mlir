@@ -0,0 +1,57 @@
+// RUN: rm -rf %t && mkdir -p %t
+
+// RUN: mkdir -p %t/neighbor/a %t/neighbor/b
+// RUN: sed 's/"search_seed": 0/"search_seed": 7/' %S/dse-config.json > %t/neighbor.json
+// RUN: scalehls-opt -scalehls-dse="target-spec=%t/neighbor.json output-path=%t/neighbor/a/ csv-path=%t/neighbor/a/" %s > %t/neighbor/a.mlir
+// RUN: scalehls-opt -scalehls-dse="target-spec=%t/neighbor.json output-path=%t/neighbor/b/ csv-path=%t/neighbor/b/" %s > %t/neighbor/b.mlir
+// RUN: diff %t/neighbor/a/forward_loop_0_space.csv %t/neighbor/b/forward_loop_0_space.csv
+// RUN: diff %t/neighbor/a.mlir %t/neighbor/b.mlir
+// RUN: %PYTHON -c "import csv, math, sys; rows = [r for r in csv.DictReader(open(sys.argv[1])) if r['type'] == 'non-pareto']; configs = {tuple(int(r[k]) for k in r if k[0] == 'l' and k[1:].isdigit()) for r in rows}; print('explored within max_iter_num:', bool(configs) and sum(math.prod(c) > 4 for c in configs) <= 6)" %t/neighbor/a/forward_loop_0_space.csv | FileCheck %s
+
+// RUN: mkdir -p %t/exhaustive/a %t/exhaustive/b
+// RUN: sed 's/"search_strategy": "neighbor"/"search_strategy": "exhaustive"/; s/"search_seed": 0/"search_seed": 7/' %S/dse-config.json > %t/exhaustive.json
+// RUN: scalehls-opt -scalehls-dse="target-spec=%t/exhaustive.json output-path=%t/exhaustive/a/ csv-path=%t/exhaustive/a/" %s > %t/exhaustive/a.mlir
+// RUN: scalehls-opt -scalehls-dse="target-spec=%t/exhaustive.json output-path=%t/exhaustive/b/ csv-path=%t/exhaustive/b/" %s > %t/exhaustive/b.mlir
+// RUN: diff %t/exhaustive/a/forward_loop_0_space.csv %t/exhaustive/b/forward_loop_0_space.csv
+// RUN: diff %t/exhaustive/a.mlir %t/exhaustive/b.mlir
+// RUN: %PYTHON -c "import csv, math, sys; rows = [r for r in csv.DictReader(open(sys.argv[1])) if r['type'] == 'non-pareto']; configs = {tuple(int(r[k]) for k in r if k[0] == 'l' and k[1:].isdigit()) for r in rows}; print('explored within max_iter_num:', bool(configs) and sum(math.prod(c) > 4 for c in configs) <= 6)" %t/exhaustive/a/forward_loop_0_space.csv | FileCheck %s
+
+// RUN: mkdir -p %t/annealing/a %t/annealing/b
+// RUN: sed 's/"search_strategy": "neighbor"/"search_strategy": "annealing"/; s/"search_seed": 0/"search_seed": 7/' %S/dse-config.json > %t/annealing.json
+// RUN: scalehls-opt -scalehls-dse="target-spec=%t/annealing.json output-path=%t/annealing/a/ csv-path=%t/annealing/a/" %s > %t/annealing/a.mlir
+// RUN: scalehls-opt -scalehls-dse="target-spec=%t/annealing.json output-path=%t/annealing/b/ csv-path=%t/annealing/b/" %s > %t/annealing/b.mlir
+// RUN: diff %t/annealing/a/forward_loop_0_space.csv %t/annealing/b/forward_loop_0_space.csv
+// RUN: diff %t/annealing/a.mlir %t/annealing/b.mlir
+// RUN: %PYTHON -c "import csv, math, sys; rows = [r for r in csv.DictReader(open(sys.argv[1])) if r['type'] == 'non-pareto']; configs = {tuple(int(r[k]) for k in r if k[0] == 'l' and k[1:].isdigit()) for r in rows}; print('explored within max_iter_num:', bool(configs) and sum(math.prod(c) > 4 for c in configs) <= 6)" %t/annealing/a/forward_loop_0_space.csv | FileCheck %s
+
+// RUN: mkdir -p %t/genetic/a %t/genetic/b
+// RUN: sed 's/"search_strategy": "neighbor"/"search_strategy": "genetic"/; s/"search_seed": 0/"search_seed": 7/' %S/dse-config.json > %t/genetic.json
+// RUN: scalehls-opt -scalehls-dse="target-spec=%t/genetic.json output-path=%t/genetic/a/ csv-path=%t/genetic/a/" %s > %t/genetic/a.mlir
+// RUN: scalehls-opt -scalehls-dse="target-spec=%t/genetic.json output-path=%t/genetic/b/ csv-path=%t/genetic/b/" %s > %t/genetic/b.mlir
+// RUN: diff %t/genetic/a/forward_loop_0_space.csv %t/genetic/b/forward_loop_0_space.csv
+// RUN: diff %t/genetic/a.mlir %t/genetic/b.mlir
+// RUN: %PYTHON -c "import csv, math, sys; rows = [r for r in csv.DictReader(open(sys.argv[1])) if r['type'] == 'non-pareto']; configs = {tuple(int(r[k]) for k in r if k[0] == 'l' and k[1:].isdigit()) for r in rows}; print('explored within max_iter_num:', bool(configs) and sum(math.prod(c) > 4 for c in configs) <= 6)" %t/genetic/a/forward_loop_0_space.csv | FileCheck %s
+
+// RUN: mkdir -p %t/bayesian/a %t/bayesian/b
+// RUN: sed 's/"search_strategy": "neighbor"/"search_strategy": "bayesian"/; s/"search_seed": 0/"search_seed": 7/' %S/dse-config.json > %t/bayesian.json
+// RUN: scalehls-opt -scalehls-dse="target-spec=%t/bayesian.json output-path=%t/bayesian/a/ csv-path=%t/bayesian/a/" %s > %t/bayesian/a.mlir
+// RUN: scalehls-opt -scalehls-dse="target-spec=%t/bayesian.json output-path=%t/bayesian/b/ csv-path=%t/bayesian/b/" %s > %t/bayesian/b.mlir
+// RUN: diff %t/bayesian/a/forward_loop_0_space.csv %t/bayesian/b/forward_loop_0_space.csv
+// RUN: diff %t/bayesian/a.mlir %t/bayesian/b.mlir
+// RUN: %PYTHON -c "import csv, math, sys; rows = [r for r in csv.DictReader(open(sys.argv[1])) if r['type'] == 'non-pareto']; configs = {tuple(int(r[k]) for k in r if k[0] == 'l' and k[1:].isdigit()) for r in rows}; print('explored within max_iter_num:', bool(configs) and sum(math.prod(c) > 4 for c in configs) <= 6)" %t/bayesian/a/forward_loop_0_space.csv | FileCheck %s
+
+// Each search strategy is reproducible for a fixed search seed, where two runs
+// evaluate the same tile configs and apply the same design point. Besides the
+// initial tile configs whose overall parallel is no larger than
+// max_init_parallel (4), at most max_iter_num (6) tile configs are evaluated.
+// CHECK: explored within max_iter_num: True
+func.func @forward(%arg0: memref<16x16xf32>, %arg1: memref<16x16xf32>) attributes {top_func} {
+  affine.for %i = 0 to 16 {
+    affine.for %j = 0 to 16 {
+      %0 = affine.load %arg0[%i, %j] : memref<16x16xf32>
+      %1 = arith.mulf %0, %0 : f32
+      affine.store %1, %arg1[%i, %j] : memref<16x16xf32>
+    }
+  }
+  return
+}
@@ -0,0 +1,68 @@
+// RUN: rm -rf %t && mkdir -p %t
+// RUN: scalehls-opt -scalehls-dse="target-spec=%S/dse-config.json output-path=%t/ csv-path=%t/" %s | FileCheck %s
+// RUN: ls %t | FileCheck %s --check-prefix=FILES
+// RUN: FileCheck %s --input-file=%t/forward_space.csv --check-prefix=SPACE
+
+// The two callees with loops are explored and composed at their call sites,
+// while the callee without any loop is left unexplored. The calls of the
+// unexplored callee are estimated as they are, thus all design points of the
+// caller have valid latencies.
+// FILES: callee_a_loop_0_space.csv
+// FILES: callee_a_space.csv
+// FILES: callee_b_loop_0_space.csv
+// FILES: callee_b_space.csv
+// FILES: forward_loop_0_space.csv
+// FILES: forward_space.csv
+// FILES-NOT: scale
+
+// SPACE:      b0l0,b0ii,callee_a,callee_b,cycle,lut,dsp,bram,type
+// SPACE-NEXT: {{([0-9]+,){4}[1-9][0-9]*,([0-9]+,){3}pareto}}
+
+// CHECK-LABEL: func.func @callee_a(
+// CHECK:         loop_directive = #hls.loop<pipeline = true
+func.func @callee_a(%arg0: memref<16xf32>, %arg1: memref<16xf32>) {
+  affine.for %i = 0 to 16 {
+    %0 = affine.load %arg0[%i] : memref<16xf32>
+    %1 = arith.mulf %0, %0 : f32
+    affine.store %1, %arg1[%i] : memref<16xf32>
+  }
+  return
+}
+
+// CHECK-LABEL: func.func @callee_b(
+// CHECK:         loop_directive = #hls.loop<pipeline = true
+func.func @callee_b(%arg0: memref<16xf32>, %arg1: memref<16xf32>) {
+  affine.for %i = 0 to 16 {
+    %0 = affine.load %arg0[%i] : memref<16xf32>
+    %1 = arith.addf %0, %0 : f32
+    affine.store %1, %arg1[%i] : memref<16xf32>
+  }
+  return
+}
+
+// CHECK-LABEL: func.func @scale(
+// CHECK-NOT:     loop_directive
+// CHECK:         return
+func.func @scale(%arg0: memref<16xf32>, %arg1: memref<16xf32>) {
+  %0 = affine.load %arg0[0] : memref<16xf32>
+  %1 = arith.mulf %0, %0 : f32
+  affine.store %1, %arg1[0] : memref<16xf32>
+  return
+}
+
+// CHECK-LABEL: func.func @forward(
+// CHECK:         call @callee_a(
+// CHECK:         call @callee_b(
+// CHECK:         call @scale(
+// CHECK:         loop_directive = #hls.loop<pipeline = true
+func.func @forward(%arg0: memref<16xf32>, %arg1: memref<16xf32>, %arg2: memref<16xf32>, %arg3: memref<16xf32>) attributes {top_func} {
+  call @callee_a(%arg0, %arg1) : (memref<16xf32>, memref<16xf32>) -> ()
+  call @callee_b(%arg1, %arg2) : (memref<16xf32>, memref<16xf32>) -> ()
+  call @scale(%arg2, %arg3) : (memref<16xf32>, memref<16xf32>) -> ()
+  affine.for %i = 0 to 16 {
+    %0 = affine.load %arg3[%i] : memref<16xf32>
+    %1 = arith.addf %0, %0 : f32
+    affine.store %1, %arg0[%i] : memref<16xf32>
+  }
+  return
+}
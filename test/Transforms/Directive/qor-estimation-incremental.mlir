@@ -0,0 +1,37 @@
+// RUN: scalehls-opt -scalehls-qor-estimation="target-spec=%S/config.json" %s > %t.full.mlir
+// RUN: scalehls-opt -scalehls-qor-estimation="target-spec=%S/config.json incremental=true" %s > %t.incr.mlir
+
+// Reusing the recorded schedules of all loops must produce the same estimation
+// results as a full estimation.
+// RUN: diff %t.full.mlir %t.incr.mlir
+// RUN: FileCheck %s < %t.incr.mlir
+
+// CHECK: func.func @test_gemm_relu
+// CHECK-SAME: resource = #hls.res<lut = {{[0-9]+}}, dsp = {{[0-9]+}}, bram = 0>
+// CHECK-SAME: timing = #hls.time<0 -> [[LATENCY:[0-9]+]], latency = [[LATENCY]], interval = [[LATENCY]]>
+// CHECK: loop_directive = #hls.loop<pipeline = true, target_ii = 1, dataflow = false, flatten = false>
+// CHECK: loop_directive = #hls.loop<pipeline = true, target_ii = 1, dataflow = false, flatten = false>
+
+#map = affine_map<(d0, d1) -> (0, d1 mod 2, d0, d1 floordiv 2)>
+module {
+  func.func @test_gemm_relu(%arg0: f32, %arg1: memref<16x16xf32, #map, #hls.mem<bram_s2p>>, %arg2: memref<16x16xf32, #map, #hls.mem<bram_s2p>>) attributes {func_directive = #hls.func<pipeline = false, target_interval = 1, dataflow = false>, top_func} {
+    affine.for %arg3 = 0 to 16 {
+      affine.for %arg4 = 0 to 16 step 2 {
+        %0 = affine.load %arg1[%arg3, %arg4] : memref<16x16xf32, #map, #hls.mem<bram_s2p>>
+        %1 = affine.load %arg1[%arg3, %arg4 + 1] : memref<16x16xf32, #map, #hls.mem<bram_s2p>>
+        %2 = arith.mulf %arg0, %0 : f32
+        %3 = arith.mulf %arg0, %1 : f32
+        %4 = arith.addf %2, %3 : f32
+        affine.store %4, %arg2[%arg3, %arg4] : memref<16x16xf32, #map, #hls.mem<bram_s2p>>
+      } {loop_directive = #hls.loop<pipeline = true, target_ii = 1, dataflow = false, flatten = false>, parallel}
+    } {loop_directive = #hls.loop<pipeline = false, target_ii = 1, dataflow = false, flatten = true>, parallel}
+    affine.for %arg3 = 0 to 16 {
+      affine.for %arg4 = 0 to 16 {
+        %0 = affine.load %arg2[%arg3, %arg4] : memref<16x16xf32, #map, #hls.mem<bram_s2p>>
+        %1 = arith.addf %0, %0 : f32
+        affine.store %1, %arg1[%arg3, %arg4] : memref<16x16xf32, #map, #hls.mem<bram_s2p>>
+      } {loop_directive = #hls.loop<pipeline = true, target_ii = 1, dataflow = false, flatten = false>, parallel}
+    } {loop_directive = #hls.loop<pipeline = false, target_ii = 1, dataflow = false, flatten = true>, parallel}
+    return
+  }
+}
@@ -0,0 +1,19 @@
+// RUN: scalehls-opt -scalehls-qor-estimation="target-spec=%S/config.json" %s | FileCheck %s
+
+// The LUT, DSP, and BRAM annotations of the no_touch loop are composed into the
+// function, where the unpartitioned buffer occupies 8 BRAMs.
+// CHECK: func.func @test_no_touch
+// CHECK-SAME: resource = #hls.res<lut = 300, dsp = 5, bram = 10>
+
+module {
+  func.func @test_no_touch(%arg0: memref<64x64xf32, #hls.mem<bram_t2p>>) attributes {func_directive = #hls.func<pipeline = false, target_interval = 1, dataflow = false>, top_func} {
+    %0 = hls.dataflow.buffer {depth = 1 : i32} : memref<64x64xf32, #hls.mem<bram_t2p>>
+    affine.for %arg1 = 0 to 64 {
+      affine.for %arg2 = 0 to 64 {
+        %1 = affine.load %arg0[%arg1, %arg2] : memref<64x64xf32, #hls.mem<bram_t2p>>
+        affine.store %1, %0[%arg1, %arg2] : memref<64x64xf32, #hls.mem<bram_t2p>>
+      }
+    } {no_touch = true, resource = #hls.res<lut = 300, dsp = 5, bram = 2>, timing = #hls.time<0 -> 4098, latency = 4098, interval = 4098>}
+    return
+  }
+}
@@ -1,7 +1,7 @@
 // RUN: scalehls-opt -scalehls-qor-estimation="target-spec=%S/config.json" %s | FileCheck %s
 
 // CHECK: module {
-// CHECK:   func.func @test_syrk(%arg0: f32, %arg1: f32, %arg2: memref<16x16xf32, #map, #hls.mem<bram_s2p>>, %arg3: memref<16x16xf32, #map1, #hls.mem<bram_s2p>>) attributes {func_directive = #hls.func<pipeline = false, target_interval = 1, dataflow = false>, resource = #hls.res<lut = 0, dsp = 11, bram = 0>, timing = #hls.time<0 -> 4119, latency = 4119, interval = 4119>, top_func} {
+// CHECK:   func.func @test_syrk(%arg0: f32, %arg1: f32, %arg2: memref<16x16xf32, #map, #hls.mem<bram_s2p>>, %arg3: memref<16x16xf32, #map1, #hls.mem<bram_s2p>>) attributes {func_directive = #hls.func<pipeline = false, target_interval = 1, dataflow = false>, resource = #hls.res<lut = 634, dsp = 11, bram = 0>, timing = #hls.time<0 -> 4119, latency = 4119, interval = 4119>, top_func} {
 // CHECK:     affine.for %arg4 = 0 to 16 step 2 {
 // CHECK:       affine.for %arg5 = 0 to 16 {
 // CHECK:         affine.for %arg6 = 0 to 16 {
@@ -30,6 +30,18 @@
 // CHECK:     } {loop_directive = #hls.loop<pipeline = false, target_ii = 1, dataflow = false, flatten = true>, loop_info = #hls.info<flatten_trip_count = 2048, iter_latency = 21, min_ii = 2>, timing = #hls.time<0 -> 4117, latency = 4117, interval = 4117>}
 // CHECK:     return {timing = #hls.time<4117 -> 4117, latency = 0, interval = 0>}
 // CHECK:   }
+
+// The buffer consumer starts after the producer finishes, while the stream
+// consumer starts one cycle after the producer starts and can't finish earlier
+// than it. The schedule interval is bounded by the slowest node, and the
+// ping-pong buffer of 1024xf32 occupies 2 BRAMs for each of its two banks.
+// CHECK:   func.func @test_dataflow() attributes {func_directive = #hls.func<pipeline = false, target_interval = 1, dataflow = false>, resource = #hls.res<lut = 60, dsp = 6, bram = 4>, timing = #hls.time<0 -> 167, latency = 167, interval = 167>, top_func} {
+// CHECK:     hls.dataflow.schedule attributes {resource = #hls.res<lut = 60, dsp = 6, bram = 4>, timing = #hls.time<0 -> 165, latency = 165, interval = 102>} {
+// CHECK:       hls.dataflow.node() -> (%0) {inputTaps = [], level = 2 : i32, resource = #hls.res<lut = 10, dsp = 1, bram = 0>, timing = #hls.time<0 -> 102, latency = 102, interval = 102>}
+// CHECK:       hls.dataflow.node(%0) -> (%1) {inputTaps = [0 : i32], level = 1 : i32, resource = #hls.res<lut = 20, dsp = 2, bram = 0>, timing = #hls.time<102 -> 164, latency = 62, interval = 62>}
+// CHECK:       hls.dataflow.node(%1) -> () {inputTaps = [0 : i32], level = 0 : i32, resource = #hls.res<lut = 30, dsp = 3, bram = 0>, timing = #hls.time<103 -> 165, latency = 42, interval = 42>}
+// CHECK:     return {timing = #hls.time<165 -> 165, latency = 0, interval = 0>}
+// CHECK:   }
 // CHECK: }
 
 #map0 = affine_map<(d0, d1) -> (0, d1 mod 2, d0, d1 floordiv 2)>
@@ -66,4 +78,32 @@ module  {
     } {loop_directive = #hls.loop<pipeline = false, target_ii = 1, dataflow = false, flatten = true>}
     return
   }
+
+  func.func @test_dataflow() attributes {func_directive = #hls.func<pipeline = false, target_interval = 1, dataflow = false>, top_func} {
+    hls.dataflow.schedule {
+      %0 = hls.dataflow.buffer {depth = 1 : i32} : memref<1024xf32, #hls.mem<bram_t2p>>
+      %1 = hls.dataflow.stream {depth = 2 : i32} : <f32, 2>
+      hls.dataflow.node() -> (%0) {inputTaps = [], level = 2 : i32} : () -> memref<1024xf32, #hls.mem<bram_t2p>> {
+      ^bb0(%arg0: memref<1024xf32, #hls.mem<bram_t2p>>):
+        %cst = arith.constant 0.000000e+00 : f32
+        affine.for %arg1 = 0 to 1024 {
+          affine.store %cst, %arg0[%arg1] : memref<1024xf32, #hls.mem<bram_t2p>>
+        } {no_touch = true, resource = #hls.res<lut = 10, dsp = 1, bram = 0>, timing = #hls.time<0 -> 100, latency = 100, interval = 100>}
+      }
+      hls.dataflow.node(%0) -> (%1) {inputTaps = [0 : i32], level = 1 : i32} : (memref<1024xf32, #hls.mem<bram_t2p>>) -> !hls.stream<f32, 2> {
+      ^bb0(%arg0: memref<1024xf32, #hls.mem<bram_t2p>>, %arg1: !hls.stream<f32, 2>):
+        affine.for %arg2 = 0 to 1024 {
+          %2 = affine.load %arg0[%arg2] : memref<1024xf32, #hls.mem<bram_t2p>>
+          hls.dataflow.stream_write %arg1, %2 : <f32, 2>, f32
+        } {no_touch = true, resource = #hls.res<lut = 20, dsp = 2, bram = 0>, timing = #hls.time<0 -> 60, latency = 60, interval = 60>}
+      }
+      hls.dataflow.node(%1) -> () {inputTaps = [0 : i32], level = 0 : i32} : (!hls.stream<f32, 2>) -> () {
+      ^bb0(%arg0: !hls.stream<f32, 2>):
+        affine.for %arg1 = 0 to 1024 {
+          %2 = hls.dataflow.stream_read %arg0 : (!hls.stream<f32, 2>) -> f32
+        } {no_touch = true, resource = #hls.res<lut = 30, dsp = 3, bram = 0>, timing = #hls.time<0 -> 40, latency = 40, interval = 40>}
+      }
+    }
+    return
+  }
 }
@@ -0,0 +1,23 @@
+// RUN: scalehls-opt -scalehls-remove-variable-bound %s | FileCheck %s
+
+// The profiled trip count of a rectangularized loop is rescaled to the
+// probability of the created if operation, while other loops are untouched.
+// CHECK-LABEL: func.func @test_profile
+// CHECK:         affine.for %[[I:.*]] = 0 to 16 {
+// CHECK-NEXT:      affine.for %[[J:.*]] = 0 to 15 {
+// CHECK-NEXT:        affine.if #set(%[[I]], %[[J]]) {
+// CHECK:             } {profile_then_prob = 5.000000e-01 : f64}
+// CHECK-NEXT:      }{{$}}
+// CHECK-NEXT:    } {profile_max_trip_count = 16 : i64, profile_trip_count = 1.600000e+01 : f64, profile_trip_count_hist = array<i64: 0, 0, 0, 0, 0, 1>}
+#map = affine_map<(d0) -> (d0)>
+func.func @test_profile(%arg0: memref<16xf32>) {
+  %cst = arith.constant 1.000000e+00 : f32
+  affine.for %arg1 = 0 to 16 {
+    affine.for %arg2 = 0 to #map(%arg1) {
+      %0 = affine.load %arg0[%arg2] : memref<16xf32>
+      %1 = arith.addf %0, %cst : f32
+      affine.store %1, %arg0[%arg2] : memref<16xf32>
+    } {profile_max_trip_count = 15 : i64, profile_trip_count = 7.500000e+00 : f64, profile_trip_count_hist = array<i64: 1, 1, 2, 4, 8>}
+  } {profile_max_trip_count = 16 : i64, profile_trip_count = 1.600000e+01 : f64, profile_trip_count_hist = array<i64: 0, 0, 0, 0, 0, 1>}
+  return
+}
@@ -63,10 +63,19 @@ if config.enable_bindings_python:
       [os.path.join(config.scalehls_python_packages_dir, 'scalehls_core')],
       append_path=True)
 
+# The emitted C++ can be compiled against the host emulation headers and run
+# natively if a host C++ compiler is available.
+config.substitutions.append(('%scalehls_emu_include', os.path.join(
+    config.scalehls_src_root, 'tools', 'scalehls-emu', 'include')))
+if config.host_cxx.strip():
+  config.available_features.add('host-cxx')
+  config.substitutions.append(('%host_cxx', config.host_cxx.strip()))
+
 tool_dirs = [config.scalehls_tools_dir, config.polygeist_tools_dir,
              config.mlir_tools_dir, config.llvm_tools_dir]
 tools = [
     'pyscalehls.py',
+    'scalehls-golden',
     'scalehls-opt',
     'scalehls-translate',
     'cgeist'
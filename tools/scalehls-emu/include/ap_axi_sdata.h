@@ -0,0 +1,36 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright 2020-2021 The ScaleHLS Authors.
+//
+//===----------------------------------------------------------------------===//
+//
+// Header-only host emulation of the AXI4-Stream side-channel types.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SCALEHLS_EMU_AP_AXI_SDATA_H
+#define SCALEHLS_EMU_AP_AXI_SDATA_H
+
+#include "ap_int.h"
+
+template <int D, int U, int TI, int TD> struct ap_axis {
+  ap_int<D> data;
+  ap_uint<(D + 7) / 8> keep;
+  ap_uint<(D + 7) / 8> strb;
+  ap_uint<U> user;
+  ap_uint<1> last;
+  ap_uint<TI> id;
+  ap_uint<TD> dest;
+};
+
+template <int D, int U, int TI, int TD> struct ap_axiu {
+  ap_uint<D> data;
+  ap_uint<(D + 7) / 8> keep;
+  ap_uint<(D + 7) / 8> strb;
+  ap_uint<U> user;
+  ap_uint<1> last;
+  ap_uint<TI> id;
+  ap_uint<TD> dest;
+};
+
+#endif // SCALEHLS_EMU_AP_AXI_SDATA_H
@@ -0,0 +1,73 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright 2020-2021 The ScaleHLS Authors.
+//
+//===----------------------------------------------------------------------===//
+//
+// Header-only host emulation of the fixed-point types. The raw bits are kept in
+// an emulated integer of the same bit width, and the default quantization and
+// overflow modes (truncation and wrap-around) are applied on each assignment.
+// Arithmetic is carried out in double precision.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SCALEHLS_EMU_AP_FIXED_H
+#define SCALEHLS_EMU_AP_FIXED_H
+
+#include "ap_int.h"
+#include <cmath>
+
+template <int W, int I, bool S> class ap_fixed_base {
+public:
+  static constexpr int width = W;
+  static constexpr int iwidth = I;
+  static constexpr bool is_signed = S;
+
+  ap_fixed_base() = default;
+
+  template <typename T,
+            typename = std::enable_if_t<std::is_arithmetic<T>::value>>
+  ap_fixed_base(T value)
+      : raw(std::floor((double)value * std::ldexp(1.0, W - I))) {}
+
+  template <int W2, bool S2>
+  ap_fixed_base(const ap_int_base<W2, S2> &value)
+      : ap_fixed_base((double)value.get()) {}
+
+  template <int W2, int I2, bool S2>
+  ap_fixed_base(const ap_fixed_base<W2, I2, S2> &value)
+      : ap_fixed_base(value.to_double()) {}
+
+  double to_double() const {
+    return std::ldexp((double)raw.get(), I - W);
+  }
+  float to_float() const { return to_double(); }
+  operator double() const { return to_double(); }
+
+  template <typename T> ap_fixed_base &operator+=(const T &rhs) {
+    return *this = to_double() + (double)rhs;
+  }
+  template <typename T> ap_fixed_base &operator-=(const T &rhs) {
+    return *this = to_double() - (double)rhs;
+  }
+  template <typename T> ap_fixed_base &operator*=(const T &rhs) {
+    return *this = to_double() * (double)rhs;
+  }
+  template <typename T> ap_fixed_base &operator/=(const T &rhs) {
+    return *this = to_double() / (double)rhs;
+  }
+
+private:
+  ap_int_base<W, S> raw;
+};
+
+template <int W, int I> using ap_fixed = ap_fixed_base<W, I, true>;
+template <int W, int I> using ap_ufixed = ap_fixed_base<W, I, false>;
+
+namespace scalehls_emu {
+template <typename T> struct is_ap_fixed : std::false_type {};
+template <int W, int I, bool S>
+struct is_ap_fixed<ap_fixed_base<W, I, S>> : std::true_type {};
+} // namespace scalehls_emu
+
+#endif // SCALEHLS_EMU_AP_FIXED_H
@@ -0,0 +1,157 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright 2020-2021 The ScaleHLS Authors.
+//
+//===----------------------------------------------------------------------===//
+//
+// Header-only host emulation of the arbitrary precision integer types used by
+// the emitted HLS C++. Each type is backed by the narrowest native integer that
+// holds it, such that arrays of them keep a native memory layout and loops over
+// them can be vectorized by the host compiler. The value is wrapped to the
+// declared bit width on each assignment, while arithmetic is carried out on the
+// native integer after promotion.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SCALEHLS_EMU_AP_INT_H
+#define SCALEHLS_EMU_AP_INT_H
+
+#include <cstdint>
+#include <type_traits>
+
+namespace scalehls_emu {
+template <typename SignedT, typename UnsignedT> struct ap_native {
+  using signed_type = SignedT;
+  using unsigned_type = UnsignedT;
+};
+
+template <int W>
+using ap_native_t = std::conditional_t<
+    (W <= 8), ap_native<int8_t, uint8_t>,
+    std::conditional_t<
+        (W <= 16), ap_native<int16_t, uint16_t>,
+        std::conditional_t<
+            (W <= 32), ap_native<int32_t, uint32_t>,
+            std::conditional_t<(W <= 64), ap_native<int64_t, uint64_t>,
+                               ap_native<__int128, unsigned __int128>>>>>;
+
+/// Native arithmetic types, including the 128-bit integers that are not treated
+/// as arithmetic types in strict ISO C++ modes.
+template <typename T>
+struct is_native
+    : std::integral_constant<bool,
+                             std::is_arithmetic<T>::value ||
+                                 std::is_same<T, __int128>::value ||
+                                 std::is_same<T, unsigned __int128>::value> {};
+
+template <int W, bool S> struct ap_storage {
+  static_assert(W > 0 && W <= 128, "unsupported bit width");
+  using type = std::conditional_t<S, typename ap_native_t<W>::signed_type,
+                                  typename ap_native_t<W>::unsigned_type>;
+  using unsigned_type = typename ap_native_t<W>::unsigned_type;
+};
+} // namespace scalehls_emu
+
+template <int W, bool S> class ap_int_base {
+public:
+  using storage_t = typename scalehls_emu::ap_storage<W, S>::type;
+  using unsigned_t = typename scalehls_emu::ap_storage<W, S>::unsigned_type;
+  static constexpr int width = W;
+  static constexpr bool is_signed = S;
+
+  ap_int_base() = default;
+
+  template <typename T,
+            typename = std::enable_if_t<scalehls_emu::is_native<T>::value>>
+  constexpr ap_int_base(T value) : val(wrap(value)) {}
+
+  template <int W2, bool S2>
+  constexpr ap_int_base(const ap_int_base<W2, S2> &other)
+      : val(wrap(other.get())) {}
+
+  constexpr operator storage_t() const { return val; }
+  constexpr storage_t get() const { return val; }
+
+  /// Return the bits from "lo" to "hi" (both inclusive) as an unsigned value.
+  constexpr unsigned_t range(int hi, int lo) const {
+    auto bits = (unsigned_t)val >> lo;
+    auto numBits = hi - lo + 1;
+    if (numBits >= (int)sizeof(unsigned_t) * 8)
+      return bits;
+    return bits & (((unsigned_t)1 << numBits) - 1);
+  }
+  constexpr unsigned_t range() const { return range(W - 1, 0); }
+  constexpr bool operator[](int idx) const {
+    return ((unsigned_t)val >> idx) & 1;
+  }
+  constexpr bool test(int idx) const { return (*this)[idx]; }
+
+  template <typename T> ap_int_base &operator+=(const T &rhs) {
+    return *this = val + rhs;
+  }
+  template <typename T> ap_int_base &operator-=(const T &rhs) {
+    return *this = val - rhs;
+  }
+  template <typename T> ap_int_base &operator*=(const T &rhs) {
+    return *this = val * rhs;
+  }
+  template <typename T> ap_int_base &operator/=(const T &rhs) {
+    return *this = val / rhs;
+  }
+  template <typename T> ap_int_base &operator%=(const T &rhs) {
+    return *this = val % rhs;
+  }
+  template <typename T> ap_int_base &operator&=(const T &rhs) {
+    return *this = val & rhs;
+  }
+  template <typename T> ap_int_base &operator|=(const T &rhs) {
+    return *this = val | rhs;
+  }
+  template <typename T> ap_int_base &operator^=(const T &rhs) {
+    return *this = val ^ rhs;
+  }
+  template <typename T> ap_int_base &operator<<=(const T &rhs) {
+    return *this = val << rhs;
+  }
+  template <typename T> ap_int_base &operator>>=(const T &rhs) {
+    return *this = val >> rhs;
+  }
+  ap_int_base &operator++() { return *this = val + 1; }
+  ap_int_base &operator--() { return *this = val - 1; }
+  ap_int_base operator++(int) {
+    auto old = *this;
+    ++*this;
+    return old;
+  }
+  ap_int_base operator--(int) {
+    auto old = *this;
+    --*this;
+    return old;
+  }
+
+private:
+  /// Wrap the given value to the bit width of this type. When the bit width
+  /// matches the native storage, this is a plain conversion.
+  template <typename T> static constexpr storage_t wrap(T value) {
+    storage_t native;
+    if constexpr (std::is_floating_point<T>::value)
+      native = (storage_t)(typename scalehls_emu::ap_storage<64, S>::type)value;
+    else
+      native = (storage_t)value;
+
+    constexpr int shift = (int)sizeof(storage_t) * 8 - W;
+    if constexpr (shift == 0)
+      return native;
+    else if constexpr (S)
+      return (storage_t)((unsigned_t)native << shift) >> shift;
+    else
+      return native & (((unsigned_t)1 << W) - 1);
+  }
+
+  storage_t val;
+};
+
+template <int W> using ap_int = ap_int_base<W, true>;
+template <int W> using ap_uint = ap_int_base<W, false>;
+
+#endif // SCALEHLS_EMU_AP_INT_H
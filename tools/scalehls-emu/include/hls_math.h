@@ -0,0 +1,34 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright 2020-2021 The ScaleHLS Authors.
+//
+//===----------------------------------------------------------------------===//
+//
+// Header-only host emulation of the HLS math library, which simply forwards to
+// the standard math functions of the host.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SCALEHLS_EMU_HLS_MATH_H
+#define SCALEHLS_EMU_HLS_MATH_H
+
+#include <cmath>
+#include <cstdlib>
+
+namespace hls {
+using std::abs;
+using std::ceil;
+using std::cos;
+using std::exp;
+using std::exp2;
+using std::floor;
+using std::log;
+using std::log10;
+using std::log2;
+using std::pow;
+using std::sin;
+using std::sqrt;
+using std::tanh;
+} // namespace hls
+
+#endif // SCALEHLS_EMU_HLS_MATH_H
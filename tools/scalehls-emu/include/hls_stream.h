@@ -0,0 +1,61 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright 2020-2021 The ScaleHLS Authors.
+//
+//===----------------------------------------------------------------------===//
+//
+// Header-only host emulation of the HLS stream. As the emitted dataflow regions
+// are executed sequentially on the host, a stream is an unbounded FIFO and the
+// depth is ignored. Reading from an empty stream indicates a deadlock of the
+// hardware, which aborts the emulation.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SCALEHLS_EMU_HLS_STREAM_H
+#define SCALEHLS_EMU_HLS_STREAM_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+
+namespace hls {
+template <typename T, int DEPTH = 0> class stream {
+public:
+  stream() = default;
+  explicit stream(const char *name) : name(name) {}
+  stream(const stream &) = delete;
+  stream &operator=(const stream &) = delete;
+
+  bool empty() const { return queue.empty(); }
+  bool full() const { return false; }
+  size_t size() const { return queue.size(); }
+
+  T read() {
+    if (queue.empty()) {
+      std::fprintf(stderr, "error: read from empty stream '%s'\n", name);
+      std::abort();
+    }
+    T value = queue.front();
+    queue.pop_front();
+    return value;
+  }
+  void read(T &value) { value = read(); }
+  bool read_nb(T &value) {
+    if (queue.empty())
+      return false;
+    value = read();
+    return true;
+  }
+  void operator>>(T &value) { read(value); }
+
+  void write(const T &value) { queue.push_back(value); }
+  bool write_nb(const T &value) { return write(value), true; }
+  void operator<<(const T &value) { write(value); }
+
+private:
+  std::deque<T> queue;
+  const char *name = "unnamed";
+};
+} // namespace hls
+
+#endif // SCALEHLS_EMU_HLS_STREAM_H
@@ -0,0 +1,49 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright 2020-2021 The ScaleHLS Authors.
+//
+//===----------------------------------------------------------------------===//
+//
+// Header-only host emulation of the HLS vector. The elements are stored in a
+// plain array and element-wise operators are simple loops, which are left to
+// the host compiler to vectorize.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SCALEHLS_EMU_HLS_VECTOR_H
+#define SCALEHLS_EMU_HLS_VECTOR_H
+
+#include <cstddef>
+
+namespace hls {
+template <typename T, size_t N> class vector {
+public:
+  vector() = default;
+  vector(const T &value) {
+    for (size_t i = 0; i < N; ++i)
+      data[i] = value;
+  }
+
+  T &operator[](size_t idx) { return data[idx]; }
+  const T &operator[](size_t idx) const { return data[idx]; }
+  static constexpr size_t size() { return N; }
+
+#define SCALEHLS_EMU_VECTOR_OP(OP)                                            \
+  friend vector operator OP(const vector &lhs, const vector &rhs) {           \
+    vector result;                                                            \
+    for (size_t i = 0; i < N; ++i)                                            \
+      result.data[i] = lhs.data[i] OP rhs.data[i];                            \
+    return result;                                                            \
+  }
+  SCALEHLS_EMU_VECTOR_OP(+)
+  SCALEHLS_EMU_VECTOR_OP(-)
+  SCALEHLS_EMU_VECTOR_OP(*)
+  SCALEHLS_EMU_VECTOR_OP(/)
+#undef SCALEHLS_EMU_VECTOR_OP
+
+private:
+  T data[N];
+};
+} // namespace hls
+
+#endif // SCALEHLS_EMU_HLS_VECTOR_H
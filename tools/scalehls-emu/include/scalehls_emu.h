@@ -0,0 +1,122 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright 2020-2021 The ScaleHLS Authors.
+//
+//===----------------------------------------------------------------------===//
+//
+// Helpers used by the emulation main generated by "scalehls-translate
+// -scalehls-emit-hlscpp -emit-emulation-main" to initialize the ports of the
+// top function and report the results.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef SCALEHLS_EMU_SCALEHLS_EMU_H
+#define SCALEHLS_EMU_SCALEHLS_EMU_H
+
+#include "ap_fixed.h"
+#include "ap_int.h"
+#include "hls_stream.h"
+#include "hls_vector.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <type_traits>
+
+namespace scalehls_emu {
+inline std::mt19937_64 &getRandomEngine() {
+  static std::mt19937_64 engine(0);
+  return engine;
+}
+
+/// Fill the given scalar or (multi-dimensional) array with random values. The
+/// floating-point and fixed-point values are drawn from [-1, 1), while integers
+/// take random bits wrapped to their bit width.
+template <typename T> void fill_random(T &value) {
+  if constexpr (std::is_array<T>::value) {
+    for (auto &element : value)
+      fill_random(element);
+  } else if constexpr (std::is_floating_point<T>::value) {
+    std::uniform_real_distribution<T> dist(-1, 1);
+    value = dist(getRandomEngine());
+  } else if constexpr (std::is_same<T, bool>::value) {
+    value = getRandomEngine()() & 1;
+  } else if constexpr (is_ap_fixed<T>::value) {
+    std::uniform_real_distribution<double> dist(-1, 1);
+    value = dist(getRandomEngine());
+  } else {
+    value = (T)getRandomEngine()();
+  }
+}
+template <typename T, size_t N> void fill_random(hls::vector<T, N> &value) {
+  for (size_t i = 0; i < N; ++i)
+    fill_random(value[i]);
+}
+template <typename T, int DEPTH> void fill_random(hls::stream<T, DEPTH> &) {}
+
+/// Load the raw bytes of the given file into a scalar or array, which must have
+/// the memory layout of the emulated types. Return false if the file cannot be
+/// opened or is shorter than the value.
+template <typename T> bool load_file(T &value, const char *path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    return false;
+  file.read(reinterpret_cast<char *>(&value), sizeof(T));
+  return (size_t)file.gcount() == sizeof(T);
+}
+template <typename T, int DEPTH>
+bool load_file(hls::stream<T, DEPTH> &, const char *) {
+  return false;
+}
+
+/// Return the sum of all elements of the given scalar or array, which is used
+/// to quickly compare the results of different runs.
+template <typename T> double checksum(const T &value) {
+  if constexpr (std::is_array<T>::value) {
+    double sum = 0;
+    for (auto &element : value)
+      sum += checksum(element);
+    return sum;
+  } else
+    return (double)value;
+}
+template <typename T, size_t N>
+double checksum(const hls::vector<T, N> &value) {
+  double sum = 0;
+  for (size_t i = 0; i < N; ++i)
+    sum += checksum(value[i]);
+  return sum;
+}
+template <typename T, int DEPTH>
+double checksum(const hls::stream<T, DEPTH> &) {
+  return 0;
+}
+
+/// Initialize a port of the top function from the file specified by the
+/// command line argument, or with random values if no file is specified.
+template <typename T>
+void init_port(T &value, int argc, char **argv, int portIdx) {
+  if (portIdx + 1 < argc && std::strcmp(argv[portIdx + 1], "-")) {
+    if (load_file(value, argv[portIdx + 1]))
+      return;
+    std::fprintf(stderr, "warning: failed to load '%s', use random values\n",
+                 argv[portIdx + 1]);
+  }
+  fill_random(value);
+}
+
+class timer {
+public:
+  timer() : start(std::chrono::steady_clock::now()) {}
+  double elapsed_ms() const {
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+  }
+
+private:
+  std::chrono::steady_clock::time_point start;
+};
+} // namespace scalehls_emu
+
+#endif // SCALEHLS_EMU_SCALEHLS_EMU_H
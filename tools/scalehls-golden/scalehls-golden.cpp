@@ -0,0 +1,504 @@
+//===----------------------------------------------------------------------===//
+//
+// Copyright 2020-2021 The ScaleHLS Authors.
+//
+//===----------------------------------------------------------------------===//
+//
+// This tool generates the golden reference of a design by lowering the input
+// module (before HLS optimizations) to LLVM and running its top function with
+// the MLIR execution engine on the host. The top function is run on random
+// inputs, and the raw data of each port before and after the execution is
+// dumped to "input<N>.bin" and "golden<N>.bin", respectively. The C-simulation
+// testbench emitted with "scalehls-translate -emit-testbench" compares the
+// optimized design against these files.
+//
+// With "-profile-output", the tool instead runs an instrumented copy of the
+// module, and annotates each affine loop with its profiled trip counts and each
+// affine if with its profiled then-branch probability. The annotated module is
+// consumed by the QoR estimator and the complexity analysis.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/Conversion/Passes.h"
+#include "mlir/Dialect/Affine/IR/AffineOps.h"
+#include "mlir/Dialect/Arith/Transforms/Passes.h"
+#include "mlir/Dialect/Bufferization/Transforms/Passes.h"
+#include "mlir/Dialect/Func/Transforms/Passes.h"
+#include "mlir/Dialect/Linalg/Passes.h"
+#include "mlir/Dialect/Math/IR/Math.h"
+#include "mlir/Dialect/MemRef/IR/MemRef.h"
+#include "mlir/Dialect/MemRef/Transforms/Passes.h"
+#include "mlir/Dialect/Tensor/Transforms/Passes.h"
+#include "mlir/ExecutionEngine/ExecutionEngine.h"
+#include "mlir/ExecutionEngine/OptUtils.h"
+#include "mlir/Parser/Parser.h"
+#include "mlir/Pass/PassManager.h"
+#include "mlir/Support/FileUtilities.h"
+#include "mlir/Target/LLVMIR/Dialect/LLVMIR/LLVMToLLVMIRTranslation.h"
+#include "mlir/Transforms/Passes.h"
+#include "scalehls/Dialect/HLS/HLS.h"
+#include "scalehls/Dialect/HLS/Utils.h"
+#include "scalehls/InitAllDialects.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+#include <random>
+
+using namespace mlir;
+using namespace scalehls;
+
+static llvm::cl::opt<std::string> inputFilename(llvm::cl::Positional,
+                                                llvm::cl::desc("<input file>"),
+                                                llvm::cl::init("-"));
+static llvm::cl::opt<std::string>
+    topFuncName("top-func", llvm::cl::init("forward"),
+                llvm::cl::desc("Specify the top function of the design"));
+static llvm::cl::opt<std::string>
+    outputDir("output-dir", llvm::cl::init("."),
+              llvm::cl::desc("Directory of the dumped inputs and outputs"));
+static llvm::cl::opt<unsigned>
+    randomSeed("seed", llvm::cl::init(0),
+               llvm::cl::desc("Seed for generating the random inputs"));
+static llvm::cl::opt<std::string> profileOutput(
+    "profile-output", llvm::cl::init(""),
+    llvm::cl::desc("Profile the trip counts of loops and the branch "
+                   "probabilities of ifs, and write the annotated input "
+                   "module to the specified file instead of dumping ports"));
+
+/// Bufferize the module and convert memref results of functions to output
+/// arguments, such that the ports are aligned with the optimized design.
+static LogicalResult bufferizeModule(ModuleOp module) {
+  PassManager pm(module.getContext());
+  pm.addPass(bufferization::createEmptyTensorToAllocTensorPass());
+  pm.addPass(mlir::createLinalgBufferizePass());
+  pm.addPass(arith::createArithBufferizePass());
+  pm.addPass(mlir::createTensorBufferizePass());
+  pm.addPass(func::createFuncBufferizePass());
+  pm.addPass(bufferization::createBufferResultsToOutParamsPass());
+  pm.addPass(bufferization::createFinalizingBufferizePass());
+  pm.addPass(mlir::createCanonicalizerPass());
+  return pm.run(module);
+}
+
+/// Lower the bufferized module to the LLVM dialect.
+static LogicalResult lowerToLLVM(ModuleOp module) {
+  PassManager pm(module.getContext());
+  pm.addPass(mlir::createConvertLinalgToLoopsPass());
+  pm.addPass(mlir::createLowerAffinePass());
+  pm.addPass(mlir::createConvertSCFToCFPass());
+  pm.addPass(memref::createExpandStridedMetadataPass());
+  pm.addPass(mlir::createConvertMathToLibmPass());
+  pm.addPass(mlir::createConvertMathToLLVMPass());
+  pm.addPass(mlir::createArithToLLVMConversionPass());
+  pm.addPass(mlir::createMemRefToLLVMConversionPass());
+  pm.addPass(mlir::cf::createConvertControlFlowToLLVMPass());
+  pm.addPass(mlir::createConvertFuncToLLVMPass());
+  pm.addPass(mlir::createReconcileUnrealizedCastsPass());
+  return pm.run(module);
+}
+
+namespace {
+/// The storage of a port of the top function. The data is held in the native
+/// element type, where each element takes the fewest bytes covering its bit
+/// width. For memref ports, the descriptor passed to the C interface of the top
+/// function is also held here.
+struct PortStorage {
+  Type elementType;
+  bool isMemref = false;
+  std::vector<char> data;
+  SmallVector<int64_t, 8> descriptor;
+  void *descriptorPtr = nullptr;
+};
+} // namespace
+
+static unsigned getElementBytes(Type type) {
+  if (type.isIndex())
+    return 8;
+  return (type.getIntOrFloatBitWidth() + 7) / 8;
+}
+
+/// Fill the port with random values. Floating-point values are drawn from
+/// [-1, 1), while integers are drawn from a small range to avoid overflows,
+/// whose behaviors may differ between the host and the optimized design.
+static void fillRandom(PortStorage &port, std::mt19937_64 &engine) {
+  auto type = port.elementType;
+  auto bytes = getElementBytes(type);
+  std::uniform_real_distribution<double> realDist(-1.0, 1.0);
+
+  for (size_t offset = 0; offset < port.data.size(); offset += bytes) {
+    auto ptr = &port.data[offset];
+    if (type.isF32()) {
+      float value = realDist(engine);
+      memcpy(ptr, &value, bytes);
+    } else if (type.isF64()) {
+      double value = realDist(engine);
+      memcpy(ptr, &value, bytes);
+    } else if (type.isInteger(1)) {
+      *ptr = engine() & 1;
+    } else {
+      unsigned width = type.isIndex() ? 64 : type.getIntOrFloatBitWidth();
+      int64_t range = 1ll << std::min(width, 5u);
+      int64_t value = type.isUnsignedInteger()
+                          ? (int64_t)(engine() % range)
+                          : (int64_t)(engine() % range) - range / 2;
+      memcpy(ptr, &value, bytes);
+    }
+  }
+}
+
+static LogicalResult dumpPort(const PortStorage &port, StringRef prefix,
+                              unsigned portIdx) {
+  SmallString<64> path(outputDir);
+  llvm::sys::path::append(path, prefix + Twine(portIdx) + ".bin");
+
+  std::error_code ec;
+  llvm::raw_fd_ostream file(path, ec);
+  if (ec) {
+    llvm::errs() << "failed to open " << path << ": " << ec.message() << "\n";
+    return failure();
+  }
+  file.write(port.data.data(), port.data.size());
+  return success();
+}
+
+/// Run the top function of the module on random inputs with the execution
+/// engine, where the module is lowered to LLVM in place. If "dumpPorts" is
+/// true, the raw data of each port is dumped before and after the execution.
+/// "onFinish" is called with the execution engine after the execution.
+static LogicalResult
+runModule(ModuleOp module, bool dumpPorts,
+          function_ref<LogicalResult(ExecutionEngine &)> onFinish) {
+  if (failed(bufferizeModule(module)))
+    return failure();
+
+  auto func = getTopFunc(module, topFuncName);
+  if (!func) {
+    llvm::errs() << "failed to find the top function " << topFuncName << "\n";
+    return failure();
+  }
+
+  // Collect the ports of the top function, including its arguments and
+  // results. All memref results have been converted to arguments.
+  auto funcType = func.getFunctionType();
+  SmallVector<Type, 8> portTypes(funcType.getInputs());
+  portTypes.append(funcType.getResults().begin(),
+                   funcType.getResults().end());
+
+  SmallVector<PortStorage, 8> ports;
+  for (auto type : portTypes) {
+    PortStorage port;
+    port.elementType = getElementTypeOrSelf(type);
+    auto memrefType = type.dyn_cast<MemRefType>();
+    port.isMemref = (bool)memrefType;
+
+    auto elementType = port.elementType;
+    if (!(elementType.isF32() || elementType.isF64() ||
+          elementType.isIntOrIndex()) ||
+        (elementType.isa<IntegerType>() &&
+         elementType.getIntOrFloatBitWidth() > 64)) {
+      llvm::errs() << "unsupported port type " << type << "\n";
+      return failure();
+    }
+    if (memrefType && (!memrefType.hasStaticShape() ||
+                       !memrefType.getLayout().isIdentity())) {
+      llvm::errs() << "unsupported port type " << type << "\n";
+      return failure();
+    }
+
+    auto numElements = memrefType ? memrefType.getNumElements() : 1;
+    port.data.resize(numElements * getElementBytes(elementType));
+    if (memrefType) {
+      // The descriptor is composed of the allocated and aligned pointers, the
+      // offset, and the sizes and strides of each dimension.
+      auto dataPtr = reinterpret_cast<intptr_t>(port.data.data());
+      port.descriptor.append({(int64_t)dataPtr, (int64_t)dataPtr, 0});
+      auto shape = memrefType.getShape();
+      port.descriptor.append(shape.begin(), shape.end());
+      SmallVector<int64_t, 4> strides(shape.size(), 1);
+      for (int64_t dim = (int64_t)shape.size() - 2; dim >= 0; --dim)
+        strides[dim] = strides[dim + 1] * shape[dim + 1];
+      port.descriptor.append(strides.begin(), strides.end());
+    }
+    ports.push_back(std::move(port));
+  }
+
+  // Generate the inputs of all ports, such that the initial values of output
+  // ports are also aligned with the optimized design.
+  if (dumpPorts)
+    if (auto ec = llvm::sys::fs::create_directories(outputDir)) {
+      llvm::errs() << "failed to create " << outputDir << ": " << ec.message()
+                   << "\n";
+      return failure();
+    }
+  std::mt19937_64 engine(randomSeed);
+  for (auto port : llvm::enumerate(ports)) {
+    fillRandom(port.value(), engine);
+    if (dumpPorts && failed(dumpPort(port.value(), "input", port.index())))
+      return failure();
+  }
+
+  // Arguments of the packed interface are pointers to each argument value of
+  // the C interface, followed by pointers to the storages of the results.
+  SmallVector<void *, 8> args;
+  for (auto &port : ports) {
+    if (port.isMemref) {
+      port.descriptorPtr = port.descriptor.data();
+      args.push_back(&port.descriptorPtr);
+    } else
+      args.push_back(port.data.data());
+  }
+
+  auto funcName = func.getName().str();
+  func->setAttr(LLVM::LLVMDialect::getEmitCWrapperAttrName(),
+                UnitAttr::get(module.getContext()));
+  if (failed(lowerToLLVM(module)))
+    return failure();
+
+  ExecutionEngineOptions engineOptions;
+  engineOptions.transformer = makeOptimizingTransformer(
+      /*optLevel=*/3, /*sizeLevel=*/0, /*targetMachine=*/nullptr);
+  auto maybeEngine = ExecutionEngine::create(module, engineOptions);
+  if (!maybeEngine) {
+    llvm::errs() << "failed to create the execution engine: "
+                 << llvm::toString(maybeEngine.takeError()) << "\n";
+    return failure();
+  }
+
+  auto &jit = maybeEngine.get();
+  if (auto error = jit->invokePacked("_mlir_ciface_" + funcName, args)) {
+    llvm::errs() << "failed to run " << funcName << ": "
+                 << llvm::toString(std::move(error)) << "\n";
+    return failure();
+  }
+
+  if (onFinish && failed(onFinish(*jit)))
+    return failure();
+
+  if (dumpPorts)
+    for (auto port : llvm::enumerate(ports)) {
+      if (failed(dumpPort(port.value(), "golden", port.index())))
+        return failure();
+      llvm::outs() << "port " << port.index() << ": "
+                   << portTypes[port.index()] << "\n";
+    }
+  return success();
+}
+
+//===----------------------------------------------------------------------===//
+// Profiling
+//===----------------------------------------------------------------------===//
+
+/// All profiling counters are held in a global memref of i64. Each loop takes
+/// the number of entries, the number of iterations, the maximum trip count, and
+/// a histogram of trip counts with one bucket for each bit length. Each if
+/// takes the number of executions and the number of taken then-branches.
+static constexpr StringLiteral profileCounters = "__scalehls_profile";
+static constexpr unsigned numHistBuckets = 65;
+static constexpr unsigned numLoopCounters = 3 + numHistBuckets;
+static constexpr unsigned numIfCounters = 2;
+
+/// Collect all affine loops and ifs in the module in walk order, such that the
+/// operations of a cloned module are collected in the same order.
+static void collectProfiledOps(ModuleOp module,
+                               SmallVectorImpl<AffineForOp> &loops,
+                               SmallVectorImpl<AffineIfOp> &ifs) {
+  module.walk([&](Operation *op) {
+    if (auto loop = dyn_cast<AffineForOp>(op))
+      loops.push_back(loop);
+    else if (auto ifOp = dyn_cast<AffineIfOp>(op))
+      ifs.push_back(ifOp);
+  });
+}
+
+static Value getCounter(OpBuilder &builder, Location loc, Value counters,
+                        unsigned index) {
+  auto indexValue = builder.create<arith::ConstantIndexOp>(loc, index);
+  return builder.create<memref::LoadOp>(loc, counters, ValueRange(indexValue));
+}
+
+static void incrementCounter(OpBuilder &builder, Location loc, Value counters,
+                             Value index) {
+  auto one = builder.create<arith::ConstantIntOp>(loc, 1, 64);
+  auto value = builder.create<memref::LoadOp>(loc, counters, index);
+  auto sum = builder.create<arith::AddIOp>(loc, value, one);
+  builder.create<memref::StoreOp>(loc, sum, counters, index);
+}
+
+static void incrementCounter(OpBuilder &builder, Location loc, Value counters,
+                             unsigned index) {
+  auto indexValue = builder.create<arith::ConstantIndexOp>(loc, index);
+  incrementCounter(builder, loc, counters, indexValue);
+}
+
+/// Instrument the loops and ifs with counters. This must be applied before the
+/// module is lowered, as the structure of loops and ifs is lost after that.
+static void instrumentModule(ModuleOp module, ArrayRef<AffineForOp> loops,
+                             ArrayRef<AffineIfOp> ifs) {
+  auto builder = OpBuilder::atBlockBegin(module.getBody());
+  auto numCounters =
+      loops.size() * numLoopCounters + ifs.size() * numIfCounters;
+  auto type = MemRefType::get({(int64_t)std::max(numCounters, (size_t)1)},
+                              builder.getI64Type());
+  Attribute zero = builder.getI64IntegerAttr(0);
+  auto initValue = DenseElementsAttr::get(
+      RankedTensorType::get(type.getShape(), type.getElementType()), zero);
+  builder.create<memref::GlobalOp>(
+      module.getLoc(), profileCounters, /*sym_visibility=*/StringAttr(), type,
+      initValue, /*constant=*/false, /*alignment=*/IntegerAttr());
+
+  auto getCounters = [&](OpBuilder &b, Location loc) {
+    return b.create<memref::GetGlobalOp>(loc, type, profileCounters);
+  };
+
+  for (auto loop : llvm::enumerate(loops)) {
+    auto op = loop.value();
+    auto loc = op.getLoc();
+    unsigned base = loop.index() * numLoopCounters;
+
+    // Record the number of iterations before entering the loop.
+    OpBuilder b(op);
+    auto counters = getCounters(b, loc);
+    auto before = getCounter(b, loc, counters, base + 1);
+    incrementCounter(b, loc, counters, base);
+
+    b.setInsertionPointToStart(op.getBody());
+    incrementCounter(b, loc, getCounters(b, loc), base + 1);
+
+    // The difference of iterations is the trip count of this entry, which is
+    // recorded into the maximum trip count and the histogram.
+    b.setInsertionPointAfter(op);
+    counters = getCounters(b, loc);
+    auto after = getCounter(b, loc, counters, base + 1);
+    auto tripCount = b.create<arith::SubIOp>(loc, after, before);
+
+    auto maxIndex = b.create<arith::ConstantIndexOp>(loc, base + 2);
+    auto maxTripCount = b.create<memref::LoadOp>(loc, counters,
+                                                 ValueRange(maxIndex));
+    auto newMax = b.create<arith::MaxUIOp>(loc, maxTripCount, tripCount);
+    b.create<memref::StoreOp>(loc, newMax, counters, ValueRange(maxIndex));
+
+    auto width = b.create<arith::ConstantIntOp>(loc, 64, 64);
+    auto leadingZeros = b.create<math::CountLeadingZerosOp>(loc, tripCount);
+    auto bitLength = b.create<arith::SubIOp>(loc, width, leadingZeros);
+    auto bucket = b.create<arith::AddIOp>(
+        loc, b.create<arith::IndexCastOp>(loc, b.getIndexType(), bitLength),
+        b.create<arith::ConstantIndexOp>(loc, base + 3));
+    incrementCounter(b, loc, counters, bucket);
+  }
+
+  for (auto ifOp : llvm::enumerate(ifs)) {
+    auto op = ifOp.value();
+    auto loc = op.getLoc();
+    unsigned base =
+        loops.size() * numLoopCounters + ifOp.index() * numIfCounters;
+
+    OpBuilder b(op);
+    incrementCounter(b, loc, getCounters(b, loc), base);
+    b.setInsertionPointToStart(op.getThenBlock());
+    incrementCounter(b, loc, getCounters(b, loc), base + 1);
+  }
+}
+
+/// Annotate the loops and ifs with the profiled counters. Operations that are
+/// never executed are left unannotated.
+static void annotateModule(ArrayRef<AffineForOp> loops,
+                           ArrayRef<AffineIfOp> ifs,
+                           ArrayRef<int64_t> counters) {
+  for (auto loop : llvm::enumerate(loops)) {
+    auto loopCounters = counters.slice(loop.index() * numLoopCounters,
+                                       numLoopCounters);
+    auto entries = loopCounters[0];
+    if (!entries)
+      continue;
+
+    auto histogram = loopCounters.drop_front(3);
+    while (!histogram.empty() && !histogram.back())
+      histogram = histogram.drop_back();
+    hls::setProfiledTripCount(loop.value(),
+                              (double)loopCounters[1] / entries,
+                              loopCounters[2], histogram);
+  }
+
+  for (auto ifOp : llvm::enumerate(ifs)) {
+    auto base = loops.size() * numLoopCounters + ifOp.index() * numIfCounters;
+    auto executions = counters[base];
+    if (!executions)
+      continue;
+    hls::setProfiledThenProbability(ifOp.value(),
+                                    (double)counters[base + 1] / executions);
+  }
+}
+
+/// Profile the module by running an instrumented clone of it, and annotate the
+/// original module with the profiling results.
+static LogicalResult profileModule(ModuleOp module) {
+  SmallVector<AffineForOp, 32> loops;
+  SmallVector<AffineIfOp, 16> ifs;
+  collectProfiledOps(module, loops, ifs);
+
+  OwningOpRef<ModuleOp> instrumented = module.clone();
+  SmallVector<AffineForOp, 32> instrumentedLoops;
+  SmallVector<AffineIfOp, 16> instrumentedIfs;
+  collectProfiledOps(*instrumented, instrumentedLoops, instrumentedIfs);
+  instrumentModule(*instrumented, instrumentedLoops, instrumentedIfs);
+
+  SmallVector<int64_t, 256> counters(loops.size() * numLoopCounters +
+                                     ifs.size() * numIfCounters);
+  auto readCounters = [&](ExecutionEngine &jit) -> LogicalResult {
+    // The global memref is lowered to an LLVM global holding the data.
+    auto address = jit.lookup(profileCounters);
+    if (!address) {
+      llvm::errs() << "failed to find the profiling counters: "
+                   << llvm::toString(address.takeError()) << "\n";
+      return failure();
+    }
+    memcpy(counters.data(), *address, counters.size() * sizeof(int64_t));
+    return success();
+  };
+  if (failed(runModule(*instrumented, /*dumpPorts=*/false, readCounters)))
+    return failure();
+  annotateModule(loops, ifs, counters);
+
+  std::string errorMessage;
+  auto output = openOutputFile(profileOutput, &errorMessage);
+  if (!output) {
+    llvm::errs() << errorMessage << "\n";
+    return failure();
+  }
+  module.print(output->os());
+  output->keep();
+  return success();
+}
+
+int main(int argc, char **argv) {
+  llvm::InitLLVM y(argc, argv);
+  llvm::cl::ParseCommandLineOptions(argc, argv,
+                                    "ScaleHLS Golden Reference Tool\n");
+  llvm::InitializeNativeTarget();
+  llvm::InitializeNativeTargetAsmPrinter();
+
+  DialectRegistry registry;
+  scalehls::registerAllDialects(registry);
+  registerLLVMDialectTranslation(registry);
+  MLIRContext context(registry);
+
+  std::string errorMessage;
+  auto file = openInputFile(inputFilename, &errorMessage);
+  if (!file) {
+    llvm::errs() << errorMessage << "\n";
+    return 1;
+  }
+  llvm::SourceMgr sourceMgr;
+  sourceMgr.AddNewSourceBuffer(std::move(file), llvm::SMLoc());
+  auto module = parseSourceFile<ModuleOp>(sourceMgr, &context);
+  if (!module)
+    return 1;
+
+  if (!profileOutput.empty())
+    return failed(profileModule(*module));
+  return failed(runModule(*module, /*dumpPorts=*/true, nullptr));
+}